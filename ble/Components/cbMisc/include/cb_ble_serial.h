@@ -12,6 +12,8 @@
  *               connectBlue Serial Port Service. 
  *-------------------------------------------------------------------------*/
 
+#include "cb_buffer.h"
+
 /*===========================================================================
  * DEFINES
  *=========================================================================*/
@@ -19,6 +21,14 @@
   #define cbBLS_CREDITS_TOTAL               10
 #endif
 
+// Number of buffers that can be queued with cbBLS_write. The write 
+// complete callback is called once for every queued buffer, in order.
+// A fifo packet may contain the end of one buffer and the start of the
+// next one.
+#ifndef cbBLS_TX_QUEUE_SIZE
+  #define cbBLS_TX_QUEUE_SIZE               4
+#endif
+
 #define cbBLS_PORT_0                        (0)
 
 #define cbBLS_SERVER_PROFILE_SPP_LE         14
@@ -58,7 +68,12 @@ extern Status_t cbBLS_open(uint8 port, void* pCfg);
 extern Status_t cbBLS_close(uint8 port);
 
 extern Status_t cbBLS_write(uint8 port, uint8 *pBuf, uint16 bufSize);
+extern Status_t cbBLS_getTxSlot(uint8 port, uint8 **ppBuf, uint16 *pBufSize);
 extern Status_t cbBLS_getReadBuf(uint8 port, uint8** ppBuf, uint16* pBufSize);
+extern Status_t cbBLS_getReadVec(uint8 port, cbBUF_Seg *pSeg);
+#ifndef WITHOUT_BUF_STATS
+extern Status_t cbBLS_getRxBufStats(uint8 port, cbBUF_Stats *pStats);
+#endif
 extern Status_t cbBLS_readBufConsumed(uint8 port, uint16 nBytes);
 extern Status_t cbBLS_readByte(uint8 port, uint8* pByte);
 
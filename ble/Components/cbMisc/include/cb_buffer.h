@@ -24,10 +24,50 @@
 #define cbBUF_FULL      (0x02)
 #define cbBUF_NO_DATA   (0x03)
 
+/* Size of the largest slab of the default buffer pool, it holds the rx
+   buffer of cb_ble_serial. Not used when cbBUF_SLABS is given. */
+#ifndef cbBUF_LARGE_SLAB_SIZE
+#define cbBUF_LARGE_SLAB_SIZE   (200)
+#endif
+
+/* Compile options, each removes a feature and its fields from every 
+   buffer when the application does not use it:
+   - WITHOUT_BUF_STATS: cbBUF_getStats and the counters.
+   - WITHOUT_BUF_OVERWRITE: cbBUF_openOverwrite and cbBUF_getNoEvictedBytes.
+   - WITHOUT_BUF_WATERMARKS: cbBUF_setWatermarks. */
+
 /*===========================================================================
  * TYPES
  *=========================================================================*/
 
+/* Contiguous part of a buffer. The vector functions use arrays of 
+   two segments, the second one is used when the data or free space 
+   continues after the wrap-around. */
+typedef struct
+{
+    uint8   *pBuf;
+    uint16  size;
+} cbBUF_Seg;
+
+#ifndef WITHOUT_BUF_WATERMARKS
+/* Called when the number of bytes in a buffer rises to the high watermark
+   (high == TRUE) or falls to the low watermark (high == FALSE). */
+typedef void (*cbBUF_WatermarkCallback)(uint8 bufId, bool high);
+#endif
+
+#ifndef WITHOUT_BUF_STATS
+/* Buffer statistics, cleared when the buffer is opened */
+typedef struct
+{
+    uint16  peakSize;       /* Highest number of bytes in buffer */
+    uint32  bytesIn;        /* Bytes produced */
+    uint32  bytesOut;       /* Bytes consumed or evicted */
+    uint16  nOverflows;     /* Number of times data was dropped */
+    uint32  bytesDropped;   /* Bytes dropped since the buffer was full */
+    uint16  nWraps;         /* Number of wrap-arounds */
+} cbBUF_Stats;
+#endif
+
 /*===========================================================================
  * FUNCTIONS
  *=========================================================================*/
@@ -39,6 +79,8 @@ uint8 cbBUF_init(void);
 
 /*---------------------------------------------------------------------------
  * Opens a circular buffer.
+ * The buffer is taken from the smallest free slab in the buffer pool
+ * that can hold size bytes. Returns cbBUF_ERROR if there is none.
  * - size: Number of bytes in buffer.
  * - minReturnSize: No buffer is returned unless minimum size is available.
  * - reservedSize: Wrap-around if within reserved size of buffer end.
@@ -50,16 +92,108 @@ uint8 cbBUF_open(
     uint16 reservedSize,
     uint8 *pBufferId);
 
+/*---------------------------------------------------------------------------
+ * Opens a circular buffer in bip-buffer mode.
+ * No size is reserved at the end of the buffer. Instead every write buffer
+ * is the largest contiguous free part of the buffer, which may be in front
+ * of the read index. An empty buffer is restarted from the beginning. 
+ * Reading is done in the same way as for cbBUF_open.
+ * - size: Number of bytes in buffer.
+ * - minReturnSize: No buffer is returned unless minimum size is available.
+ * - pBufferId: Pointer to returned buffer identifier.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_openBip(
+    uint16 size, 
+    uint16 minReturnSize,
+    uint8 *pBufferId);
+
+/*---------------------------------------------------------------------------
+ * Opens a circular buffer in record mode.
+ * Data is written and read as whole records of up to 255 bytes, which are
+ * stored with a one byte length prefix and never split at the 
+ * wrap-around. Only the record functions and the functions returning 
+ * the number of bytes shall be used with the buffer.
+ * - size: Number of bytes in buffer, including one byte per record.
+ * - pBufferId: Pointer to returned buffer identifier.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_openRecord(
+    uint16 size, 
+    uint8 *pBufferId);
+
+#ifndef WITHOUT_BUF_OVERWRITE
+/*---------------------------------------------------------------------------
+ * Opens a circular buffer in overwrite mode.
+ * Instead of returning cbBUF_FULL the oldest data is evicted to make room,
+ * which suits streams where new data is worth more than old. No data is 
+ * evicted while the user holds a read buffer, then the buffer behaves as
+ * one opened with cbBUF_open and the write functions can return 
+ * cbBUF_FULL, or copy less than requested, until the read buffer is 
+ * returned.
+ * - size: Number of bytes in buffer.
+ * - minReturnSize: No buffer is returned unless minimum size is available.
+ * - pBufferId: Pointer to returned buffer identifier.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_openOverwrite(
+    uint16 size, 
+    uint16 minReturnSize,
+    uint8 *pBufferId);
+#endif
+
+/*---------------------------------------------------------------------------
+ * Closes a buffer and gives its slab back to the buffer pool.
+ * Any data in the buffer is lost.
+ * - bufId: Buffer identifier received when buffer was opened.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_close(uint8 bufId);
+
+/*---------------------------------------------------------------------------
+ * Changes the size of an empty buffer. The buffer is moved to another 
+ * slab if the new size does not fit in the current slab, or if a smaller
+ * free slab fits it, so that a shrunk buffer gives its slab back.
+ * The statistics are cleared and the watermarks removed, they must be 
+ * set again for the new size.
+ * Returns cbBUF_ERROR if the buffer is not empty or if there is no free 
+ * slab that is big enough.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - size: New number of bytes in buffer.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_resize(
+    uint8  bufId,
+    uint16 size);
+
 /*---------------------------------------------------------------------------
  * Empties and re-initialises the buffer.
  * - bufId: Buffer identifier received when buffer was opened.
  *-------------------------------------------------------------------------*/
 uint8 cbBUF_clear(uint8 bufId);
 
+#ifndef WITHOUT_BUF_WATERMARKS
+/*---------------------------------------------------------------------------
+ * Registers watermark callbacks.
+ * The callback is called with high TRUE when the number of bytes in the
+ * buffer rises to the high watermark, and with high FALSE when it then 
+ * falls to the low watermark. It is called from inside the produce and 
+ * consume functions, and from the write functions when an overwrite 
+ * buffer evicts data. It must not access the buffer, except for the 
+ * functions that return the number of bytes.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - high: High watermark in bytes.
+ * - low: Low watermark in bytes, less than high.
+ * - callback: Watermark callback, NULL to remove.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_setWatermarks(
+    uint8  bufId,
+    uint16 high,
+    uint16 low,
+    cbBUF_WatermarkCallback callback);
+#endif
+
 /*---------------------------------------------------------------------------
  * Gets a pointer to buffer for writing.
  * Buffer must be equal or bigger than reserved size.
  * For every cbBUF_GetWriteBuf there must be one cbBUF_WriteBufProduced.
+ * Returns cbBUF_FULL when there is no room, also in overwrite mode while
+ * the user holds a read buffer since nothing is evicted then.
  * - bufId: Buffer identifier received when buffer was opened.
  * - ppBuf: Returned buffer pointer for writing.
  * - pBufSize: Returned size of buffer for writing.
@@ -73,6 +207,7 @@ uint8 cbBUF_getWriteBuf(
  * Gets a pointer to buffer for writing.
  * Buffer does not need to be equal or bigger than reserved size.
  * For every cbBUF_GetWriteBuf there must be one cbBUF_WriteBufProduced.
+ * Returns cbBUF_FULL as cbBUF_getWriteBuf.
  * - bufId: Buffer identifier received when buffer was opened.
  * - ppBuf: Returned buffer pointer for writing.
  * - pBufSize: Returned size of buffer for writing.
@@ -94,7 +229,12 @@ uint8 cbBUF_writeBufProduced(
                                 
 /*---------------------------------------------------------------------------
  * Returns part of a previously allocated write buffer.
- * The buffer can still be used for writing.
+ * The produced bytes are available for reading at once. The rest of the 
+ * buffer can still be used for writing, starting directly after the 
+ * produced bytes. The buffer is returned with cbBUF_WriteBufProduced, 
+ * which only counts bytes written after the last cbBUF_WriteBufProducedCont.
+ * The wrap-around is done by cbBUF_WriteBufProduced, a reader in between
+ * gets the produced bytes up to the write position.
  * For every cbBUF_GetWriteBuf there must be one cbBUF_WriteBufProduced.
  * - bufId: Buffer identifier received when buffer was opened.
  * - nBytes: Number of bytes that has been written in write buffer.
@@ -125,6 +265,110 @@ uint8 cbBUF_readBufConsumed(
     uint8  bufId, 
     uint16 nBytes);
 
+/*---------------------------------------------------------------------------
+ * Gets all data available for reading as two segments.
+ * The second segment has size 0 unless the data continues after the
+ * wrap-around. 
+ * For every cbBUF_getReadVec there must be one cbBUF_readVecConsumed.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - pSeg: Array of two segments for the returned read buffers.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_getReadVec(
+    uint8     bufId, 
+    cbBUF_Seg *pSeg);
+
+/*---------------------------------------------------------------------------
+ * Returns previously allocated read segments. The bytes are consumed
+ * from the first segment and then from the second.
+ * Can also be used after cbBUF_getReadBuf.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - nBytes: Number of bytes that has been read from the segments.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_readVecConsumed(
+    uint8  bufId, 
+    uint16 nBytes);
+
+/*---------------------------------------------------------------------------
+ * Gets all free space for writing as two segments.
+ * The second segment has size 0 unless there is free space after the 
+ * wrap-around. 
+ * For every cbBUF_getWriteVec there must be one cbBUF_writeVecProduced.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - pSeg: Array of two segments for the returned write buffers.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_getWriteVec(
+    uint8     bufId, 
+    cbBUF_Seg *pSeg);
+
+/*---------------------------------------------------------------------------
+ * Returns previously allocated write segments. The first segment must 
+ * be filled before the second segment is used.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - nBytes: Number of bytes that has been written in the segments.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_writeVecProduced(
+    uint8  bufId, 
+    uint16 nBytes);
+
+/*---------------------------------------------------------------------------
+ * Copies data into a buffer. The data is copied in at most two parts when
+ * it continues after the wrap-around. A buffer opened with 
+ * cbBUF_openOverwrite evicts old data to make room for all of it, data
+ * that is larger than the buffer only keeps its newest bytes.
+ * Returns the number of copied bytes, which is less than nBytes when the 
+ * buffer is full.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - pData: Data to write.
+ * - nBytes: Number of bytes to write.
+ *-------------------------------------------------------------------------*/
+uint16 cbBUF_write(
+    uint8       bufId,
+    const uint8 *pData,
+    uint16      nBytes);
+
+/*---------------------------------------------------------------------------
+ * Copies data out of a buffer and removes it. The data is copied in at
+ * most two parts when it continues after the wrap-around.
+ * Returns the number of copied bytes, 0 when the buffer is empty.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - pData: Buffer for the read data.
+ * - nBytes: Size of pData.
+ *-------------------------------------------------------------------------*/
+uint16 cbBUF_read(
+    uint8  bufId,
+    uint8  *pData,
+    uint16 nBytes);
+
+/*---------------------------------------------------------------------------
+ * Writes one record to a buffer opened with cbBUF_openRecord.
+ * Returns cbBUF_FULL if there is no room for the whole record.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - pData: Record data.
+ * - size: Number of bytes in record.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_writeRecord(
+    uint8       bufId,
+    const uint8 *pData,
+    uint8       size);
+
+/*---------------------------------------------------------------------------
+ * Gets the oldest record from a buffer opened with cbBUF_openRecord.
+ * For every cbBUF_getReadRecord there must be one cbBUF_readRecordConsumed.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - ppRecord: Returned pointer to record data.
+ * - pSize: Returned number of bytes in record.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_getReadRecord(
+    uint8  bufId,
+    uint8  **ppRecord,
+    uint8  *pSize);
+
+/*---------------------------------------------------------------------------
+ * Removes the record returned by cbBUF_getReadRecord.
+ * - bufId: Buffer identifier received when buffer was opened.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_readRecordConsumed(uint8 bufId);
+
 /*---------------------------------------------------------------------------
  * Reads one byte from buffer.
  * - bufId: Buffer identifier received when buffer was opened.
@@ -168,6 +412,43 @@ uint16 cbBUF_getNoFreeBytes(uint8 bufId);
  *-------------------------------------------------------------------------*/
 uint16 cbBUF_getReservedSize(uint8 bufId);
 
+#ifndef WITHOUT_BUF_OVERWRITE
+/*---------------------------------------------------------------------------
+ * Gets number of bytes evicted since the buffer was opened or cleared. 
+ * Only buffers opened with cbBUF_openOverwrite evict data.
+ * - bufId: Buffer identifier received when buffer was opened.
+ *-------------------------------------------------------------------------*/
+uint32 cbBUF_getNoEvictedBytes(uint8 bufId);
+#endif
+
+/*---------------------------------------------------------------------------
+ * Reports data that the producer had to drop because the buffer was full.
+ * Only used for the buffer statistics.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - nBytes: Number of dropped bytes.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_dataDropped(
+    uint8  bufId,
+    uint16 nBytes);
+
+#ifndef WITHOUT_BUF_STATS
+/*---------------------------------------------------------------------------
+ * Gets the buffer statistics.
+ * - bufId: Buffer identifier received when buffer was opened.
+ * - pStats: Returned statistics.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_getStats(
+    uint8       bufId,
+    cbBUF_Stats *pStats);
+
+/*---------------------------------------------------------------------------
+ * Clears the buffer statistics. The peak size starts from the current 
+ * number of bytes in the buffer.
+ * - bufId: Buffer identifier received when buffer was opened.
+ *-------------------------------------------------------------------------*/
+uint8 cbBUF_clearStats(uint8 bufId);
+#endif
+
 #endif
 
 
@@ -0,0 +1,131 @@
+#ifndef _CB_BUFFER_STATIC_H_
+#define _CB_BUFFER_STATIC_H_
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Buffer
+ * File        : cb_buffer_static.h
+ *
+ * Description : Statically declared circular buffers for hot paths.
+ *
+ *               The size of a static buffer is fixed when it is declared
+ *               and every operation is a macro, so size, mask and wrap are
+ *               constants folded by the compiler. There is no buffer id,
+ *               no lookup and no state. Use cb_buffer.h for buffers that
+ *               are opened and closed at runtime.
+ *
+ *               The indexes are free running bytes that are masked when
+ *               the data is accessed. The size must therefore be a power
+ *               of two and not larger than cbBUF_STATIC_MAX_SIZE.
+ *               The caller checks for room or data before writing or
+ *               reading, e.g.
+ *
+ *                 cbBUF_STATIC_DECLARE(txBuf, 32);
+ *
+ *                 if (!cbBUF_STATIC_IS_FULL(txBuf))
+ *                 {
+ *                     cbBUF_STATIC_WRITE_BYTE(txBuf, byte);
+ *                 }
+ *
+ *               Static buffers are meant for small byte queues and have
+ *               no reserved size, minimum return size, modes, statistics
+ *               or watermarks. Buffers that need those stay with
+ *               cb_buffer.h, whose functions are not specialised per
+ *               size since the buffer pool resolves the buffer at runtime.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+#include "hal_types.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+
+/* Largest static buffer. The number of bytes in the buffer must fit in
+   a byte. */
+#define cbBUF_STATIC_MAX_SIZE   (128)
+
+/* Valid buffer size, a power of two that is not too large */
+#define cbBUF_STATIC_VALID_SIZE(size) \
+    ((((size) & ((size) - 1)) == 0) && ((size) <= cbBUF_STATIC_MAX_SIZE))
+
+/*---------------------------------------------------------------------------
+ * Declares a static buffer, at file or function scope. Fails to compile 
+ * if the size is not a power of two or too large, the data array then 
+ * gets a negative size. The buffer is empty when zero initialised, 
+ * otherwise use cbBUF_STATIC_CLEAR.
+ * - name: Name of the buffer variable.
+ * - size: Number of bytes in buffer.
+ *-------------------------------------------------------------------------*/
+#define cbBUF_STATIC_DECLARE(name, size) \
+    static struct \
+    { \
+        uint8 data[cbBUF_STATIC_VALID_SIZE(size) ? (size) : -1]; \
+        uint8 writeIndex; \
+        uint8 readIndex; \
+    } name
+
+/* Buffer size and index mask, compile time constants */
+#define cbBUF_STATIC_SIZE(name)         ((uint8)sizeof((name).data))
+#define cbBUF_STATIC_MASK(name)         ((uint8)(sizeof((name).data) - 1))
+
+/* Empties the buffer */
+#define cbBUF_STATIC_CLEAR(name) \
+    ((name).writeIndex = (name).readIndex = 0)
+
+/* Number of bytes in buffer and free bytes */
+#define cbBUF_STATIC_GET_NO_BYTES(name) \
+    ((uint8)((name).writeIndex - (name).readIndex))
+#define cbBUF_STATIC_GET_NO_FREE_BYTES(name) \
+    ((uint8)(cbBUF_STATIC_SIZE(name) - cbBUF_STATIC_GET_NO_BYTES(name)))
+
+#define cbBUF_STATIC_IS_EMPTY(name) \
+    ((name).writeIndex == (name).readIndex)
+#define cbBUF_STATIC_IS_FULL(name) \
+    (cbBUF_STATIC_GET_NO_BYTES(name) == cbBUF_STATIC_SIZE(name))
+
+/*---------------------------------------------------------------------------
+ * Byte access. The buffer must not be full when writing and not empty
+ * when reading.
+ *-------------------------------------------------------------------------*/
+#define cbBUF_STATIC_WRITE_BYTE(name, byte) \
+    ((name).data[(name).writeIndex++ & cbBUF_STATIC_MASK(name)] = (byte))
+
+#define cbBUF_STATIC_READ_BYTE(name) \
+    ((name).data[(name).readIndex++ & cbBUF_STATIC_MASK(name)])
+
+/*---------------------------------------------------------------------------
+ * Contiguous access, corresponding to cbBUF_getReadBuf/cbBUF_readBufConsumed
+ * and cbBUF_getAvailableWriteBuf/cbBUF_writeBufProduced. The size is the
+ * contiguous part up to the end of the buffer, the rest is returned after
+ * the consumed or produced bytes have been reported.
+ *-------------------------------------------------------------------------*/
+#define cbBUF_STATIC_GET_READ_BUF(name) \
+    (&(name).data[(name).readIndex & cbBUF_STATIC_MASK(name)])
+
+#define cbBUF_STATIC_GET_READ_SIZE(name) \
+    ((uint8)(cbBUF_STATIC_GET_NO_BYTES(name) < (cbBUF_STATIC_SIZE(name) - ((name).readIndex & cbBUF_STATIC_MASK(name))) ? \
+        cbBUF_STATIC_GET_NO_BYTES(name) : \
+        (cbBUF_STATIC_SIZE(name) - ((name).readIndex & cbBUF_STATIC_MASK(name)))))
+
+#define cbBUF_STATIC_READ_CONSUMED(name, nBytes) \
+    ((name).readIndex += (uint8)(nBytes))
+
+/* Data that continues after the wrap-around starts at the beginning of the
+   buffer, the part not covered by cbBUF_STATIC_GET_READ_SIZE */
+#define cbBUF_STATIC_GET_WRAP_BUF(name) \
+    (&(name).data[0])
+
+#define cbBUF_STATIC_GET_WRITE_BUF(name) \
+    (&(name).data[(name).writeIndex & cbBUF_STATIC_MASK(name)])
+
+#define cbBUF_STATIC_GET_WRITE_SIZE(name) \
+    ((uint8)(cbBUF_STATIC_GET_NO_FREE_BYTES(name) < (cbBUF_STATIC_SIZE(name) - ((name).writeIndex & cbBUF_STATIC_MASK(name))) ? \
+        cbBUF_STATIC_GET_NO_FREE_BYTES(name) : \
+        (cbBUF_STATIC_SIZE(name) - ((name).writeIndex & cbBUF_STATIC_MASK(name)))))
+
+#define cbBUF_STATIC_WRITE_PRODUCED(name, nBytes) \
+    ((name).writeIndex += (uint8)(nBytes))
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef _CB_RING_H_
+#define _CB_RING_H_
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Ring
+ * File        : cb_ring.h
+ *
+ * Description : Declaration of types and functions for the single
+ *               producer, single consumer ring buffer.
+ *
+ *               One producer and one consumer may use the same ring
+ *               without disabling interrupts, e.g. an ISR writing and
+ *               an OSAL task reading. The producer only updates the head
+ *               index and the consumer only updates the tail index. Both
+ *               indexes are single bytes and are therefore read and
+ *               written atomically. The data is always written before the
+ *               head index is published and read before the tail index
+ *               is published. Data and indexes are all accessed as
+ *               volatile, so the compiler keeps that order.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+#include "hal_types.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+
+/* Return Codes */
+#define cbRING_OK        (0x00)
+#define cbRING_ERROR     (0x01)
+#define cbRING_FULL      (0x02)
+#define cbRING_NO_DATA   (0x03)
+
+/* Largest ring size. Indexes are free running bytes and the number of
+   bytes in the ring must fit in a byte. */
+#define cbRING_MAX_SIZE  (128)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    volatile uint8  *pData; /* Ordered with the indexes */
+    uint8           mask;   /* Size - 1 */
+    volatile uint8  head;   /* Only written by producer */
+    volatile uint8  tail;   /* Only written by consumer */
+} cbRING_Ring;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Initializes a ring. Must be done before producer and consumer are
+ * started.
+ * - pRing: Ring to initialize.
+ * - pData: Memory used for the ring data.
+ * - size: Number of bytes in pData. Must be a power of two and not larger
+ *   than cbRING_MAX_SIZE.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_init(
+    cbRING_Ring *pRing,
+    uint8       *pData,
+    uint8       size);
+
+/*---------------------------------------------------------------------------
+ * Writes one byte to the ring. Called by the producer only.
+ * - pRing: Ring.
+ * - byte: Byte to write.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_put(
+    cbRING_Ring *pRing,
+    uint8       byte);
+
+/*---------------------------------------------------------------------------
+ * Reads one byte from the ring. Called by the consumer only.
+ * - pRing: Ring.
+ * - pByte: Pointer to the read byte.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_get(
+    cbRING_Ring *pRing,
+    uint8       *pByte);
+
+/*---------------------------------------------------------------------------
+ * Writes as many bytes as there is room for. Called by the producer only.
+ * Returns the number of written bytes.
+ * - pRing: Ring.
+ * - pData: Bytes to write.
+ * - nBytes: Number of bytes to write.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_write(
+    cbRING_Ring *pRing,
+    const uint8 *pData,
+    uint8       nBytes);
+
+/*---------------------------------------------------------------------------
+ * Reads as many bytes as available. Called by the consumer only.
+ * Returns the number of read bytes.
+ * - pRing: Ring.
+ * - pData: Buffer for the read bytes.
+ * - nBytes: Size of pData.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_read(
+    cbRING_Ring *pRing,
+    uint8       *pData,
+    uint8       nBytes);
+
+/*---------------------------------------------------------------------------
+ * Gets number of bytes available for reading from the ring.
+ * - pRing: Ring.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_getNoBytes(cbRING_Ring *pRing);
+
+/*---------------------------------------------------------------------------
+ * Gets number of bytes available for writing to the ring.
+ * - pRing: Ring.
+ *-------------------------------------------------------------------------*/
+uint8 cbRING_getNoFreeBytes(cbRING_Ring *pRing);
+
+#endif
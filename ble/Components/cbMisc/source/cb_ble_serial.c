@@ -8,7 +8,8 @@
 * Description : Implementation of serial data handling using the 
 *               serial service provided by "serial service". Implements
 *               buffer, credits and connection management.
-*               Currently only the peripheral side is implemented.
+*               On the central side, CB_CENTRAL, the same protocol is run
+*               through the serial port client.
 *-------------------------------------------------------------------------*/
 #include "bcomdef.h"
 #include "OSAL.h"
@@ -27,7 +28,11 @@
 #include "cb_assert.h"
 #include "cb_log.h"
 #include "cb_ble_serial.h"
+#ifdef CB_CENTRAL
+#include "cb_serial_client.h"
+#else
 #include "cb_serial_service.h"
+#endif
 #include "cb_led.h"
 #include "cb_buffer.h"
 #include "cb_snv_ids.h"
@@ -40,10 +45,41 @@
 * DEFINES
 *=========================================================================*/
 
-#define cbBLS_BUFFER_SIZE           (cbBLS_CREDITS_TOTAL*cbSPS_FIFO_SIZE)
+// Sized for the largest fifo payload, credits are given per link from the 
+// negotiated payload size. The buffer is taken from the largest slab of 
+// the buffer pool, cbBUF_LARGE_SLAB_SIZE must be raised with the payload.
+#define cbBLS_BUFFER_SIZE           (cbBLS_CREDITS_TOTAL*cbSPS_MAX_FIFO_SIZE)
+
+typedef char cbBLS_BufferSizeCheck[(cbBLS_BUFFER_SIZE <= cbBUF_LARGE_SLAB_SIZE) ? 1 : -1];
+
+// The serial port lowers the free rx buffer size itself for received data.
+// The size is reported again when this much has been consumed since the 
+// last report, and not for every read.
+#define cbBLS_RX_REPORT_SIZE        (cbBLS_BUFFER_SIZE / 2)
 
 #define UNITIALIZED_BUF_ID          (0xFF)
 
+// The serial port client has the same interface as the service
+#ifdef CB_CENTRAL
+#define spsRegister                 cbSPC_register
+#define spsEnable                   cbSPC_enable
+#define spsDisable                  cbSPC_disable
+#define spsReqDataVec               cbSPC_reqDataVec
+#define spsGetTxSlot                cbSPC_getTxSlot
+#define spsSetRemainingBufSize      cbSPC_setRemainingBufSize
+#define spsGetFifoSize              cbSPC_getFifoSize
+#define spsAddLostBytes             cbSPC_addLostBytes
+#else
+#define spsRegister                 cbSPS_register
+#define spsEnable                   cbSPS_enable
+#define spsDisable                  cbSPS_disable
+#define spsReqDataVec               cbSPS_reqDataVec
+#define spsGetTxSlot                cbSPS_getTxSlot
+#define spsSetRemainingBufSize      cbSPS_setRemainingBufSize
+#define spsGetFifoSize              cbSPS_getFifoSize
+#define spsAddLostBytes             cbSPS_addLostBytes
+#endif
+
 
 // TODO: Move all default values to a separate file
 #define DEFAULT_SERVER_PROFILE      cbBLS_SERVER_PROFILE_SPP_LE
@@ -97,6 +133,12 @@ typedef enum
 #endif 
 
 
+typedef struct
+{
+  uint8                 *pBuf;
+  uint16                size;
+} cbBLS_TxBuf;
+
 #ifndef WITHOUT_BLS_WATCHDOGS    
 typedef struct  
 {
@@ -115,13 +157,22 @@ typedef struct
   cbBLS_State           txState;
   
   
-  uint8                 bufId;
+  uint8                 bufId;      // Rx buffer, only open while connected
   uint16                connHandle;
+  bool                  spsRegistered;
 
-  uint8                 *pWriteBuf;
-  uint16                writeBufTotalSize;
-  uint16                writeBufCurrentSize;
-  uint16                writeBufTransmittedSize;
+  // Rx buffer kept allocated between received packets
+  uint8*                pRxWriteBuf;
+  uint16                rxWriteBufSize;
+  uint16                rxUnreported; // Consumed since the free size was reported
+
+  // Queue of buffers to write, the head buffer is being transmitted
+  cbBLS_TxBuf           txQueue[cbBLS_TX_QUEUE_SIZE];
+  uint8                 txQueueHead;
+  uint8                 txQueueCount;
+  uint16                writeBufCurrentSize;     // Part of head buffer in progress
+  uint16                writeBufTransmittedSize; // Part of head buffer transmitted
+  uint16                writeBufNextSize;        // Part of next buffer in progress
 
 #ifndef WITHOUT_ESCAPE_SEQUENCE
   // Escape sequence
@@ -161,6 +212,14 @@ static void updateRemainingBufSize(void);
 static cbBLS_State entryIdle(void);
 
 static void copyDataToBuf(int16 bufId, uint8* pData, int16 nBytes);
+static void closeRxWriteBuf(void);
+static void openRxBuf(void);
+static void closeRxBuf(void);
+static void rxDataConsumed(uint16 nBytes);
+
+static Status_t txEnqueue(uint8 *pBuf, uint16 bufSize);
+static Status_t txSendNext(void);
+static void txFlush(void);
 
 #ifndef WITHOUT_ESCAPE_SEQUENCE
 static bool checkEsc(uint8* pData, int16 nBytes);
@@ -206,6 +265,7 @@ cbSPS_Callbacks serialServiceCallbacks =
   spsDisconnectCallback,
   spsDataEventCallback,
   spsDataConfCallback,
+  NULL
 };
 
 cbBLS_class bls;
@@ -238,9 +298,16 @@ void cbBLS_init(void)
 
     bls.bufId = UNITIALIZED_BUF_ID;
     bls.connHandle = INVALID_CONNHANDLE;
+    bls.spsRegistered = FALSE;
+    bls.pRxWriteBuf = NULL;
+    bls.rxWriteBufSize = 0;
+    bls.rxUnreported = 0;
 
-    bls.pWriteBuf = NULL;
-    bls.writeBufTotalSize = 0;
+    bls.txQueueHead = 0;
+    bls.txQueueCount = 0;
+    bls.writeBufCurrentSize = 0;
+    bls.writeBufTransmittedSize = 0;
+    bls.writeBufNextSize = 0;
 
 #ifndef WITHOUT_ESCAPE_SEQUENCE
     bls.escEnabled = cbESC_getAtOverAirEnabled();
@@ -290,24 +357,18 @@ Status_t cbBLS_registerCallbacks(cbBLS_Callbacks *pCallb)
 *-------------------------------------------------------------------------*/
 Status_t cbBLS_open(uint8 port, void* pCfg)
 {
-  uint8 result;
   cb_ASSERT(port == cbBLS_PORT_0);
 
   switch (bls.state)
   {
   case cbBLS_S_CLOSED:
-    if (bls.bufId == UNITIALIZED_BUF_ID)
+    if (bls.spsRegistered == FALSE)
     {
       /* First time only */
-      result = cbBUF_open(cbBLS_BUFFER_SIZE, 0, 0, &bls.bufId);    
-      cb_ASSERT(result == cbBUF_OK);
-#ifndef CB_CENTRAL
-      cbSPS_register(&serialServiceCallbacks);
-#endif
+      bls.spsRegistered = TRUE;
+      spsRegister(&serialServiceCallbacks);
     }
-#ifndef CB_CENTRAL
-    cbSPS_enable();
-#endif
+    spsEnable();
 
     bls.state = cbBLS_S_IDLE;
     break;
@@ -335,7 +396,7 @@ Status_t cbBLS_close(uint8 port)
   switch (bls.state)
   {
   case cbBLS_S_CONNECTED:
-    cbSPS_disable();
+    spsDisable();
     /* In connected state, the disconnect callback is expected */
     bls.state = cbBLS_S_CLOSING;
     break;
@@ -343,12 +404,12 @@ Status_t cbBLS_close(uint8 port)
   case cbBLS_S_WAIT_CONNECT:
       osal_CbTimerStop(bls.connTimerId);
 
-      bls.pWriteBuf = NULL;
+      bls.txQueueCount = 0;
       bls.writeBufCurrentSize = 0;
 
       /* Fall through */
   case cbBLS_S_IDLE:
-    cbSPS_disable();
+    spsDisable();
     /* In idle state, the service is immediately disabled */
     bls.state = cbBLS_S_CLOSED;
     break;
@@ -371,10 +432,7 @@ Status_t cbBLS_write(uint8 port,
                      uint16 bufSize)
 {
   int16   result = SUCCESS;
-  int16   res;
 
-#ifndef CB_CENTRAL
-  
   cb_ASSERT(port == cbBLS_PORT_0);
   cb_ASSERT((pBuf != NULL) && (bufSize > 0));
 
@@ -382,49 +440,20 @@ Status_t cbBLS_write(uint8 port,
   switch(bls.state)
   {
   case cbBLS_S_CONNECTED:
-    switch (bls.txState)
-    {
-    case cbBLS_S_TX_IDLE:
-      {
-        if (bufSize > cbSPS_FIFO_SIZE)
-        {
-          bls.writeBufCurrentSize = cbSPS_FIFO_SIZE;
-        }
-        else
-        {
-          bls.writeBufCurrentSize = bufSize;
-        }
-
-        bls.writeBufTransmittedSize = 0;
-
-        res = cbSPS_reqData(
-          bls.connHandle,
-          pBuf, 
-          bls.writeBufCurrentSize);
+    result = txEnqueue(pBuf, bufSize);
 
-        if(res == SUCCESS)
-        {
+    if ((result == SUCCESS) && (bls.txState == cbBLS_S_TX_IDLE))
+    {
 #ifndef WITHOUT_BLS_WATCHDOGS    
-          kickInactivityTimeoutWd();
-          startWriteTimeoutWd();
+      kickInactivityTimeoutWd();
 #endif
-          bls.pWriteBuf = pBuf;
-          bls.writeBufTotalSize = bufSize;
-
-          bls.txState = cbBLS_S_TX_IN_PROGRESS;
-        }
-        else
-        {
-          bls.writeBufCurrentSize = 0;
-          result = FAILURE;
-        }
+      result = txSendNext();
+      if (result != SUCCESS)
+      {
+        // Remove the buffer again, any other queued buffers are thrown 
+        // away on disconnect
+        bls.txQueueCount--;
       }
-      break;   
-          
-    case cbBLS_S_TX_IN_PROGRESS:
-    default:
-      cb_ASSERT(FALSE);
-      break;
     }
     break;
 
@@ -433,24 +462,55 @@ Status_t cbBLS_write(uint8 port,
 
       if (result == SUCCESS)
       {
-          bls.pWriteBuf = pBuf;
-          bls.writeBufTotalSize = bufSize;
+          result = txEnqueue(pBuf, bufSize);
+          cb_ASSERT(result == SUCCESS);
+
           bls.state = cbBLS_S_WAIT_CONNECT;
 
           osal_CbTimerStart(connTimeout, NULL, cbBLS_CONNECTION_TIMEOUT, &(bls.connTimerId));
       }
     break;
 
+  case cbBLS_S_WAIT_CONNECT:
+      // Sent when connected
+      result = txEnqueue(pBuf, bufSize);
+      break;
+
   default:
     result = FAILURE;
     break;
   }
 
-#endif 
-  
   return result;
 }
 
+/*---------------------------------------------------------------------------
+* Get a buffer in which the next fifo packet can be built in place. The
+* data is sent by calling cbBLS_write with the slot, no other data may be
+* written in between. Only available when connected and no writes are 
+* pending.
+*-------------------------------------------------------------------------*/
+Status_t cbBLS_getTxSlot(uint8 port, uint8 **ppBuf, uint16 *pBufSize)
+{
+  uint8 size = 0;
+
+  cb_ASSERT(port == cbBLS_PORT_0);
+  cb_ASSERT((ppBuf != NULL) && (pBufSize != NULL));
+
+  *ppBuf = NULL;
+
+  if ((bls.state == cbBLS_S_CONNECTED) &&
+      (bls.txState == cbBLS_S_TX_IDLE) &&
+      (bls.txQueueCount == 0))
+  {
+    *ppBuf = spsGetTxSlot(bls.connHandle, &size);
+  }
+
+  *pBufSize = size;
+
+  return (*ppBuf != NULL) ? SUCCESS : FAILURE;
+}
+
 /*---------------------------------------------------------------------------
 * Description of function. Optional verbose description.
 *-------------------------------------------------------------------------*/
@@ -461,6 +521,14 @@ Status_t cbBLS_getReadBuf(uint8 port, uint8** ppBuf, uint16* pBufSize)
   cb_ASSERT(port == cbBLS_PORT_0);
   cb_ASSERT(pBufSize != NULL);
 
+  if (bls.bufId == UNITIALIZED_BUF_ID)
+  {
+    // No rx buffer when not connected
+    *ppBuf = NULL;
+    *pBufSize = 0;
+    return FAILURE;
+  }
+
   result = cbBUF_getReadBuf(bls.bufId, ppBuf, pBufSize);
 
   if(result != cbBUF_OK)
@@ -483,72 +551,103 @@ Status_t cbBLS_getReadBuf(uint8 port, uint8** ppBuf, uint16* pBufSize)
 }
 
 /*---------------------------------------------------------------------------
-* Description of function. Optional verbose description.
+* Gets all received data as two segments, the second one is used when the
+* data continues after the rx buffer wrap-around. Consumed with 
+* cbBLS_readBufConsumed.
 *-------------------------------------------------------------------------*/
-Status_t cbBLS_readBufConsumed(uint8 port, uint16 nBytes)
+Status_t cbBLS_getReadVec(uint8 port, cbBUF_Seg *pSeg)
 {
-  int16   result;
-  bool    empty;
+  Status_t result = SUCCESS;
 
   cb_ASSERT(port == cbBLS_PORT_0);
-  cb_ASSERT(nBytes != 0);
+  cb_ASSERT(pSeg != NULL);
 
-  if (bls.state == cbBLS_S_CONNECTED)
+  if (bls.bufId == UNITIALIZED_BUF_ID)
   {
-    result = cbBUF_readBufConsumed(bls.bufId, nBytes);
-    cb_ASSERT(result == cbBUF_OK); 
+    // No rx buffer when not connected
+    return FAILURE;
+  }
 
-    updateRemainingBufSize();
+  result = cbBUF_getReadVec(bls.bufId, pSeg);
 
-    switch (bls.rxState)
+  if(result != cbBUF_OK)
+  {
+    // RX buffer empty
+    switch(bls.rxState)
     {
     case cbBLS_S_RX_DATA_AVAILABLE:
     case cbBLS_S_RX_BUF_FULL:
-      empty = cbBUF_isBufferEmpty(bls.bufId);
-      if(empty == TRUE)
-      {
-        bls.rxState = cbBLS_S_RX_BUF_EMPTY;
-      }
-      else
-      {
-        bls.rxState = cbBLS_S_RX_DATA_AVAILABLE;
-      }
+      bls.rxState = cbBLS_S_RX_BUF_EMPTY;        
       break;
-  
+
     default:
-      cb_ASSERT(FALSE);
+      /* Ignore */
       break;
     }
   }
 
+  return result;
+}
+
+#ifndef WITHOUT_BUF_STATS
+/*---------------------------------------------------------------------------
+* Gets the rx buffer statistics of the current link.
+*-------------------------------------------------------------------------*/
+Status_t cbBLS_getRxBufStats(uint8 port, cbBUF_Stats *pStats)
+{
+  cb_ASSERT(port == cbBLS_PORT_0);
+
+  if (bls.bufId == UNITIALIZED_BUF_ID)
+  {
+    // No rx buffer when not connected
+    return FAILURE;
+  }
+
+  cbBUF_getStats(bls.bufId, pStats);
+
   return SUCCESS;
 }
+#endif
 
 /*---------------------------------------------------------------------------
- * Description of function. Optional verbose description.
- *-------------------------------------------------------------------------*/
-Status_t cbBLS_readByte(uint8 port, uint8* pByte)
+* Description of function. Optional verbose description.
+*-------------------------------------------------------------------------*/
+Status_t cbBLS_readBufConsumed(uint8 port, uint16 nBytes)
 {
-    Status_t   res;
-    uint8*  pBuf;
-    uint16  nBytes;
+  int16   result;
 
-    cb_ASSERT(port == cbBLS_PORT_0);
+  cb_ASSERT(port == cbBLS_PORT_0);
+  cb_ASSERT(nBytes != 0);
 
-    res = cbBLS_getReadBuf(port, &pBuf, &nBytes);
+  if (bls.state == cbBLS_S_CONNECTED)
+  {
+    // Handles data consumed from both cbBLS_getReadBuf and cbBLS_getReadVec
+    result = cbBUF_readVecConsumed(bls.bufId, nBytes);
+    cb_ASSERT(result == cbBUF_OK); 
 
-    if(res == SUCCESS)
-    {
-        cb_ASSERT(nBytes > 0);
-        cb_ASSERT(pBuf != NULL);
+    rxDataConsumed(nBytes);
+  }
 
-        *pByte = pBuf[0];
+  return SUCCESS;
+}
 
-        res = cbBLS_readBufConsumed(port, 1);
-        cb_ASSERT(res == SUCCESS);
+/*---------------------------------------------------------------------------
+ * A single byte is cheaper to take with cbBUF_readByte than with the 
+ * bulk cbBUF_read.
+ *-------------------------------------------------------------------------*/
+Status_t cbBLS_readByte(uint8 port, uint8* pByte)
+{
+    cb_ASSERT(port == cbBLS_PORT_0);
+
+    if ((bls.state != cbBLS_S_CONNECTED) || 
+        (cbBUF_readByte(bls.bufId, pByte) != cbBUF_OK))
+    {
+        return FAILURE;
     }
 
-    return res;
+    rxDataConsumed(1);
+
+    return SUCCESS;
 }
 
 /*---------------------------------------------------------------------------
@@ -623,7 +722,7 @@ void spsDataEventCallback(uint16 connHandle, uint8 *pBuf, uint8 nBytes)
     bool isEscData = FALSE;
 
     cb_ASSERT(pBuf != NULL);
-    cb_ASSERT((nBytes > 0) && (nBytes <= cbSPS_FIFO_SIZE));        
+    cb_ASSERT((nBytes > 0) && (nBytes <= cbSPS_MAX_FIFO_SIZE));        
 
 #ifndef WITHOUT_ESCAPE_SEQUENCE
     if (bls.escEnabled == TRUE)
@@ -666,8 +765,11 @@ void spsDataEventCallback(uint16 connHandle, uint8 *pBuf, uint8 nBytes)
 *-------------------------------------------------------------------------*/
 static void spsDataConfCallback(uint16 connHandle)
 {
-    uint8 res;
-    uint16 size;
+    Status_t res;
+    uint16 nextSize;
+    uint16 doneSize[2];
+    uint8  nDone = 0;
+    uint8  i;
 
     cb_ASSERT(bls.state == cbBLS_S_CONNECTED || bls.state == cbBLS_S_CLOSING);
 
@@ -675,57 +777,47 @@ static void spsDataConfCallback(uint16 connHandle)
   {
   case cbBLS_S_TX_IN_PROGRESS:
     cb_ASSERT(bls.writeBufCurrentSize != 0);
+    cb_ASSERT(bls.txQueueCount > 0);
 
 #ifndef WITHOUT_BLS_WATCHDOGS    
     stopWriteTimeoutWd();
 #endif
 
     bls.writeBufTransmittedSize += bls.writeBufCurrentSize;
-
-    if (bls.writeBufTotalSize == bls.writeBufTransmittedSize)
+    nextSize = bls.writeBufNextSize;
+    bls.writeBufCurrentSize = 0;
+    bls.writeBufNextSize = 0;
+    bls.txState = cbBLS_S_TX_IDLE;
+
+    // The packet may have completed both the head buffer and the next one
+    while ((bls.txQueueCount > 0) && 
+           (bls.txQueue[bls.txQueueHead].size == bls.writeBufTransmittedSize))
     {
-        size = bls.writeBufTotalSize;
-        bls.pWriteBuf = NULL;
-        bls.writeBufTotalSize = 0;
-        bls.txState = cbBLS_S_TX_IDLE;
+        cb_ASSERT(nDone < 2);
 
-        blsCallbackNotifyWriteComplete(cbBLS_PORT_0, size);
+        doneSize[nDone] = bls.writeBufTransmittedSize;
+        nDone++;
+
+        bls.txQueueHead = (bls.txQueueHead + 1) % cbBLS_TX_QUEUE_SIZE;
+        bls.txQueueCount--;
+        bls.writeBufTransmittedSize = nextSize;
+        nextSize = 0;
     }
-    else
-    {
-        // Write next part of buffer
-        uint16 bufSize = bls.writeBufTotalSize - bls.writeBufTransmittedSize;
-                
-        if (bufSize > cbSPS_FIFO_SIZE)
-        {
-            bls.writeBufCurrentSize = cbSPS_FIFO_SIZE;
-        }
-        else
-        {
-            bls.writeBufCurrentSize = bufSize;
-        }
+    cb_ASSERT(nextSize == 0);
 
-        res = cbSPS_reqData(
-            bls.connHandle,
-            &bls.pWriteBuf[bls.writeBufTransmittedSize], 
-            bls.writeBufCurrentSize);
+    // The callback may write a new buffer which then is started directly
+    for (i = 0; i < nDone; i++)
+    {
+        blsCallbackNotifyWriteComplete(cbBLS_PORT_0, doneSize[i]);
+    }
 
-        if(res == SUCCESS)
-        {
-#ifndef WITHOUT_BLS_WATCHDOGS    
-            startWriteTimeoutWd();
-#endif
-            bls.txState = cbBLS_S_TX_IN_PROGRESS;
-        }
-        else
+    if ((bls.txState == cbBLS_S_TX_IDLE) && (bls.txQueueCount > 0))
+    {
+        // Write next part of buffer or next queued buffer
+        res = txSendNext();
+        if (res != SUCCESS)
         {
-            size = bls.writeBufTransmittedSize;
-            
-            bls.pWriteBuf = NULL;
-            bls.writeBufTotalSize = 0;
-            bls.txState = cbBLS_S_TX_IDLE;
-
-            blsCallbackNotifyWriteComplete(cbBLS_PORT_0, size);
+            txFlush();
         }
     }
     break;
@@ -743,9 +835,12 @@ static void spsDataConfCallback(uint16 connHandle)
 void spsConnectCallback(uint16 connHandle)
 {
   Status_t  status = SUCCESS;
-  bool      empty;
 
+  // The rx buffer watermarks are set from the fifo size of the link
   bls.connHandle = connHandle;
+
+  openRxBuf();
+
   bls.txState = cbBLS_S_TX_IDLE;
   bls.rxState = cbBLS_S_RX_BUF_EMPTY;
   
@@ -771,9 +866,12 @@ void spsConnectCallback(uint16 connHandle)
 
       osal_CbTimerStop(bls.connTimerId);
 
-      if (bls.pWriteBuf != NULL)
+      if (bls.txQueueCount > 0)
       {
-          status = cbBLS_write(cbBLS_PORT_0, bls.pWriteBuf, bls.writeBufTotalSize);
+#ifndef WITHOUT_BLS_WATCHDOGS    
+          kickInactivityTimeoutWd();
+#endif
+          status = txSendNext();
       }
       break;
 
@@ -786,27 +884,17 @@ void spsConnectCallback(uint16 connHandle)
       break;
   }
 
-  empty = cbBUF_isBufferEmpty(bls.bufId);
-
-  if (empty == FALSE)
-  {
-      bls.rxState = cbBLS_S_RX_DATA_AVAILABLE;
-  }    
-
   updateRemainingBufSize();
 
 #ifndef WITHOUT_BLS_WATCHDOGS    
   startConnectionTimeoutWd();
 #endif
 
-  if (status == FAILURE)
+  if (status != SUCCESS)
   {
-      /* Write error */
-      bls.pWriteBuf = NULL;
-      bls.writeBufTotalSize = 0;
-
-      /* Call WriteComplete in order to throw away the pending buffer and proceed. */
-      blsCallbackNotifyWriteComplete(cbBLS_PORT_0, bls.writeBufTotalSize);
+      /* Write error. Call WriteComplete in order to throw away the pending 
+         buffers and proceed. */
+      txFlush();
   }
 }
 
@@ -829,7 +917,7 @@ static cbBLS_State entryIdle(void)
 {    
   cbBLS_State state = cbBLS_S_IDLE;
   resetLink();
-  cbBUF_clear(bls.bufId);
+  closeRxBuf();
   
   return state;
 }
@@ -843,8 +931,10 @@ static void updateRemainingBufSize(void)
   Status_t status;
 
   remBufSize = cbBUF_getNoFreeBytes(bls.bufId);
-  status = cbSPS_setRemainingBufSize(bls.connHandle, remBufSize);
+  status = spsSetRemainingBufSize(bls.connHandle, remBufSize);
   cb_ASSERT(status == FALSE);
+
+  bls.rxUnreported = 0;
 }
 
 
@@ -853,8 +943,6 @@ static void updateRemainingBufSize(void)
 *-------------------------------------------------------------------------*/
 static void disconnect(void)
 {
-  bool      writeCnf = FALSE;
-  
 #ifndef WITHOUT_ESCAPE_SEQUENCE
   // Stop escape timers
   osal_CbTimerStop(bls.escTimerId);
@@ -876,11 +964,6 @@ static void disconnect(void)
   {
   case cbBLS_S_CONNECTED:
 
-    if(bls.txState == cbBLS_S_TX_IN_PROGRESS)
-    {
-      writeCnf = TRUE;
-    }            
-
     bls.rxState = cbBLS_S_INVALID;
     bls.txState = cbBLS_S_INVALID;
 
@@ -890,11 +973,7 @@ static void disconnect(void)
     
     bls.state = entryIdle();
 
-    if(writeCnf == TRUE)
-    {
-      blsCallbackNotifyWriteComplete(cbBLS_PORT_0, 0);
-      bls.writeBufCurrentSize = 0;
-    }   
+    txFlush();
     break;
 
   case cbBLS_S_CLOSING:
@@ -908,8 +987,12 @@ static void disconnect(void)
 #endif
     
     resetLink();
-    cbBUF_clear(bls.bufId);
+    closeRxBuf();
 
+    bls.txQueueCount = 0;
+    bls.writeBufCurrentSize = 0;
+    bls.writeBufTransmittedSize = 0;
+    bls.writeBufNextSize = 0;
     break;
 
   default:
@@ -924,8 +1007,6 @@ static void disconnect(void)
 *-------------------------------------------------------------------------*/
 static void resetLink(void)
 {
-  bls.pWriteBuf = NULL;
-  bls.writeBufTotalSize = 0;
   bls.connHandle = INVALID_CONNHANDLE;
 }
 #ifndef WITHOUT_ESCAPE_SEQUENCE
@@ -1057,13 +1138,17 @@ static bool checkEsc(uint8* pData, int16 nBytes)
 *-------------------------------------------------------------------------*/
 static void abortEsc(uint8 nBytes)
 {
-    uint8 res;
+    uint8   escBuf[cbESC_NUM_ESCAPE_CHARS];
+    uint16  res;
     
-    for (uint8 i = 0; i < nBytes; i ++)
-    {
-        res = cbBUF_writeByte(bls.bufId, bls.escChar);
-        cb_ASSERT(res == cbBUF_OK);
-    }
+    cb_ASSERT(nBytes <= cbESC_NUM_ESCAPE_CHARS);
+
+    closeRxWriteBuf();
+
+    osal_memset(escBuf, bls.escChar, nBytes);
+
+    res = cbBUF_write(bls.bufId, escBuf, nBytes);
+    cb_ASSERT(res == nBytes);
 
     bls.nEscBytes = 0;
 }
@@ -1180,44 +1265,127 @@ static void postEscTimeout(uint8* pData)
 static void copyDataToBuf(int16 bufId, uint8* pData, int16 nBytes)
 {
   int16   res;
-  uint8*  pBuf;
-  uint16  bufSize;
-  int16   n = 0;
+  uint16  n;
   bool    done = FALSE;
 
   while(!done)
   {
-    res = cbBUF_getWriteBuf(bufId, &pBuf, &bufSize);
-    if(res == cbBUF_OK)
+    if (bls.rxWriteBufSize == 0)
     {
-      if(bufSize >= nBytes)
+      res = cbBUF_getWriteBuf(bufId, &bls.pRxWriteBuf, &bls.rxWriteBufSize);
+      if(res != cbBUF_OK)
       {
-        osal_memcpy(pBuf, &(pData[n]), nBytes);
+        /* Buffer overflow. Data lost!!!!!! */
+        cbBUF_dataDropped(bufId, nBytes);
+        spsAddLostBytes(bls.connHandle, nBytes);
+        bls.pRxWriteBuf = NULL;
+        bls.rxWriteBufSize = 0;
+        break;
+      }
+    }
 
-        res = cbBUF_writeBufProduced(bufId, nBytes);
-        cb_ASSERT(res == SUCCESS);
+    n = MIN(bls.rxWriteBufSize, (uint16)nBytes);
 
-        updateRemainingBufSize();
-        done = TRUE;
-      }
-      else
-      {
-        osal_memcpy(pBuf, &(pData[n]), bufSize);
+    osal_memcpy(bls.pRxWriteBuf, pData, n);
 
-        n += bufSize;
-        nBytes -= bufSize;
+    res = cbBUF_writeBufProducedCont(bufId, n);
+    cb_ASSERT(res == cbBUF_OK);
 
-        res = cbBUF_writeBufProduced(bufId, bufSize);
-        cb_ASSERT(res == SUCCESS);
-        
-        updateRemainingBufSize();
-      }
+    bls.pRxWriteBuf += n;
+    bls.rxWriteBufSize -= n;
+    pData += n;
+    nBytes -= n;
+
+    if (bls.rxWriteBufSize == 0)
+    {
+      /* Return the filled write buffer, this performs the wrap-around */
+      closeRxWriteBuf();
+    }
+
+    done = (nBytes == 0);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Take the rx buffer from the buffer pool when a link is connected.
+*-------------------------------------------------------------------------*/
+static void openRxBuf(void)
+{
+  uint8 result;
+
+  if (bls.bufId == UNITIALIZED_BUF_ID)
+  {
+    result = cbBUF_openBip(cbBLS_BUFFER_SIZE, 0, &bls.bufId);
+    cb_ASSERT(result == cbBUF_OK);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Give the rx buffer back to the buffer pool when the link is disconnected.
+* Received data that has not been read is thrown away.
+*-------------------------------------------------------------------------*/
+static void closeRxBuf(void)
+{
+  closeRxWriteBuf();
+
+  if (bls.bufId != UNITIALIZED_BUF_ID)
+  {
+    cbBUF_close(bls.bufId);
+    bls.bufId = UNITIALIZED_BUF_ID;
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Return the rx write buffer kept allocated by copyDataToBuf. Must be done 
+* before the buffer is written by any other function.
+*-------------------------------------------------------------------------*/
+static void closeRxWriteBuf(void)
+{
+  uint8 res;
+
+  if (bls.pRxWriteBuf != NULL)
+  {
+    res = cbBUF_writeBufProduced(bls.bufId, 0);
+    cb_ASSERT(res == cbBUF_OK);
+
+    bls.pRxWriteBuf = NULL;
+    bls.rxWriteBufSize = 0;
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Update the rx state after data has been consumed from the rx buffer.
+* The free size is reported once enough has been consumed, see
+* cbBLS_RX_REPORT_SIZE.
+*-------------------------------------------------------------------------*/
+static void rxDataConsumed(uint16 nBytes)
+{
+  bool empty;
+
+  bls.rxUnreported += nBytes;
+  if (bls.rxUnreported >= cbBLS_RX_REPORT_SIZE)
+  {
+    updateRemainingBufSize();
+  }
+
+  switch (bls.rxState)
+  {
+  case cbBLS_S_RX_DATA_AVAILABLE:
+  case cbBLS_S_RX_BUF_FULL:
+    empty = cbBUF_isBufferEmpty(bls.bufId);
+    if(empty == TRUE)
+    {
+      bls.rxState = cbBLS_S_RX_BUF_EMPTY;
     }
     else
     {
-      /* Buffer overflow. Data lost!!!!!! */
-      done = TRUE; 
+      bls.rxState = cbBLS_S_RX_DATA_AVAILABLE;
     }
+    break;
+
+  default:
+    cb_ASSERT(FALSE);
+    break;
   }
 }
 
@@ -1229,11 +1397,115 @@ static void connTimeout(uint8* idp)
     cb_ASSERT(bls.state == cbBLS_S_WAIT_CONNECT);
 
     bls.state = cbBLS_S_IDLE;
-    bls.pWriteBuf = NULL;
-    bls.writeBufTotalSize = 0;
 
-    /* Call WriteComplete in order to throw away the pending buffer and proceed. */
-    blsCallbackNotifyWriteComplete(cbBLS_PORT_0, bls.writeBufTotalSize);
+    /* Call WriteComplete in order to throw away the pending buffers and proceed. */
+    txFlush();
+}
+
+/*---------------------------------------------------------------------------
+* Add a buffer to the end of the tx queue.
+*-------------------------------------------------------------------------*/
+static Status_t txEnqueue(uint8 *pBuf, uint16 bufSize)
+{
+    Status_t result = FAILURE;
+    uint8    i;
+
+    if (bls.txQueueCount < cbBLS_TX_QUEUE_SIZE)
+    {
+        i = (bls.txQueueHead + bls.txQueueCount) % cbBLS_TX_QUEUE_SIZE;
+
+        bls.txQueue[i].pBuf = pBuf;
+        bls.txQueue[i].size = bufSize;
+        bls.txQueueCount++;
+
+        result = SUCCESS;
+    }
+
+    return result;
+}
+
+/*---------------------------------------------------------------------------
+* Request the next part of the head buffer in the tx queue to be sent.
+*-------------------------------------------------------------------------*/
+static Status_t txSendNext(void)
+{
+    Status_t    res;
+    cbBLS_TxBuf *pTx;
+    cbBLS_TxBuf *pNext = NULL;
+    uint16      bufSize;
+    uint8       fifoSize = spsGetFifoSize(bls.connHandle);
+
+    cb_ASSERT(bls.txQueueCount > 0);
+    cb_ASSERT(bls.txState == cbBLS_S_TX_IDLE);
+
+    pTx = &bls.txQueue[bls.txQueueHead];
+    bufSize = pTx->size - bls.writeBufTransmittedSize;
+
+    if (bufSize > fifoSize)
+    {
+        bls.writeBufCurrentSize = fifoSize;
+        bls.writeBufNextSize = 0;
+    }
+    else
+    {
+        bls.writeBufCurrentSize = bufSize;
+        bls.writeBufNextSize = 0;
+
+        // Fill up the packet with the start of the next buffer
+        if (bls.txQueueCount > 1)
+        {
+            pNext = &bls.txQueue[(bls.txQueueHead + 1) % cbBLS_TX_QUEUE_SIZE];
+            bls.writeBufNextSize = MIN(pNext->size, (uint16)(fifoSize - bufSize));
+        }
+    }
+
+    res = spsReqDataVec(
+        bls.connHandle,
+        &pTx->pBuf[bls.writeBufTransmittedSize], 
+        bls.writeBufCurrentSize,
+        (bls.writeBufNextSize != 0) ? pNext->pBuf : NULL,
+        bls.writeBufNextSize);
+
+    if (res == SUCCESS)
+    {
+#ifndef WITHOUT_BLS_WATCHDOGS    
+        startWriteTimeoutWd();
+#endif
+        bls.txState = cbBLS_S_TX_IN_PROGRESS;
+    }
+    else
+    {
+        bls.writeBufCurrentSize = 0;
+        bls.writeBufNextSize = 0;
+    }
+
+    return res;
+}
+
+/*---------------------------------------------------------------------------
+* Throw away all queued buffers. WriteComplete is called for every buffer,
+* the head buffer with the transmitted size and the rest with size 0.
+*-------------------------------------------------------------------------*/
+static void txFlush(void)
+{
+    uint8  n = bls.txQueueCount;
+    uint16 size = bls.writeBufTransmittedSize;
+
+    // Reset the queue first since the callbacks may write new buffers
+    bls.txQueueCount = 0;
+    bls.writeBufCurrentSize = 0;
+    bls.writeBufTransmittedSize = 0;
+    bls.writeBufNextSize = 0;
+    if (bls.txState == cbBLS_S_TX_IN_PROGRESS)
+    {
+        bls.txState = cbBLS_S_TX_IDLE;
+    }
+
+    for (; n > 0; n--)
+    {
+        blsCallbackNotifyWriteComplete(cbBLS_PORT_0, size);
+        size = 0;
+    }
 }
 
 #ifndef WITHOUT_BLS_WATCHDOGS    
@@ -1340,8 +1612,8 @@ static void wdTimeout(uint8* pData)
 
      // Disconnect
      // TODO: Is this the correct way to do it?
-     cbSPS_disable();
-     cbSPS_enable();
+     spsDisable();
+     spsEnable();
 }
 #endif
 /*---------------------------------------------------------------------------
@@ -10,7 +10,9 @@
 
 #include "comdef.h"
 #include "hal_types.h"
+#ifndef cbBUF_MEMCPY
 #include "OSAL.h"
+#endif
 
 #include "cb_assert.h"
 #include "cb_buffer.h"
@@ -19,15 +21,50 @@
 * DEFINES
 *=========================================================================*/
 
-/* Total number and size of all buffers */
+/* Memory functions. Both may be replaced, e.g. with the C library 
+   functions when the buffer is built for a host without OSAL. */
+#ifndef cbBUF_MEMCPY
+#define cbBUF_MEMCPY(pDst, pSrc, len)   osal_memcpy((pDst), (pSrc), (len))
+#define cbBUF_MEMSET(pDst, value, len)  osal_memset((pDst), (value), (len))
+#endif
+
+/* Buffer pool. The pool is divided into slabs with a fixed layout, the
+   slab sizes must be given in increasing order. A buffer is opened in the
+   smallest free slab that is big enough. cbBUF_SLABS calls SLAB once for
+   every slab size, the number of slabs and their total size are derived
+   from it. */
+#ifndef cbBUF_SLABS
+#define cbBUF_SLABS(SLAB)   SLAB(64) SLAB(64) SLAB(cbBUF_LARGE_SLAB_SIZE)
+#endif
+
+#define cbBUF_SLAB_COUNT(size)  + 1
+#define cbBUF_SLAB_SUM(size)    + (size)
+#define cbBUF_SLAB_INIT(size)   (size),
+
+#define cbBUF_NUM_SLABS     (0 cbBUF_SLABS(cbBUF_SLAB_COUNT))
+#define cbBUF_SLABS_SIZE    (0 cbBUF_SLABS(cbBUF_SLAB_SUM))
+
+/* Number of buffers that can be open at the same time. More slabs than 
+   buffers may be given, a buffer then has more slab sizes to choose from. 
+   Set to cbBUF_NUM_SLABS to be able to use all slabs at once. */
 #ifndef cbBUF_MAX_BUFFERS
 #define cbBUF_MAX_BUFFERS   ((uint16)2)
 #endif
 
+/* Size of the memory of all slabs */
 #ifndef cbBUF_SIZE
-#define cbBUF_SIZE (128 + 200)
+#define cbBUF_SIZE          cbBUF_SLABS_SIZE
 #endif
 
+/* Slab owner when the slab is not used by any buffer */
+#define cbBUF_SLAB_FREE     (0)
+
+/* Buffer modes */
+#define cbBUF_MODE_CIRCULAR (0) /* cbBUF_open */
+#define cbBUF_MODE_BIP      (1) /* cbBUF_openBip */
+#define cbBUF_MODE_RECORD   (2) /* cbBUF_openRecord */
+#define cbBUF_MODE_OVERWRITE (3) /* cbBUF_openOverwrite */
+
 /*===========================================================================
 * TYPES
 *=========================================================================*/
@@ -55,25 +92,74 @@ typedef struct
     uint16       minReturnSize;
     uint16       reservedSize;
 
+    uint8        mode;
+
+    uint8        slab; /* Pool slab used by the buffer */
+
+#ifndef WITHOUT_BUF_OVERWRITE
+    uint32       bytesEvicted; /* Overwritten by producer in overwrite mode */
+#endif
+
+#ifndef WITHOUT_BUF_STATS
+    cbBUF_Stats  stats;
+#endif
+
+#ifndef WITHOUT_BUF_WATERMARKS
+    /* Watermarks, see cbBUF_setWatermarks */
+    cbBUF_WatermarkCallback wmCallback;
+    uint16       highWatermark;
+    uint16       lowWatermark;
+    bool         aboveHighWatermark;
+#endif
+
 } cbBUF_Adm;
 
 typedef struct
 {
     cbBUF_Adm   buf[cbBUF_MAX_BUFFERS]; 
-    uint16      usedSize;
+    uint8       slabOwner[cbBUF_NUM_SLABS]; /* Buffer id + 1 or cbBUF_SLAB_FREE */
     uint8       nbrOfOpenedBuffers;
 } cbBUF_Class;
 
 /*===========================================================================
 * DECLARATIONS
 *=========================================================================*/
+static uint8 openBuf(
+    uint16 size, 
+    uint16 minReturnSize,
+    uint16 reservedSize,
+    uint8 mode,
+    uint8 *pBufferId);
+static void startStoring(uint8 id);
+static void startReading(uint8 id);
+static void prepareBipWrite(uint8 id);
+#ifndef WITHOUT_BUF_OVERWRITE
+static void makeRoom(uint8 id, uint16 nBytes);
+static void evictData(uint8 id, uint16 nBytes);
+#endif
+static uint8 allocSlab(uint16 size);
+static uint16 getSlabOffset(uint8 slab);
+static void consumeData(uint8 id, uint16 nBytes);
+static void moveReadIndex(uint8 id, uint16 nBytes);
+static void resetStats(uint8 id);
+#ifndef WITHOUT_BUF_WATERMARKS
+static void checkHighWatermark(uint8 id);
+static void checkLowWatermark(uint8 id);
+#endif
+#ifndef WITHOUT_BUF_STATS
+static void statsProduced(uint8 id, uint16 nBytes);
+#endif
 
 /*===========================================================================
 * DEFINITIONS
 *=========================================================================*/
 // Filename used by cb_ASSERT macro
-static const char *file = "cb_serial.c";
+static const char *file = "cb_buffer.c";
 static uint8 circBuffer[cbBUF_SIZE];
+static const uint16 slabSize[cbBUF_NUM_SLABS] = { cbBUF_SLABS(cbBUF_SLAB_INIT) };
+
+// Fails to compile if the slabs do not fit in the buffer memory
+typedef char cbBUF_SlabsSizeCheck[(cbBUF_SLABS_SIZE <= cbBUF_SIZE) ? 1 : -1];
 static cbBUF_Class cBuf;
 
 /*===========================================================================
@@ -89,7 +175,11 @@ uint8 cbBUF_init(void)
         cBuf.buf[i].state = cbBUF_S_CLOSED;
     }
 
-    cBuf.usedSize            = 0;
+    for (i = 0; i < cbBUF_NUM_SLABS; i++)
+    {
+        cBuf.slabOwner[i] = cbBUF_SLAB_FREE;
+    }
+
     cBuf.nbrOfOpenedBuffers  = 0;
 
     return cbBUF_OK;
@@ -102,14 +192,69 @@ uint8 cbBUF_open(
     uint16 reservedSize,
     uint8 *pBufferId)
 {
-    uint8 id = cBuf.nbrOfOpenedBuffers;
+    return openBuf(size, minReturnSize, reservedSize, cbBUF_MODE_CIRCULAR, pBufferId);
+}
+
+uint8 cbBUF_openBip(
+    uint16 size, 
+    uint16 minReturnSize,
+    uint8 *pBufferId)
+{
+    return openBuf(size, minReturnSize, 0, cbBUF_MODE_BIP, pBufferId);
+}
+
+uint8 cbBUF_openRecord(
+    uint16 size, 
+    uint8 *pBufferId)
+{
+    return openBuf(size, 0, 0, cbBUF_MODE_RECORD, pBufferId);
+}
+
+#ifndef WITHOUT_BUF_OVERWRITE
+uint8 cbBUF_openOverwrite(
+    uint16 size, 
+    uint16 minReturnSize,
+    uint8 *pBufferId)
+{
+    cb_ASSERT(minReturnSize <= size);
+
+    return openBuf(size, minReturnSize, 0, cbBUF_MODE_OVERWRITE, pBufferId);
+}
+#endif
+
+static uint8 openBuf(
+    uint16 size, 
+    uint16 minReturnSize,
+    uint16 reservedSize,
+    uint8 mode,
+    uint8 *pBufferId)
+{
+    uint8 id = 0;
+    uint8 slab = cbBUF_NUM_SLABS;
+
+    /* Find a closed buffer and a free slab */
+    while ((id < cbBUF_MAX_BUFFERS) && (cBuf.buf[id].state != cbBUF_S_CLOSED))
+    {
+        id++;
+    }
+
+    if (id < cbBUF_MAX_BUFFERS)
+    {
+        slab = allocSlab(size);
+    }
+
+    if (slab == cbBUF_NUM_SLABS)
+    {
+        *pBufferId = cbBUF_MAX_BUFFERS;
+        return cbBUF_ERROR;
+    }
 
     *pBufferId = id;
 
-    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
-    cb_ASSERT((size + cBuf.usedSize) <= cbBUF_SIZE);
+    cBuf.slabOwner[slab] = id + 1;
 
-    cBuf.buf[id].data = &(circBuffer[cBuf.usedSize]);
+    cBuf.buf[id].slab = slab;
+    cBuf.buf[id].data = &(circBuffer[getSlabOffset(slab)]);
 
     cBuf.buf[id].bufSize        = size;
     cBuf.buf[id].readIndex      = 0;
@@ -118,24 +263,113 @@ uint8 cbBUF_open(
     cBuf.buf[id].endOfDataIndex = size - 1;
     cBuf.buf[id].minReturnSize  = minReturnSize;
     cBuf.buf[id].reservedSize   = reservedSize;
+    cBuf.buf[id].mode           = mode;
+#ifndef WITHOUT_BUF_OVERWRITE
+    cBuf.buf[id].bytesEvicted   = 0;
+#endif
     cBuf.buf[id].state          = cbBUF_S_IDLE; 
 
-    cBuf.usedSize += size;
+    resetStats(id);
+
     cBuf.nbrOfOpenedBuffers++;
 
     return cbBUF_OK;
 }
 
+uint8 cbBUF_close(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(cBuf.buf[id].state != cbBUF_S_CLOSED);
+    cb_ASSERT(cBuf.slabOwner[cBuf.buf[id].slab] == (id + 1));
+
+    cBuf.slabOwner[cBuf.buf[id].slab] = cbBUF_SLAB_FREE;
+    cBuf.buf[id].state = cbBUF_S_CLOSED;
+
+    cBuf.nbrOfOpenedBuffers--;
+
+    return cbBUF_OK;
+}
+
+uint8 cbBUF_resize(uint8 id, uint16 size)
+{
+    uint8 current;
+    uint8 slab;
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(cBuf.buf[id].state == cbBUF_S_IDLE);
+
+    if (cBuf.buf[id].currentSize != 0)
+    {
+        return cbBUF_ERROR;
+    }
+
+    current = cBuf.buf[id].slab;
+    slab = allocSlab(size);
+
+    if (size > slabSize[current])
+    {
+        /* Move to a bigger slab */
+        if (slab == cbBUF_NUM_SLABS)
+        {
+            return cbBUF_ERROR;
+        }
+    }
+    else if ((slab == cbBUF_NUM_SLABS) || (slabSize[slab] >= slabSize[current]))
+    {
+        /* No smaller slab is free, stay */
+        slab = current;
+    }
+
+    if (slab != current)
+    {
+        cBuf.slabOwner[current] = cbBUF_SLAB_FREE;
+        cBuf.slabOwner[slab] = id + 1;
+
+        cBuf.buf[id].slab = slab;
+        cBuf.buf[id].data = &(circBuffer[getSlabOffset(slab)]);
+    }
+
+    cBuf.buf[id].bufSize = size;
+
+    resetStats(id);
+
+    return cbBUF_clear(id);
+}
+
 uint8 cbBUF_clear(uint8 id)
 {
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
     cBuf.buf[id].readIndex      = 0;
     cBuf.buf[id].writeIndex     = 0;
     cBuf.buf[id].currentSize    = 0; 
     cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+#ifndef WITHOUT_BUF_OVERWRITE
+    cBuf.buf[id].bytesEvicted   = 0;
+#endif
     cBuf.buf[id].state          = cbBUF_S_IDLE; 
 
+#ifndef WITHOUT_BUF_WATERMARKS
+    cBuf.buf[id].aboveHighWatermark = FALSE;
+#endif
+
+    return cbBUF_OK;
+}
+
+#ifndef WITHOUT_BUF_WATERMARKS
+uint8 cbBUF_setWatermarks(uint8 id, uint16 high, uint16 low, cbBUF_WatermarkCallback callback)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT((callback == NULL) || (low < high));
+
+    cBuf.buf[id].highWatermark = high;
+    cBuf.buf[id].lowWatermark  = low;
+    cBuf.buf[id].wmCallback    = callback;
+    cBuf.buf[id].aboveHighWatermark = (cBuf.buf[id].currentSize >= high);
+
     return cbBUF_OK;
 }
+#endif
 
 uint8 cbBUF_getWriteBuf(uint8 id, uint8 **pBuf, uint16 *bufSize)
 {
@@ -146,6 +380,11 @@ uint8 cbBUF_getWriteBuf(uint8 id, uint8 **pBuf, uint16 *bufSize)
     cb_ASSERT(id < cbBUF_MAX_BUFFERS);
     cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_READING));
 
+    prepareBipWrite(id);
+#ifndef WITHOUT_BUF_OVERWRITE
+    makeRoom(id, cBuf.buf[id].minReturnSize);
+#endif
+
     writeIndex = cBuf.buf[id].writeIndex;
     readIndex =  cBuf.buf[id].readIndex;
 
@@ -165,20 +404,7 @@ uint8 cbBUF_getWriteBuf(uint8 id, uint8 **pBuf, uint16 *bufSize)
             *bufSize = readIndex - writeIndex;          
         }
 
-        switch (cBuf.buf[id].state)
-        {      
-        case cbBUF_S_IDLE:
-            cBuf.buf[id].state = cbBUF_S_USER_STORING;
-            break;
-
-        case cbBUF_S_USER_READING:
-            cBuf.buf[id].state = cbBUF_S_USER_READING_AND_STORING;
-            break;
-
-        default:
-            cb_EXIT(cBuf.buf[id].state);
-            break;
-        }
+        startStoring(id);
     }
     else
     {
@@ -199,6 +425,11 @@ uint8 cbBUF_getAvailableWriteBuf(uint8 id, uint8 **pBuf, uint16 *bufSize)
     cb_ASSERT(id < cbBUF_MAX_BUFFERS);
     cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_READING));
 
+    prepareBipWrite(id);
+#ifndef WITHOUT_BUF_OVERWRITE
+    makeRoom(id, 1);
+#endif
+
     writeIndex = cBuf.buf[id].writeIndex;
     readIndex =  cBuf.buf[id].readIndex;
 
@@ -218,20 +449,7 @@ uint8 cbBUF_getAvailableWriteBuf(uint8 id, uint8 **pBuf, uint16 *bufSize)
             *bufSize = readIndex - writeIndex;          
         }
 
-        switch (cBuf.buf[id].state)
-        {      
-        case cbBUF_S_IDLE:
-            cBuf.buf[id].state = cbBUF_S_USER_STORING;
-            break;
-
-        case cbBUF_S_USER_READING:
-            cBuf.buf[id].state = cbBUF_S_USER_READING_AND_STORING;
-            break;
-
-        default:
-            cb_EXIT(cBuf.buf[id].state);
-            break;
-        }
+        startStoring(id);
     }
     else
     {
@@ -245,13 +463,27 @@ uint8 cbBUF_getAvailableWriteBuf(uint8 id, uint8 **pBuf, uint16 *bufSize)
 
 uint8 cbBUF_writeBufProduced(uint8 id, uint16 nBytes)
 {
+    bool wrapped;
+
     cb_ASSERT(id < cbBUF_MAX_BUFFERS);
 
+    /* Write and read index are equal and data is stored when a write buffer
+       in the wrap-around part has been filled with cbBUF_writeBufProducedCont */
+    wrapped = (cBuf.buf[id].writeIndex < cBuf.buf[id].readIndex) ||
+              ((cBuf.buf[id].writeIndex == cBuf.buf[id].readIndex) && (cBuf.buf[id].currentSize != 0));
+
     cBuf.buf[id].currentSize += nBytes;
     cb_ASSERT( cBuf.buf[id].currentSize <= cBuf.buf[id].bufSize);
 
+#ifndef WITHOUT_BUF_STATS
+    statsProduced(id, nBytes);
+#endif
+#ifndef WITHOUT_BUF_WATERMARKS
+    checkHighWatermark(id);
+#endif
+
     /* No wrap-around */
-    if (cBuf.buf[id].writeIndex >=  cBuf.buf[id].readIndex)
+    if (wrapped == FALSE)
     {
         cBuf.buf[id].writeIndex += nBytes;
 
@@ -260,9 +492,27 @@ uint8 cbBUF_writeBufProduced(uint8 id, uint16 nBytes)
         /* Perform wrap-around */
         if (cBuf.buf[id].writeIndex >= (cBuf.buf[id].bufSize - cBuf.buf[id].reservedSize))
         {
-            cBuf.buf[id].endOfDataIndex  = cBuf.buf[id].writeIndex - 1;
+            if (cBuf.buf[id].currentSize == 0)
+            {
+                /* All data published with cbBUF_writeBufProducedCont has 
+                   already been read, start over from the beginning. An
+                   empty buffer has no read buffer out and the read index
+                   has caught up with the write index. */
+                cb_ASSERT(cBuf.buf[id].state == cbBUF_S_USER_STORING);
+                cb_ASSERT(cBuf.buf[id].readIndex == cBuf.buf[id].writeIndex);
+                cBuf.buf[id].readIndex = 0;
+                cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+            }
+            else
+            {
+                cBuf.buf[id].endOfDataIndex  = cBuf.buf[id].writeIndex - 1;
+            }
 
             cBuf.buf[id].writeIndex = 0;
+
+#ifndef WITHOUT_BUF_STATS
+            cBuf.buf[id].stats.nWraps++;
+#endif
         }    
     }
     /* Wrap-around */
@@ -296,6 +546,54 @@ uint8 cbBUF_writeBufProduced(uint8 id, uint16 nBytes)
     return cbBUF_OK;
 }
 
+uint8 cbBUF_writeBufProducedCont(uint8 id, uint16 nBytes)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT((cBuf.buf[id].state == cbBUF_S_USER_STORING) || (cBuf.buf[id].state == cbBUF_S_USER_READING_AND_STORING));
+
+    /* Only the write index and the current size are updated, the 
+       wrap-around and the end of data are left to cbBUF_writeBufProduced.
+       A reader compares the read index to the write index, so it sees the
+       produced bytes and never a half made wrap-around: before the 
+       wrap-around the write index is ahead of the read index, or equal 
+       when the reader has caught up and the buffer is empty, after it the
+       end of data was set by the previous cbBUF_writeBufProduced. */
+    cb_ASSERT((cBuf.buf[id].currentSize != 0) || (cBuf.buf[id].readIndex == cBuf.buf[id].writeIndex));
+
+    /* No wrap-around */
+    if ((cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex) || (cBuf.buf[id].currentSize == 0))
+    {
+        cBuf.buf[id].writeIndex += nBytes;
+
+        /* The wrap-around is performed when the buffer is returned with
+           cbBUF_writeBufProduced. Until then the write index may reach
+           the end of the buffer. */
+        cb_ASSERT(cBuf.buf[id].writeIndex <= cBuf.buf[id].bufSize);
+    }
+    /* Wrap-around */
+    else
+    {
+        cBuf.buf[id].writeIndex += nBytes;
+
+        cb_ASSERT(cBuf.buf[id].writeIndex <= cBuf.buf[id].readIndex);
+    }
+
+    cBuf.buf[id].currentSize += nBytes;
+    cb_ASSERT(cBuf.buf[id].currentSize <= cBuf.buf[id].bufSize);
+
+#ifndef WITHOUT_BUF_STATS
+    statsProduced(id, nBytes);
+#endif
+#ifndef WITHOUT_BUF_WATERMARKS
+    checkHighWatermark(id);
+#endif
+
+    /* Data is available for reading, the write buffer is still allocated 
+       so the state is unchanged */
+
+    return cbBUF_OK;
+}
+
 uint8 cbBUF_getReadBuf(uint8 id, uint8** pBuf, uint16 *bufSize)
 {
     uint8 result = cbBUF_OK;
@@ -327,20 +625,7 @@ uint8 cbBUF_getReadBuf(uint8 id, uint8** pBuf, uint16 *bufSize)
             *bufSize = cBuf.buf[id].endOfDataIndex - cBuf.buf[id].readIndex + 1;
         }
 
-        switch (cBuf.buf[id].state)
-        {      
-        case cbBUF_S_IDLE: 
-            cBuf.buf[id].state = cbBUF_S_USER_READING;
-            break;
-
-        case cbBUF_S_USER_STORING:
-            cBuf.buf[id].state = cbBUF_S_USER_READING_AND_STORING;
-            break;     
-
-        default:
-            cb_EXIT(cBuf.buf[id].state);
-            break;
-        }    
+        startReading(id);
 		
         result = cbBUF_OK;    
     }
@@ -353,27 +638,7 @@ uint8 cbBUF_readBufConsumed(uint8 id, uint16 nBytes)
 {
     cb_ASSERT(id < cbBUF_MAX_BUFFERS);
 
-    cBuf.buf[id].currentSize -= nBytes;
-    cb_ASSERT( cBuf.buf[id].currentSize <= cBuf.buf[id].bufSize);
-
-    /* No wrap-around */
-    if (cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex)
-    {
-        cBuf.buf[id].readIndex += nBytes;
-        cb_ASSERT(cBuf.buf[id].readIndex <= cBuf.buf[id].writeIndex);        
-    }
-    /* Wrap-around */
-    else
-    {
-        cBuf.buf[id].readIndex += nBytes;
-        cb_ASSERT(cBuf.buf[id].readIndex <= (cBuf.buf[id].endOfDataIndex + 1));
-
-        if (cBuf.buf[id].readIndex > cBuf.buf[id].endOfDataIndex)
-        {
-            cBuf.buf[id].readIndex = 0;
-            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
-        } 
-    }        
+    consumeData(id, nBytes);
 
     switch (cBuf.buf[id].state)
     {            
@@ -393,103 +658,737 @@ uint8 cbBUF_readBufConsumed(uint8 id, uint16 nBytes)
     return cbBUF_OK;
 }
 
-
-uint8 cbBUF_readByte(uint8 id, uint8* pByte)
+uint8 cbBUF_getReadVec(uint8 id, cbBUF_Seg *pSeg)
 {
-    uint8 result = cbBUF_OK;
+    uint8 result;
 
-    cb_ASSERT(id < cbBUF_MAX_BUFFERS); 
-    cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_STORING));
-    cb_ASSERT(cBuf.buf[id].readIndex <= cBuf.buf[id].endOfDataIndex);
+    result = cbBUF_getReadBuf(id, &pSeg[0].pBuf, &pSeg[0].size);
 
-    if (cBuf.buf[id].currentSize == 0)
+    /* Data after the wrap-around */
+    if ((result == cbBUF_OK) && 
+        (cBuf.buf[id].writeIndex <= cBuf.buf[id].readIndex) &&
+        (cBuf.buf[id].writeIndex != 0))
     {
-        result = cbBUF_NO_DATA;
+        pSeg[1].pBuf = cBuf.buf[id].data;
+        pSeg[1].size = cBuf.buf[id].writeIndex;
     }
     else
     {
-        *pByte = cBuf.buf[id].data[cBuf.buf[id].readIndex];
-
-        cBuf.buf[id].readIndex++;
-        cBuf.buf[id].currentSize--;
-
-        if (cBuf.buf[id].readIndex > cBuf.buf[id].endOfDataIndex)
-        {
-            cBuf.buf[id].readIndex = 0;
-            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
-        } 
+        pSeg[1].pBuf = NULL;
+        pSeg[1].size = 0;
     }
 
     return result;
 }
 
-
-uint8 cbBUF_writeByte(uint8 id, uint8 data)
+uint8 cbBUF_readVecConsumed(uint8 id, uint16 nBytes)
 {
-    uint8 result = cbBUF_OK;
+    uint16 firstSize;
 
-    cb_ASSERT(id < cbBUF_MAX_BUFFERS); 
-    cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_READING));
-
-    /* Buffer full */
-    if ((cBuf.buf[id].writeIndex == cBuf.buf[id].readIndex ) && (cBuf.buf[id].currentSize != 0))
-    {
-        cb_ASSERT(cBuf.buf[id].currentSize ==  (cBuf.buf[id].endOfDataIndex + 1));
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
 
-        result = cbBUF_FULL;
-    }
-    /* Buffer not full */
-    else
+    /* Consume the data before the wrap-around first */
+    if (cBuf.buf[id].writeIndex <= cBuf.buf[id].readIndex)
     {
-        cBuf.buf[id].data[cBuf.buf[id].writeIndex] = data;
-
-        cBuf.buf[id].writeIndex++;
-        cBuf.buf[id].currentSize++;
-
-        /* Perform wrap-around */
-        if (cBuf.buf[id].writeIndex >= (cBuf.buf[id].bufSize - cBuf.buf[id].reservedSize))
+        firstSize = cBuf.buf[id].endOfDataIndex - cBuf.buf[id].readIndex + 1;
+        if (nBytes > firstSize)
         {
-            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].writeIndex - 1;
-
-            cBuf.buf[id].writeIndex = 0;
-        } 
+            consumeData(id, firstSize);
+            nBytes -= firstSize;
+        }
     }
 
-    return result;
+    return cbBUF_readBufConsumed(id, nBytes);
 }
 
-
-bool cbBUF_isBufferEmpty(uint8 id)
+uint8 cbBUF_getWriteVec(uint8 id, cbBUF_Seg *pSeg)
 {
-    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    uint8 result;
 
-    if (cBuf.buf[id].currentSize == 0)
+    result = cbBUF_getAvailableWriteBuf(id, &pSeg[0].pBuf, &pSeg[0].size);
+
+    /* Free space in front of the read index */
+    if ((result == cbBUF_OK) && 
+        ((cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex) || (cBuf.buf[id].currentSize == 0)) &&
+        (cBuf.buf[id].readIndex != 0))
     {
-        return TRUE;
+        pSeg[1].pBuf = cBuf.buf[id].data;
+        pSeg[1].size = cBuf.buf[id].readIndex;
     }
     else
     {
-        return FALSE;
+        pSeg[1].pBuf = NULL;
+        pSeg[1].size = 0;
     }
+
+    return result;
 }
 
-uint16 cbBUF_getNoBytes(uint8 id)
+uint8 cbBUF_writeVecProduced(uint8 id, uint16 nBytes)
 {
+    uint16 firstSize;
+
     cb_ASSERT(id < cbBUF_MAX_BUFFERS);
 
-    return cBuf.buf[id].currentSize;
-}
+    /* The write buffer reached the end of the buffer, wrap-around and 
+       produce the rest in front of the read index */
+    if ((cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex) || (cBuf.buf[id].currentSize == 0))
+    {
+        firstSize = cBuf.buf[id].bufSize - cBuf.buf[id].writeIndex;
+        if (nBytes > firstSize)
+        {
+            cb_ASSERT((nBytes - firstSize) <= cBuf.buf[id].readIndex);
 
-uint16 cbBUF_getNoFreeBytes(uint8 id)
-{
-    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+            cBuf.buf[id].currentSize   += firstSize;
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+            cBuf.buf[id].writeIndex     = 0;
+            nBytes -= firstSize;
 
-    return (cBuf.buf[id].bufSize - cBuf.buf[id].currentSize);
+#ifndef WITHOUT_BUF_STATS
+            statsProduced(id, firstSize);
+            cBuf.buf[id].stats.nWraps++;
+#endif
+        }
+    }
+
+    return cbBUF_writeBufProduced(id, nBytes);
 }
 
-uint16 cbBUF_getReservedSize(uint8 id)
+uint16 cbBUF_write(uint8 id, const uint8 *pData, uint16 nBytes)
 {
+    cbBUF_Seg   seg[2];
+
     cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(pData != NULL);
 
-    return cBuf.buf[id].reservedSize;
+#ifndef WITHOUT_BUF_OVERWRITE
+    if ((cBuf.buf[id].mode == cbBUF_MODE_OVERWRITE) && (cBuf.buf[id].state == cbBUF_S_IDLE))
+    {
+        uint16 nFree;
+
+        /* Only the newest data fits, the rest counts as evicted */
+        if (nBytes > cBuf.buf[id].bufSize)
+        {
+            cBuf.buf[id].bytesEvicted += nBytes - cBuf.buf[id].bufSize;
+            pData += nBytes - cBuf.buf[id].bufSize;
+            nBytes = cBuf.buf[id].bufSize;
+        }
+
+        nFree = cBuf.buf[id].bufSize - cBuf.buf[id].currentSize;
+        if (nBytes > nFree)
+        {
+            evictData(id, nBytes - nFree);
+        }
+    }
+#endif
+
+    if (cbBUF_getWriteVec(id, seg) != cbBUF_OK)
+    {
+        return 0;
+    }
+
+    if (nBytes > (seg[0].size + seg[1].size))
+    {
+        nBytes = seg[0].size + seg[1].size;
+    }
+
+    if (nBytes > seg[0].size)
+    {
+        cbBUF_MEMCPY(seg[0].pBuf, pData, seg[0].size);
+        cbBUF_MEMCPY(seg[1].pBuf, &pData[seg[0].size], nBytes - seg[0].size);
+    }
+    else
+    {
+        cbBUF_MEMCPY(seg[0].pBuf, pData, nBytes);
+    }
+
+    cbBUF_writeVecProduced(id, nBytes);
+
+    return nBytes;
+}
+
+uint16 cbBUF_read(uint8 id, uint8 *pData, uint16 nBytes)
+{
+    cbBUF_Seg   seg[2];
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(pData != NULL);
+
+    if (cbBUF_getReadVec(id, seg) != cbBUF_OK)
+    {
+        return 0;
+    }
+
+    if (nBytes > (seg[0].size + seg[1].size))
+    {
+        nBytes = seg[0].size + seg[1].size;
+    }
+
+    if (nBytes > seg[0].size)
+    {
+        cbBUF_MEMCPY(pData, seg[0].pBuf, seg[0].size);
+        cbBUF_MEMCPY(&pData[seg[0].size], seg[1].pBuf, nBytes - seg[0].size);
+    }
+    else
+    {
+        cbBUF_MEMCPY(pData, seg[0].pBuf, nBytes);
+    }
+
+    cbBUF_readVecConsumed(id, nBytes);
+
+    return nBytes;
+}
+
+uint8 cbBUF_writeRecord(uint8 id, const uint8 *pData, uint8 size)
+{
+    uint16 recSize = (uint16)size + 1;
+    bool   fits = FALSE;
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(cBuf.buf[id].mode == cbBUF_MODE_RECORD);
+    cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_READING));
+
+    if (cBuf.buf[id].currentSize == 0)
+    {
+        cBuf.buf[id].readIndex      = 0;
+        cBuf.buf[id].writeIndex     = 0;
+        cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+    }
+
+    /* No wrap-around */
+    if ((cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex) || (cBuf.buf[id].currentSize == 0))
+    {
+        if ((cBuf.buf[id].bufSize - cBuf.buf[id].writeIndex) >= recSize)
+        {
+            fits = TRUE;
+        }
+        else if (cBuf.buf[id].readIndex >= recSize)
+        {
+            /* Records are never split, wrap-around before the record */
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].writeIndex - 1;
+            cBuf.buf[id].writeIndex     = 0;
+            fits = TRUE;
+
+#ifndef WITHOUT_BUF_STATS
+            cBuf.buf[id].stats.nWraps++;
+#endif
+        }
+    }
+    /* Wrap-around */
+    else if ((cBuf.buf[id].readIndex - cBuf.buf[id].writeIndex) >= recSize)
+    {
+        fits = TRUE;
+    }
+
+    if (fits == FALSE)
+    {
+        return cbBUF_FULL;
+    }
+
+    cBuf.buf[id].data[cBuf.buf[id].writeIndex] = size;
+    cbBUF_MEMCPY(&(cBuf.buf[id].data[cBuf.buf[id].writeIndex + 1]), pData, size);
+
+    startStoring(id);
+
+    return cbBUF_writeBufProduced(id, recSize);
+}
+
+uint8 cbBUF_getReadRecord(uint8 id, uint8 **ppRecord, uint8 *pSize)
+{
+    uint8  result;
+    uint8  *pBuf;
+    uint16 bufSize;
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(cBuf.buf[id].mode == cbBUF_MODE_RECORD);
+
+    result = cbBUF_getReadBuf(id, &pBuf, &bufSize);
+
+    if (result == cbBUF_OK)
+    {
+        *pSize = pBuf[0];
+        *ppRecord = &pBuf[1];
+
+        cb_ASSERT(bufSize > *pSize);
+    }
+    else
+    {
+        *pSize = 0;
+        *ppRecord = NULL;
+    }
+
+    return result;
+}
+
+uint8 cbBUF_readRecordConsumed(uint8 id)
+{
+    uint16 recSize;
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(cBuf.buf[id].mode == cbBUF_MODE_RECORD);
+
+    recSize = (uint16)cBuf.buf[id].data[cBuf.buf[id].readIndex] + 1;
+
+    return cbBUF_readBufConsumed(id, recSize);
+}
+
+uint8 cbBUF_readByte(uint8 id, uint8* pByte)
+{
+    uint8 result = cbBUF_OK;
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS); 
+    cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_STORING));
+
+    if (cBuf.buf[id].currentSize == 0)
+    {
+        result = cbBUF_NO_DATA;
+    }
+    else
+    {
+        cb_ASSERT(cBuf.buf[id].readIndex <= cBuf.buf[id].endOfDataIndex);
+
+        *pByte = cBuf.buf[id].data[cBuf.buf[id].readIndex];
+
+        cBuf.buf[id].readIndex++;
+        cBuf.buf[id].currentSize--;
+
+#ifndef WITHOUT_BUF_STATS
+        cBuf.buf[id].stats.bytesOut++;
+#endif
+#ifndef WITHOUT_BUF_WATERMARKS
+        checkLowWatermark(id);
+#endif
+
+        if (cBuf.buf[id].readIndex > cBuf.buf[id].endOfDataIndex)
+        {
+            cBuf.buf[id].readIndex = 0;
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+        } 
+    }
+
+    return result;
+}
+
+
+uint8 cbBUF_writeByte(uint8 id, uint8 data)
+{
+    uint8 result = cbBUF_OK;
+
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS); 
+    cb_ASSERT((cBuf.buf[id].state == cbBUF_S_IDLE) || (cBuf.buf[id].state == cbBUF_S_USER_READING));
+
+#ifndef WITHOUT_BUF_OVERWRITE
+    makeRoom(id, 1);
+#endif
+
+    /* Buffer full */
+    if ((cBuf.buf[id].writeIndex == cBuf.buf[id].readIndex ) && (cBuf.buf[id].currentSize != 0))
+    {
+        cb_ASSERT(cBuf.buf[id].currentSize ==  (cBuf.buf[id].endOfDataIndex + 1));
+
+        result = cbBUF_FULL;
+    }
+    /* Buffer not full */
+    else
+    {
+        cBuf.buf[id].data[cBuf.buf[id].writeIndex] = data;
+
+        cBuf.buf[id].writeIndex++;
+        cBuf.buf[id].currentSize++;
+
+#ifndef WITHOUT_BUF_STATS
+        statsProduced(id, 1);
+#endif
+#ifndef WITHOUT_BUF_WATERMARKS
+        checkHighWatermark(id);
+#endif
+
+        /* Perform wrap-around */
+        if (cBuf.buf[id].writeIndex >= (cBuf.buf[id].bufSize - cBuf.buf[id].reservedSize))
+        {
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].writeIndex - 1;
+
+            cBuf.buf[id].writeIndex = 0;
+
+#ifndef WITHOUT_BUF_STATS
+            cBuf.buf[id].stats.nWraps++;
+#endif
+        } 
+    }
+
+    return result;
+}
+
+
+bool cbBUF_isBufferEmpty(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+    if (cBuf.buf[id].currentSize == 0)
+    {
+        return TRUE;
+    }
+    else
+    {
+        return FALSE;
+    }
+}
+
+uint16 cbBUF_getNoBytes(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+    return cBuf.buf[id].currentSize;
+}
+
+uint16 cbBUF_getNoFreeBytes(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+    return (cBuf.buf[id].bufSize - cBuf.buf[id].currentSize);
+}
+
+uint16 cbBUF_getReservedSize(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+    return cBuf.buf[id].reservedSize;
 }
+
+#ifndef WITHOUT_BUF_OVERWRITE
+uint32 cbBUF_getNoEvictedBytes(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+    return cBuf.buf[id].bytesEvicted;
+}
+#endif
+
+uint8 cbBUF_dataDropped(uint8 id, uint16 nBytes)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+#ifndef WITHOUT_BUF_STATS
+    cBuf.buf[id].stats.nOverflows++;
+    cBuf.buf[id].stats.bytesDropped += nBytes;
+#endif
+
+    return cbBUF_OK;
+}
+
+#ifndef WITHOUT_BUF_STATS
+uint8 cbBUF_getStats(uint8 id, cbBUF_Stats *pStats)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+    cb_ASSERT(pStats != NULL);
+
+    cbBUF_MEMCPY(pStats, &cBuf.buf[id].stats, sizeof(cbBUF_Stats));
+
+    return cbBUF_OK;
+}
+
+uint8 cbBUF_clearStats(uint8 id)
+{
+    cb_ASSERT(id < cbBUF_MAX_BUFFERS);
+
+    cbBUF_MEMSET(&cBuf.buf[id].stats, 0, sizeof(cbBUF_Stats));
+    cBuf.buf[id].stats.peakSize = cBuf.buf[id].currentSize;
+
+    return cbBUF_OK;
+}
+#endif
+
+/*===========================================================================
+* STATIC FUNCTIONS
+*=========================================================================*/
+
+/*---------------------------------------------------------------------------
+* Finds the smallest free slab that can hold size bytes. Returns 
+* cbBUF_NUM_SLABS if there is no such slab.
+*-------------------------------------------------------------------------*/
+static uint8 allocSlab(uint16 size)
+{
+    uint8 slab;
+
+    for (slab = 0; slab < cbBUF_NUM_SLABS; slab++)
+    {
+        if ((cBuf.slabOwner[slab] == cbBUF_SLAB_FREE) && (slabSize[slab] >= size))
+        {
+            break;
+        }
+    }
+
+    return slab;
+}
+
+/*---------------------------------------------------------------------------
+* Returns the start of a slab in the pool.
+*-------------------------------------------------------------------------*/
+static uint16 getSlabOffset(uint8 slab)
+{
+    uint16 offset = 0;
+    uint8  i;
+
+    for (i = 0; i < slab; i++)
+    {
+        offset += slabSize[i];
+    }
+
+    return offset;
+}
+
+#ifndef WITHOUT_BUF_STATS
+/*---------------------------------------------------------------------------
+* Counts produced bytes and updates the peak occupancy.
+*-------------------------------------------------------------------------*/
+static void statsProduced(uint8 id, uint16 nBytes)
+{
+    cBuf.buf[id].stats.bytesIn += nBytes;
+
+    if (cBuf.buf[id].currentSize > cBuf.buf[id].stats.peakSize)
+    {
+        cBuf.buf[id].stats.peakSize = cBuf.buf[id].currentSize;
+    }
+}
+#endif
+
+/*---------------------------------------------------------------------------
+* Clears the statistics and removes the watermarks, both follow the size
+* of the buffer.
+*-------------------------------------------------------------------------*/
+static void resetStats(uint8 id)
+{
+#ifndef WITHOUT_BUF_STATS
+    cbBUF_MEMSET(&cBuf.buf[id].stats, 0, sizeof(cbBUF_Stats));
+#endif
+
+#ifndef WITHOUT_BUF_WATERMARKS
+    cBuf.buf[id].wmCallback     = NULL;
+    cBuf.buf[id].highWatermark  = 0;
+    cBuf.buf[id].lowWatermark   = 0;
+    cBuf.buf[id].aboveHighWatermark = FALSE;
+#endif
+}
+
+#ifndef WITHOUT_BUF_WATERMARKS
+/*---------------------------------------------------------------------------
+* Calls the watermark callback when the number of bytes has risen to the
+* high watermark.
+*-------------------------------------------------------------------------*/
+static void checkHighWatermark(uint8 id)
+{
+    if ((cBuf.buf[id].wmCallback != NULL) &&
+        (cBuf.buf[id].aboveHighWatermark == FALSE) &&
+        (cBuf.buf[id].currentSize >= cBuf.buf[id].highWatermark))
+    {
+        cBuf.buf[id].aboveHighWatermark = TRUE;
+        cBuf.buf[id].wmCallback(id, TRUE);
+    }
+}
+
+/*---------------------------------------------------------------------------
+* Calls the watermark callback when the number of bytes has fallen to the
+* low watermark after the high watermark was reached.
+*-------------------------------------------------------------------------*/
+static void checkLowWatermark(uint8 id)
+{
+    if ((cBuf.buf[id].wmCallback != NULL) &&
+        (cBuf.buf[id].aboveHighWatermark == TRUE) &&
+        (cBuf.buf[id].currentSize <= cBuf.buf[id].lowWatermark))
+    {
+        cBuf.buf[id].aboveHighWatermark = FALSE;
+        cBuf.buf[id].wmCallback(id, FALSE);
+    }
+}
+#endif
+
+/*---------------------------------------------------------------------------
+* Removes consumed data from the buffer.
+*-------------------------------------------------------------------------*/
+static void consumeData(uint8 id, uint16 nBytes)
+{
+    cBuf.buf[id].currentSize -= nBytes;
+    cb_ASSERT( cBuf.buf[id].currentSize <= cBuf.buf[id].bufSize);
+
+#ifndef WITHOUT_BUF_STATS
+    cBuf.buf[id].stats.bytesOut += nBytes;
+#endif
+#ifndef WITHOUT_BUF_WATERMARKS
+    checkLowWatermark(id);
+#endif
+
+    moveReadIndex(id, nBytes);
+}
+
+/*---------------------------------------------------------------------------
+* Moves the read index. Wraps around when the end of data is reached.
+* The current size must already be updated.
+*-------------------------------------------------------------------------*/
+static void moveReadIndex(uint8 id, uint16 nBytes)
+{
+    /* No wrap-around */
+    if (cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex)
+    {
+        cBuf.buf[id].readIndex += nBytes;
+        cb_ASSERT(cBuf.buf[id].readIndex <= cBuf.buf[id].writeIndex);        
+    }
+    /* Wrap-around */
+    else
+    {
+        cBuf.buf[id].readIndex += nBytes;
+        cb_ASSERT(cBuf.buf[id].readIndex <= (cBuf.buf[id].endOfDataIndex + 1));
+
+        if (cBuf.buf[id].readIndex > cBuf.buf[id].endOfDataIndex)
+        {
+            cBuf.buf[id].readIndex = 0;
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+        } 
+    }        
+}
+
+/*---------------------------------------------------------------------------
+* State transition when the user gets a write buffer.
+*-------------------------------------------------------------------------*/
+static void startStoring(uint8 id)
+{
+    switch (cBuf.buf[id].state)
+    {      
+    case cbBUF_S_IDLE:
+        cBuf.buf[id].state = cbBUF_S_USER_STORING;
+        break;
+
+    case cbBUF_S_USER_READING:
+        cBuf.buf[id].state = cbBUF_S_USER_READING_AND_STORING;
+        break;
+
+    default:
+        cb_EXIT(cBuf.buf[id].state);
+        break;
+    }
+}
+
+/*---------------------------------------------------------------------------
+* State transition when the user gets a read buffer.
+*-------------------------------------------------------------------------*/
+static void startReading(uint8 id)
+{
+    switch (cBuf.buf[id].state)
+    {      
+    case cbBUF_S_IDLE: 
+        cBuf.buf[id].state = cbBUF_S_USER_READING;
+        break;
+
+    case cbBUF_S_USER_STORING:
+        cBuf.buf[id].state = cbBUF_S_USER_READING_AND_STORING;
+        break;     
+
+    default:
+        cb_EXIT(cBuf.buf[id].state);
+        break;
+    }
+}
+
+/*---------------------------------------------------------------------------
+* In bip-buffer mode the write index is moved so that the next write buffer
+* is the largest contiguous free part of the buffer. An empty buffer is 
+* restarted from the beginning and the wrap-around is performed already 
+* when the free part in front of the read index is larger than the free 
+* part at the end of the buffer.
+*-------------------------------------------------------------------------*/
+static void prepareBipWrite(uint8 id)
+{
+    if (cBuf.buf[id].mode == cbBUF_MODE_BIP)
+    {
+        if (cBuf.buf[id].currentSize == 0)
+        {
+            cBuf.buf[id].readIndex      = 0;
+            cBuf.buf[id].writeIndex     = 0;
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].bufSize - 1;
+        }
+        else if ((cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex) &&
+                 (cBuf.buf[id].readIndex > (cBuf.buf[id].bufSize - cBuf.buf[id].writeIndex)))
+        {
+            cBuf.buf[id].endOfDataIndex = cBuf.buf[id].writeIndex - 1;
+            cBuf.buf[id].writeIndex     = 0;
+
+#ifndef WITHOUT_BUF_STATS
+            cBuf.buf[id].stats.nWraps++;
+#endif
+        }
+    }
+}
+
+#ifndef WITHOUT_BUF_OVERWRITE
+/*---------------------------------------------------------------------------
+* In overwrite mode the oldest data is evicted until there is a contiguous
+* free part of at least nBytes at the write index. Nothing is evicted while
+* the user holds a read buffer.
+*-------------------------------------------------------------------------*/
+static void makeRoom(uint8 id, uint16 nBytes)
+{
+    uint16 evict;
+    uint16 firstSize;
+
+    if ((cBuf.buf[id].mode != cbBUF_MODE_OVERWRITE) || (cBuf.buf[id].state != cbBUF_S_IDLE))
+    {
+        return;
+    }
+
+    if (nBytes == 0)
+    {
+        nBytes = 1;
+    }
+
+    /* Free part is in front of the read index and too small */
+    while ((cBuf.buf[id].currentSize != 0) &&
+           (cBuf.buf[id].writeIndex <= cBuf.buf[id].readIndex) &&
+           ((cBuf.buf[id].readIndex - cBuf.buf[id].writeIndex) < nBytes))
+    {
+        evict = nBytes - (cBuf.buf[id].readIndex - cBuf.buf[id].writeIndex);
+
+        /* Evicting all data up to the end of data wraps the read index */
+        firstSize = cBuf.buf[id].endOfDataIndex - cBuf.buf[id].readIndex + 1;
+        if (evict > firstSize)
+        {
+            evict = firstSize;
+        }
+
+        evictData(id, evict);
+    }
+}
+
+/*---------------------------------------------------------------------------
+* Removes the oldest nBytes without the user reading them. The data may 
+* continue after the wrap-around. Accounted as consumed data, so the 
+* statistics and watermarks follow the current size.
+*-------------------------------------------------------------------------*/
+static void evictData(uint8 id, uint16 nBytes)
+{
+    uint16 evict;
+
+    cb_ASSERT(nBytes <= cBuf.buf[id].currentSize);
+
+    while (nBytes != 0)
+    {
+        /* Evict up to the end of data first */
+        if (cBuf.buf[id].writeIndex > cBuf.buf[id].readIndex)
+        {
+            evict = cBuf.buf[id].writeIndex - cBuf.buf[id].readIndex;
+        }
+        else
+        {
+            evict = cBuf.buf[id].endOfDataIndex - cBuf.buf[id].readIndex + 1;
+        }
+
+        if (evict > nBytes)
+        {
+            evict = nBytes;
+        }
+
+        cBuf.buf[id].bytesEvicted += evict;
+        consumeData(id, evict);
+
+        nBytes -= evict;
+    }
+}
+#endif
@@ -0,0 +1,159 @@
+/*---------------------------------------------------------------------------
+* Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+* Any reproduction without written permission is prohibited by law.
+*
+* Component   : Ring
+* File        : cb_ring.c
+*
+* Description : Implementation of single producer, single consumer ring
+*               buffer. See cb_ring.h for the rules of usage.
+*-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+#include "hal_types.h"
+
+#include "cb_assert.h"
+#include "cb_ring.h"
+
+/*===========================================================================
+* DEFINES
+*=========================================================================*/
+
+/* The data and the indexes are volatile, so the compiler does not move
+   the data accesses past the index updates. That is enough on the target,
+   where producer and consumer run on the same core. A host running them
+   as threads on several cores defines this as a memory barrier. */
+#ifndef cbRING_BARRIER
+#define cbRING_BARRIER()
+#endif
+
+/*===========================================================================
+* TYPES
+*=========================================================================*/
+
+/*===========================================================================
+* DECLARATIONS
+*=========================================================================*/
+
+/*===========================================================================
+* DEFINITIONS
+*=========================================================================*/
+// Filename used by cb_ASSERT macro
+static const char *file = "cb_ring.c";
+
+/*===========================================================================
+* FUNCTIONS
+*=========================================================================*/
+
+uint8 cbRING_init(cbRING_Ring *pRing, uint8 *pData, uint8 size)
+{
+    cb_ASSERT(pRing != NULL);
+    cb_ASSERT(pData != NULL);
+    cb_ASSERT((size != 0) && (size <= cbRING_MAX_SIZE));
+    cb_ASSERT((size & (size - 1)) == 0);
+
+    pRing->pData = pData;
+    pRing->mask  = size - 1;
+    pRing->head  = 0;
+    pRing->tail  = 0;
+
+    return cbRING_OK;
+}
+
+uint8 cbRING_put(cbRING_Ring *pRing, uint8 byte)
+{
+    uint8 head = pRing->head;
+
+    /* Ring full */
+    if ((uint8)(head - pRing->tail) > pRing->mask)
+    {
+        return cbRING_FULL;
+    }
+
+    pRing->pData[head & pRing->mask] = byte;
+
+    /* Publish the byte */
+    cbRING_BARRIER();
+    pRing->head = head + 1;
+
+    return cbRING_OK;
+}
+
+uint8 cbRING_get(cbRING_Ring *pRing, uint8 *pByte)
+{
+    uint8 tail = pRing->tail;
+
+    /* Ring empty */
+    if (pRing->head == tail)
+    {
+        return cbRING_NO_DATA;
+    }
+
+    cbRING_BARRIER();
+    *pByte = pRing->pData[tail & pRing->mask];
+
+    /* Release the byte */
+    cbRING_BARRIER();
+    pRing->tail = tail + 1;
+
+    return cbRING_OK;
+}
+
+uint8 cbRING_write(cbRING_Ring *pRing, const uint8 *pData, uint8 nBytes)
+{
+    uint8 head = pRing->head;
+    uint8 nFree;
+    uint8 i;
+
+    nFree = (pRing->mask + 1) - (uint8)(head - pRing->tail);
+    if (nBytes > nFree)
+    {
+        nBytes = nFree;
+    }
+
+    for (i = 0; i < nBytes; i++)
+    {
+        pRing->pData[(uint8)(head + i) & pRing->mask] = pData[i];
+    }
+
+    /* Publish all bytes at once */
+    cbRING_BARRIER();
+    pRing->head = head + nBytes;
+
+    return nBytes;
+}
+
+uint8 cbRING_read(cbRING_Ring *pRing, uint8 *pData, uint8 nBytes)
+{
+    uint8 tail = pRing->tail;
+    uint8 nAvail;
+    uint8 i;
+
+    nAvail = (uint8)(pRing->head - tail);
+    if (nBytes > nAvail)
+    {
+        nBytes = nAvail;
+    }
+
+    cbRING_BARRIER();
+    for (i = 0; i < nBytes; i++)
+    {
+        pData[i] = pRing->pData[(uint8)(tail + i) & pRing->mask];
+    }
+
+    /* Release all bytes at once */
+    cbRING_BARRIER();
+    pRing->tail = tail + nBytes;
+
+    return nBytes;
+}
+
+uint8 cbRING_getNoBytes(cbRING_Ring *pRing)
+{
+    return (uint8)(pRing->head - pRing->tail);
+}
+
+uint8 cbRING_getNoFreeBytes(cbRING_Ring *pRing)
+{
+    return (pRing->mask + 1) - (uint8)(pRing->head - pRing->tail);
+}
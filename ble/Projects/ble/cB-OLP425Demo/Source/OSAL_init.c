@@ -26,7 +26,9 @@
 #include "gattservapp.h"
 
 /* Profiles */
-#if defined ( PLUS_BROADCASTER )
+#if defined ( CB_CENTRAL )
+  #include "central.h"
+#elif defined ( PLUS_BROADCASTER )
   #include "peripheralBroadcaster.h"
 #else
   #include "peripheral.h"
@@ -40,6 +42,9 @@
 #include "cb_demo.h"
 #include "cb_pio.h"
 #include "cb_serial_service.h"
+#if defined ( CB_CENTRAL )
+  #include "cb_serial_client.h"
+#endif
 
 
 /*===========================================================================
@@ -71,12 +76,19 @@ const pTaskEventHandlerFn tasksArr[] =
   GAP_ProcessEvent,                                           // task 5
   GATT_ProcessEvent,                                          // task 6
   SM_ProcessEvent,                                            // task 7
+#if defined ( CB_CENTRAL )
+  GAPCentralRole_ProcessEvent,                                // task 8
+#else
   GAPRole_ProcessEvent,                                       // task 8
+#endif
   GAPBondMgr_ProcessEvent,                                    // task 9
   GATTServApp_ProcessEvent,                                   
   cbLIS_processEvent,
   cbTMP112_processEvent,
   cbSPS_processEvent,
+#if defined ( CB_CENTRAL )
+  cbSPC_processEvent,
+#endif
   cbDEMO_processEvent                                      
 };
 
@@ -131,7 +143,11 @@ void osalInitTasks( void )
   SM_Init( taskID++ );
   
   /* Profiles */
+#if defined ( CB_CENTRAL )
+  GAPCentralRole_Init( taskID++ );
+#else
   GAPRole_Init( taskID++ );
+#endif
   GAPBondMgr_Init( taskID++ );
   
   GATTServApp_Init( taskID++ );
@@ -140,6 +156,9 @@ void osalInitTasks( void )
   cbTMP112_init( taskID++ );
   
   cbSPS_init( taskID++ );
+#if defined ( CB_CENTRAL )
+  cbSPC_init( taskID++ );
+#endif
   
   /* Application */
   cbDEMO_init( taskID );
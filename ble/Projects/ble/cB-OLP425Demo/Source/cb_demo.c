@@ -41,6 +41,10 @@
 #include "peripheral.h"
 #endif
 
+#ifdef CB_CENTRAL
+#include "central.h"
+#endif
+
 #include "cb_demo.h"
 #include "cb_assert.h"
 #include "cb_assert_handler.h"
@@ -49,6 +53,7 @@
 #include "cb_lis3dh.h"
 #include "cb_led.h"
 #include "cb_ble_serial.h"
+#include "cb_buffer_static.h"
 #include "cb_log.h"
 
 // Services
@@ -59,6 +64,9 @@
 #include "cb_temperature_service.h"
 #include "cb_led_service.h"
 #include "cb_serial_service.h"
+#ifdef CB_CENTRAL
+#include "cb_serial_client.h"
+#endif
 
 
 // Filename used by cb_ASSERT macro
@@ -103,6 +111,18 @@ static const char* file = "cb_demo.c";
 // Company Identifier: Texas Instruments Inc. (13)
 #define TI_COMPANY_ID                              0x000D
 
+// Received data waiting to be echoed, a power of two
+#define ECHO_BUF_SIZE                         64
+
+#ifdef CB_CENTRAL
+// The central connects to the first demo device found, see deviceName
+#define CENTRAL_PEER_NAME                     "OLP425-"
+#define CENTRAL_PEER_NAME_LEN                 7
+
+// Delay between link establishment and starting the serial port client (in ms)
+#define CENTRAL_SPC_CONNECT_DELAY             100
+#endif
+
 
 /*===========================================================================
 * TYPES
@@ -114,9 +134,18 @@ typedef struct
   int8              currentTemperature;
   uint8             batteryLevel;
   bool              waitWrite;
+  uint8             nPendingWrites; // Echo writes not yet completed
+  uint8             nWrittenBytes;  // Echoed bytes in completed writes
   uint8             txCount;
   bool              tempSensorOk;
   bool              accelerometerOk;
+#ifdef CB_CENTRAL
+  // Link of the central role, gapProfileState uses the peripheral states
+  uint16            connHandle;
+  bool              peerFound;
+  uint8             peerAddrType;
+  uint8             peerAddr[B_ADDR_LEN];
+#endif
 } cbDEMO_Class;
 
 /*===========================================================================
@@ -124,9 +153,17 @@ typedef struct
 *=========================================================================*/
 
 static void gapApplicationInit(void);
+#ifndef CB_CENTRAL
 static void gapSetAlwaysAdvertising(void);
+#endif
 static void processOSALMsg( osal_event_hdr_t *pMsg );
+#ifdef CB_CENTRAL
+static void centralEventCB( gapCentralRoleEvent_t *pEvent );
+static void centralStartDiscovery( void );
+static bool centralIsPeer( uint8 *pData, uint8 len );
+#else
 static void peripheralStateNotificationCB( gaprole_States_t newState );
+#endif
 static void passcodeCB(uint8 *deviceAddr, uint16 connectionHandle, uint8 uiInputs, uint8 uiOutputs);
 static void pairStateCB( uint16 connHandle, uint8 state, uint8 status );
 static void accelEnablerChangeCB( void );
@@ -143,7 +180,8 @@ static void ledSetEvent(uint8 ledId, uint8 value);
 static void blsDataAvailableEvent(uint8 port);
 static void blsWriteCompleteEvent(uint8 port, uint16 nBytes);
 static void blsErrorEvent(uint8 port, uint8 error);
-
+static void fillEchoBuf(uint8 port);
+static bool echoData(uint8 port);
 
 
 // Callbacks from drivers
@@ -162,6 +200,10 @@ static void temperatureReadEvent(int8 temperature, uint16 raw);
 
 static cbDEMO_Class demo;
 
+// Echo data is moved out of the serial port rx buffer at once so that the
+// rx buffer is free for new credits while the echo is transmitted
+cbBUF_STATIC_DECLARE(echoBuf, ECHO_BUF_SIZE);
+
 // GAP - SCAN RSP data (max size = 31 bytes)
 static uint8 deviceName[] =
 {
@@ -195,11 +237,19 @@ static uint8 attDeviceName[GAP_DEVICE_NAME_LEN] = "OLP425-0000";
 
 
 // GAP Role callbacks
+#ifdef CB_CENTRAL
+static gapCentralRoleCB_t centralRoleCallbacks =
+{
+  NULL,                           // When a valid RSSI is read from controller
+  centralEventCB                  // Central role events
+};
+#else
 static gapRolesCBs_t peripheralRoleCallbacks =
 {
   peripheralStateNotificationCB,  // Profile State Change Callbacks
   NULL                            // When a valid RSSI is read from controller
 };
+#endif
 
 // GAP Bond Manager callbacks
 static gapBondCBs_t bondMgrCallbacks =
@@ -239,8 +289,14 @@ void cbDEMO_init( uint8 taskId )
   demo.currentTemperature  = 0;
   demo.batteryLevel = 100;
   demo.waitWrite = FALSE;
+  demo.nPendingWrites = 0;
+  demo.nWrittenBytes = 0;
   demo.tempSensorOk = FALSE;
   demo.accelerometerOk = FALSE;
+#ifdef CB_CENTRAL
+  demo.connHandle = INVALID_CONNHANDLE;
+  demo.peerFound = FALSE;
+#endif
   
   gapApplicationInit();
 
@@ -277,6 +333,7 @@ static void gapApplicationInit(void)
   uint16 desired_slave_latency = DEFAULT_DESIRED_SLAVE_LATENCY;
   uint16 desired_conn_timeout = DEFAULT_DESIRED_CONN_TIMEOUT;
 
+#ifndef CB_CENTRAL
   // Set the GAP Role Parameters
   GAPRole_SetParameter( GAPROLE_ADVERT_ENABLED, sizeof( uint8 ), &initial_advertising_enable );
   GAPRole_SetParameter( GAPROLE_ADVERT_OFF_TIME, sizeof( uint16 ), &gapRole_AdvertOffTime );
@@ -289,6 +346,7 @@ static void gapApplicationInit(void)
   GAPRole_SetParameter( GAPROLE_MAX_CONN_INTERVAL, sizeof( uint16 ), &desired_max_interval );
   GAPRole_SetParameter( GAPROLE_SLAVE_LATENCY, sizeof( uint16 ), &desired_slave_latency );
   GAPRole_SetParameter( GAPROLE_TIMEOUT_MULTIPLIER, sizeof( uint16 ), &desired_conn_timeout );
+#endif
 
   // Set the GAP Attributes
   GGS_SetParameter( GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN, attDeviceName );
@@ -310,6 +368,7 @@ static void gapApplicationInit(void)
   HCI_EXT_SetRxGainCmd(HCI_EXT_RX_GAIN_HIGH);
 }
 
+#ifndef CB_CENTRAL
 /*---------------------------------------------------------------------------
 * Configure the device to be always advertising.
 * Enable general advertising, one second advertising interval.
@@ -334,6 +393,7 @@ void gapSetAlwaysAdvertising(void)
   
   GAPRole_SetParameter( GAPROLE_ADVERT_ENABLED, sizeof( uint8 ), &advertising_enable );
 }
+#endif
 
 #ifdef LOGGING
 /*---------------------------------------------------------------------------
@@ -475,7 +535,11 @@ uint16 cbDEMO_processEvent( uint8 taskId, uint16 events )
     uint16 accelRange;
 
     // Start the Device
+#ifdef CB_CENTRAL
+    VOID GAPCentralRole_StartDevice( &centralRoleCallbacks );
+#else
     VOID GAPRole_StartDevice( &peripheralRoleCallbacks );
+#endif
 
     // Start Bond Manager
     VOID GAPBondMgr_Register( &bondMgrCallbacks );       
@@ -497,10 +561,12 @@ uint16 cbDEMO_processEvent( uint8 taskId, uint16 events )
     {
       cbLIS_register(wakeUpEvent, clickEvent);        
     }
+#ifndef CB_CENTRAL
     else
     {
       gapSetAlwaysAdvertising();
     }
+#endif
 
     cbBLS_init();
     cbBLS_registerCallbacks(&blsCallbacks);
@@ -548,7 +614,15 @@ uint16 cbDEMO_processEvent( uint8 taskId, uint16 events )
 
   if ( events & cbDEMO_SPS_CONNECT_EVT )
   {
-    // Ignore
+#ifdef CB_CENTRAL
+    // Start the serial port client on the link, the connect callback is
+    // called when the service has been set up
+    if ((demo.gapProfileState == GAPROLE_CONNECTED) &&
+        (cbSPC_connect(demo.connHandle) != SUCCESS))
+    {
+      cbLOG_PRINT("Serial port client not started\r\n");
+    }
+#endif
     return (events ^ cbDEMO_SPS_CONNECT_EVT);
   }
 
@@ -569,6 +643,116 @@ static void processOSALMsg( osal_event_hdr_t *pMsg )
   }
 }
 
+#ifdef CB_CENTRAL
+/*---------------------------------------------------------------------------
+* Central role event handler. The central scans for a demo device, 
+* connects to it and starts the serial port client on the link. When the
+* link is lost the scan is started again.
+* - pEvent: central role event
+*-------------------------------------------------------------------------*/
+static void centralEventCB( gapCentralRoleEvent_t *pEvent )
+{
+  switch ( pEvent->gap.opcode )
+  {
+  case GAP_DEVICE_INIT_DONE_EVENT:
+    demo.gapProfileState = GAPROLE_STARTED;
+    updateNameWithAddressInfo();
+    cbLOG_PRINT("GAP State: Started\r\n");
+
+    centralStartDiscovery();
+    break;
+
+  case GAP_DEVICE_INFO_EVENT:
+    if ((demo.peerFound == FALSE) &&
+        (pEvent->deviceInfo.eventType == GAP_ADRPT_SCAN_RSP) &&
+        (centralIsPeer(pEvent->deviceInfo.pEvtData, pEvent->deviceInfo.dataLen) == TRUE))
+    {
+      demo.peerFound = TRUE;
+      demo.peerAddrType = pEvent->deviceInfo.addrType;
+      osal_memcpy(demo.peerAddr, pEvent->deviceInfo.addr, B_ADDR_LEN);
+    }
+    break;
+
+  case GAP_DEVICE_DISCOVERY_EVENT:
+    if (demo.peerFound == TRUE)
+    {
+      cbLOG_PRINT("GAP State: Connecting\r\n");
+      VOID GAPCentralRole_EstablishLink(FALSE, FALSE, demo.peerAddrType, demo.peerAddr);
+    }
+    else
+    {
+      centralStartDiscovery();
+    }
+    break;
+
+  case GAP_LINK_ESTABLISHED_EVENT:
+    if (pEvent->gap.hdr.status == SUCCESS)
+    {
+      cbLOG_PRINT("GAP State: Connected\r\n");
+
+      demo.gapProfileState = GAPROLE_CONNECTED;
+      demo.connHandle = pEvent->linkCmpl.connectionHandle;
+
+      osal_start_timerEx(demo.taskId, cbDEMO_SPS_CONNECT_EVT, CENTRAL_SPC_CONNECT_DELAY);
+    }
+    else
+    {
+      centralStartDiscovery();
+    }
+    break;
+
+  case GAP_LINK_TERMINATED_EVENT:
+    cbLOG_PRINT("GAP State: Waiting\r\n");
+
+    demo.gapProfileState = GAPROLE_WAITING;
+    demo.connHandle = INVALID_CONNHANDLE;
+
+    centralStartDiscovery();
+    break;
+
+  default:
+    break;
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Scan for demo devices. Scan responses are requested since they hold 
+* the device name.
+*-------------------------------------------------------------------------*/
+static void centralStartDiscovery( void )
+{
+  demo.peerFound = FALSE;
+
+  VOID GAPCentralRole_StartDiscovery(DEVDISC_MODE_ALL, TRUE, FALSE);
+}
+
+/*---------------------------------------------------------------------------
+* Check if scan response data holds the name of a demo device.
+* - pData: advertising data structures
+* - len: length of the data
+*-------------------------------------------------------------------------*/
+static bool centralIsPeer( uint8 *pData, uint8 len )
+{
+  uint8 i = 0;
+
+  // Each data structure is length, AD type and data
+  while ((i + 1) < len)
+  {
+    if ((pData[i + 1] == GAP_ADTYPE_LOCAL_NAME_COMPLETE) &&
+        (pData[i] > CENTRAL_PEER_NAME_LEN) &&
+        ((i + 1 + pData[i]) <= len) &&
+        (osal_memcmp(&pData[i + 2], CENTRAL_PEER_NAME, CENTRAL_PEER_NAME_LEN) == TRUE))
+    {
+      return TRUE;
+    }
+
+    i += pData[i] + 1;
+  }
+
+  return FALSE;
+}
+
+#else
 /*---------------------------------------------------------------------------
 * Peripheral role of a state change handler.
 * - newState: new state
@@ -650,6 +834,7 @@ static void peripheralStateNotificationCB( gaprole_States_t newState )
 
   demo.gapProfileState = newState;
 }
+#endif
 
 /*---------------------------------------------------------------------------
 * Called by the Accelerometer Profile when the Enabler Attribute
@@ -705,7 +890,9 @@ static void accelRead( void )
 *-------------------------------------------------------------------------*/
 void wakeUpEvent(void)
 {
+#ifndef CB_CENTRAL
   uint8 advertEnabled = TRUE;
+#endif
 
   // Updated the battery level in the battery service
   // Do not update when radio is active
@@ -718,7 +905,9 @@ void wakeUpEvent(void)
   
   cbLOG_PRINT("Wake up event\r\n");      
 
+#ifndef CB_CENTRAL
   GAPRole_SetParameter( GAPROLE_ADVERT_ENABLED, sizeof( uint8 ), &advertEnabled );      
+#endif
 }
 
 /*---------------------------------------------------------------------------
@@ -735,32 +924,18 @@ void clickEvent(void)
 *-------------------------------------------------------------------------*/
 void blsWriteCompleteEvent(uint8 port, uint16 nBytes)
 {
-  int8 res;
-  uint8 *pBuf;
-
   cb_ASSERT(demo.waitWrite == TRUE);
+  cb_ASSERT(demo.nPendingWrites > 0);
 
-  res = cbBLS_readBufConsumed(port, nBytes);
-  cb_ASSERT(res == SUCCESS);
+  demo.nWrittenBytes += nBytes;
+  demo.nPendingWrites--;
 
-  res = cbBLS_getReadBuf(port,&pBuf, &nBytes);
-  if (res == SUCCESS)
+  if (demo.nPendingWrites == 0)
   {
-    cb_ASSERT((pBuf != NULL) && (nBytes > 0));
+    cbBUF_STATIC_READ_CONSUMED(echoBuf, demo.nWrittenBytes);
 
-    res = cbBLS_write(port, pBuf, MIN(nBytes, cbSPS_FIFO_SIZE));
-    if (res == SUCCESS)
-    {
-      demo.waitWrite = TRUE;
-    }
-    else
-    {
-      demo.waitWrite = FALSE;
-    }
-  }
-  else
-  {
-    demo.waitWrite = FALSE;
+    fillEchoBuf(port);
+    demo.waitWrite = echoData(port);
   }
 }
 
@@ -769,28 +944,87 @@ void blsWriteCompleteEvent(uint8 port, uint16 nBytes)
 *-------------------------------------------------------------------------*/
 void blsDataAvailableEvent(uint8 port)
 {
-  int8 res;
-  uint8 *pBuf;
-  uint16 nBytes;
-
   cbLOG_PRINT(".");
 
+  fillEchoBuf(port);
+
   if (demo.waitWrite == FALSE)
   {
-    res = cbBLS_getReadBuf(port, &pBuf, &nBytes);
-    cb_ASSERT((res == SUCCESS) && (pBuf != NULL) && (nBytes > 0));
-
 #if 0
     // Flash LEDs when echoing data
     cbLED_flash(cbLED_GREEN, 1, 30, 10);
 #endif
 
-    res = cbBLS_write(port, pBuf, MIN(nBytes, cbSPS_FIFO_SIZE));
+    demo.waitWrite = echoData(port);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Move received data to the echo buffer, as much as there is room for.
+*-------------------------------------------------------------------------*/
+static void fillEchoBuf(uint8 port)
+{
+  int8 res;
+  uint8* pBuf;
+  uint16 size;
+
+  while ((!cbBUF_STATIC_IS_FULL(echoBuf)) &&
+         (cbBLS_getReadBuf(port, &pBuf, &size) == SUCCESS))
+  {
+    size = MIN(size, cbBUF_STATIC_GET_WRITE_SIZE(echoBuf));
+
+    osal_memcpy(cbBUF_STATIC_GET_WRITE_BUF(echoBuf), pBuf, size);
+    cbBUF_STATIC_WRITE_PRODUCED(echoBuf, size);
+
+    res = cbBLS_readBufConsumed(port, size);
+    cb_ASSERT(res == SUCCESS);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Echo received data. Data on both sides of the echo buffer wrap-around is
+* written at once so that it can be sent in the same fifo packet. Data 
+* that cannot be written, e.g. after a disconnect, is thrown away as the 
+* rx buffer is.
+* Returns TRUE if a write was started.
+*-------------------------------------------------------------------------*/
+static bool echoData(uint8 port)
+{
+  int8 res;
+  uint8 nBytes;
+  uint8 size;
+  uint8 size2;
+
+  demo.nPendingWrites = 0;
+  demo.nWrittenBytes = 0;
+
+  nBytes = cbBUF_STATIC_GET_NO_BYTES(echoBuf);
+  if (nBytes > 0)
+  {
+    size = MIN(cbBUF_STATIC_GET_READ_SIZE(echoBuf), cbSPS_MAX_FIFO_SIZE);
+    size2 = MIN(nBytes - size, cbSPS_MAX_FIFO_SIZE - size);
+
+    res = cbBLS_write(port, cbBUF_STATIC_GET_READ_BUF(echoBuf), size);
     if (res == SUCCESS)
     {
-      demo.waitWrite = TRUE;
+      demo.nPendingWrites++;
+
+      if (size2 > 0)
+      {
+        res = cbBLS_write(port, cbBUF_STATIC_GET_WRAP_BUF(echoBuf), size2);
+        if (res == SUCCESS)
+        {
+          demo.nPendingWrites++;
+        }
+      }
+    }
+    else
+    {
+      cbBUF_STATIC_CLEAR(echoBuf);
     }
   }
+
+  return (demo.nPendingWrites > 0);
 }
 
 void blsErrorEvent(uint8 port, uint8 error)
@@ -885,7 +1119,11 @@ void updateNameWithAddressInfo(void)
   uint8 address[6];
   uint8 value;
 
+#ifdef CB_CENTRAL
+  status = GAPCentralRole_GetParameter(GAPCENTRALROLE_BD_ADDR, address);
+#else
   status = GAPRole_GetParameter(GAPROLE_BD_ADDR, address);
+#endif
   cb_ASSERT(status == SUCCESS);
 
   value = (address[1] & 0xF0) >> 4;
@@ -904,8 +1142,10 @@ void updateNameWithAddressInfo(void)
   osal_memcpy(&attDeviceName[7], numberString, 4);
   osal_memcpy(&deviceName[9], numberString, 4);
 
+#ifndef CB_CENTRAL
   status = GAPRole_SetParameter( GAPROLE_SCAN_RSP_DATA, sizeof ( deviceName ), deviceName );
   cb_ASSERT(status == SUCCESS);
+#endif
 
   status = GGS_SetParameter( GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN - 1, attDeviceName );  
   cb_ASSERT(status == SUCCESS);  
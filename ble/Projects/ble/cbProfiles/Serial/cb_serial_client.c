@@ -0,0 +1,981 @@
+/*---------------------------------------------------------------------------
+* Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+* Any reproduction without written permission is prohibited by law.
+*
+* Component   : Serial Port Client
+* File        : cb_serial_client.c
+*
+* Description : Implementation of the central side of the Serial Port
+*               Service. Only built when CB_CENTRAL is defined.
+*
+*               The application creates the link and then calls
+*               cbSPC_connect. The client discovers the service, enables
+*               notifications (or indications) on the fifo, exchanges the
+*               ATT MTU and then enables the credits characteristic, after
+*               which the service considers the link connected. The MTU is
+*               exchanged first so that both sides give credits for the
+*               fifo payload of the link. Fifo data and credits are then
+*               sent as write commands and received as notifications. As
+*               in the service, fifo data is only sent when the remote
+*               side has given credits. The client always uses credits
+*               mode.
+*-------------------------------------------------------------------------*/
+#ifdef CB_CENTRAL
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_Timers.h"
+#include "linkdb.h"
+#include "att.h"
+#include "gatt.h"
+#include "cb_log.h"
+
+#include "cb_assert.h"
+#include "cb_serial_client.h"
+#include "central.h"
+
+/*===========================================================================
+* DEFINES
+*=========================================================================*/
+#ifndef cbSPC_MAX_CALLBACKS
+#define cbSPC_MAX_CALLBACKS (2)
+#endif
+
+#define cbSPC_POLL_TX_EVENT                           (1 << 0)
+#define cbSPC_TX_POLL_TIMEOUT_IN_MS                   (10)
+
+// Length of a discovered characteristic declaration with a 128 bit UUID:
+// handle (2), properties (1), value handle (2) and UUID (16)
+#define cbSPC_CHAR_DECL_LEN                           (5 + ATT_UUID_SIZE)
+
+// Client configuration written to the fifo and credits characteristics
+#ifdef cbSPS_INDICATIONS
+#define cbSPC_CHAR_CFG                                GATT_CLIENT_CFG_INDICATE
+#else
+#define cbSPC_CHAR_CFG                                GATT_CLIENT_CFG_NOTIFY
+#endif
+
+/*===========================================================================
+* TYPES
+*=========================================================================*/
+typedef enum
+{
+  SPC_S_NOT_VALID = 0,
+  SPC_S_IDLE,
+  SPC_S_DISC_SERVICE,
+  SPC_S_DISC_CHARS,
+  SPC_S_ENABLE_FIFO,
+  SPC_S_EXCHANGE_MTU,
+  SPC_S_ENABLE_CREDITS,
+  SPC_S_CONNECTED
+
+} cbSPC_State;
+
+typedef struct
+{
+  uint8         taskId;
+  cbSPC_State   state;
+  bool          enabled;
+  uint8         txCredits; // Number of packets that can be sent
+  uint8         rxCredits; // Number of packets that remote side can send
+  uint16        connHandle;
+
+  // Service found on the remote side
+  uint16        startHandle;
+  uint16        endHandle;
+  uint16        fifoHandle;
+  uint16        creditsHandle;
+
+  uint16        remainingBufSize;
+  uint8         fifoSize;      // Fifo payload size, negotiated ATT MTU - 3
+
+  uint8         *pPendingTxBuf;
+  uint8         pendingTxBufSize;
+  uint8         *pPendingTxBuf2;    // Optional second part of pending data
+  uint8         pendingTxBufSize2;
+
+  bool          txBurstActive; // Set while pollTx sends a burst of fifo data
+
+  // Received data that did not fit in the rx buffer. Only expected if
+  // the remote side sends without credits.
+  uint32        nLostBytes;
+} cbSPC_Class;
+
+/*===========================================================================
+* DECLARATIONS
+*=========================================================================*/
+static void handleConnStatusCB( uint16 connHandle, uint8 changeType );
+static void handleGattMsg(gattMsgEvent_t *pMsg);
+static void handleServiceDisc(gattMsgEvent_t *pMsg);
+static void handleCharDisc(gattMsgEvent_t *pMsg);
+static void handleCharCfgRsp(gattMsgEvent_t *pMsg);
+static void handleValue(uint16 handle, uint8 *pValue, uint8 len);
+static bStatus_t writeCharCfg(uint16 valueHandle);
+static void exchangeMtu(void);
+static void enableCredits(void);
+static void setupFailed(void);
+
+static void creditsReceiveHandler(uint8 credits);
+static uint8 getNewRxCredits(void);
+static void fifoReceiveHandler(uint8 *pBuf, uint8 size);
+
+static bStatus_t writeFifo(uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2);
+static bStatus_t writeCredits(uint8 credits);
+
+static void connectEvtCallback(uint16 connHandle);
+static void disconnectEvtCallback(uint16 connHandle);
+static void dataEvtCallback(uint16 connHandle, uint8 *pBuf, uint8 size);
+static void dataCnfCallback(uint16 connHandle);
+static void fifoSizeEvtCallback(uint16 connHandle, uint8 fifoSize);
+
+static void setMtu(uint16 mtu);
+static void pollTx(void);
+static bStatus_t txBurst(void);
+static void resetLink(void);
+
+/*===========================================================================
+* DEFINITIONS
+*=========================================================================*/
+// Filename used by cb_ASSERT macro
+static const char *file = "SPC";
+
+static CONST uint8 spcServUUID[ATT_UUID_SIZE] = { cbSPS_SERIAL_SERVICE_UUID };
+static CONST uint8 spcFifoUUID[ATT_UUID_SIZE] = { cbSPS_FIFO_UUID };
+static CONST uint8 spcCreditsUUID[ATT_UUID_SIZE] = { cbSPS_CREDITS_UUID };
+
+// Fifo write command. Data may be written directly into the value, see
+// cbSPC_getTxSlot.
+static attWriteReq_t fifoReq;
+
+static cbSPS_Callbacks *spcCallbacks[cbSPC_MAX_CALLBACKS] = {NULL, NULL};
+static cbSPC_Class spc;
+
+/*===========================================================================
+* FUNCTIONS
+*=========================================================================*/
+
+void cbSPC_init(uint8 taskId)
+{
+  spc.taskId = taskId;
+  spc.state = SPC_S_IDLE;
+  spc.enabled = FALSE;
+  spc.txBurstActive = FALSE;
+  resetLink();
+
+  linkDB_Register( handleConnStatusCB );
+
+  // Fifo data and credits are received as notifications or indications
+  GATT_RegisterForInd(taskId);
+#ifdef ATT_MTU_UPDATED_EVENT
+  GATT_RegisterForMsgs(taskId);
+#endif
+}
+
+/*---------------------------------------------------------------------------
+* Register callback functions
+*-------------------------------------------------------------------------*/
+void cbSPC_register(cbSPS_Callbacks *pCallbacks)
+{
+  uint8 i;
+  bool  found = FALSE;
+
+  cb_ASSERT(pCallbacks != NULL);
+
+  for (i = 0; ((i < cbSPC_MAX_CALLBACKS) && (found == FALSE)); i++)
+  {
+    if (spcCallbacks[i] == NULL)
+    {
+      spcCallbacks[i] = pCallbacks;
+      found = TRUE;
+    }
+  }
+  cb_ASSERT(found == TRUE);
+}
+
+/*---------------------------------------------------------------------------
+* Description of function. Optional verbose description.
+*-------------------------------------------------------------------------*/
+uint16 cbSPC_processEvent(uint8 taskId, uint16 events)
+{
+  if ((events & SYS_EVENT_MSG) != 0)
+  {
+    uint8* pMsg = osal_msg_receive(spc.taskId);
+
+    if ( pMsg != NULL )
+    {
+      if (((osal_event_hdr_t*)pMsg)->event == GATT_MSG_EVENT)
+      {
+        handleGattMsg((gattMsgEvent_t*)pMsg);
+      }
+
+      osal_msg_deallocate(pMsg);
+    }
+
+    return (events ^ SYS_EVENT_MSG);
+  }
+
+  if ((events & cbSPC_POLL_TX_EVENT) != 0)
+  {
+    // Tx pending fifo data or send new credits to remote side
+    pollTx();
+    return (events ^ cbSPC_POLL_TX_EVENT);
+  }
+
+  return 0;
+}
+
+/*---------------------------------------------------------------------------
+* Start the serial port protocol on a link created by the application.
+* The connect callback is called when the service has been discovered and
+* the fifo and credits characteristics have been enabled. If the remote
+* side has no serial port service the link is left as it is.
+*-------------------------------------------------------------------------*/
+uint8 cbSPC_connect(uint16 connHandle)
+{
+  bStatus_t status = FAILURE;
+
+  if ((spc.enabled == TRUE) && (spc.state == SPC_S_IDLE))
+  {
+    status = GATT_DiscPrimaryServiceByUUID(connHandle, (uint8*)spcServUUID,
+                                           ATT_UUID_SIZE, spc.taskId);
+    if (status == SUCCESS)
+    {
+      spc.connHandle = connHandle;
+      spc.state = SPC_S_DISC_SERVICE;
+    }
+  }
+
+  return status;
+}
+
+/*---------------------------------------------------------------------------
+* Write fifo data. The data is sent when the remote side has given credits.
+*-------------------------------------------------------------------------*/
+uint8 cbSPC_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+  return cbSPC_reqDataVec(connHandle, pBuf, size, NULL, 0);
+}
+
+/*---------------------------------------------------------------------------
+* Write fifo data from two buffers. The two parts are sent in one fifo
+* packet, e.g. data on both sides of a circular buffer wrap-around.
+*-------------------------------------------------------------------------*/
+uint8 cbSPC_reqDataVec(uint16 connHandle, uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2)
+{
+  bStatus_t status = FAILURE;
+
+  cb_ASSERT(size != 0);
+  cb_ASSERT(pBuf != NULL);
+  cb_ASSERT((size2 == 0) || (pBuf2 != NULL));
+  cb_ASSERT(spc.pPendingTxBuf == NULL);
+
+  if (spc.state == SPC_S_CONNECTED)
+  {
+    spc.pPendingTxBuf = pBuf;
+    spc.pendingTxBufSize = size;
+    spc.pPendingTxBuf2 = pBuf2;
+    spc.pendingTxBufSize2 = size2;
+    status = SUCCESS;
+
+    if (spc.txBurstActive == FALSE)
+    {
+      // During a burst the data is picked up by the ongoing poll
+      osal_set_event(spc.taskId, cbSPC_POLL_TX_EVENT);
+    }
+  }
+
+  return status;
+}
+
+/*---------------------------------------------------------------------------
+* Get the value of the fifo write command so that the data of the next
+* packet can be written in place, see cbSPS_getTxSlot.
+*-------------------------------------------------------------------------*/
+uint8* cbSPC_getTxSlot(uint16 connHandle, uint8 *pSize)
+{
+  cb_ASSERT(pSize != NULL);
+
+  if ((spc.state != SPC_S_CONNECTED) || (spc.pPendingTxBuf != NULL))
+  {
+    *pSize = 0;
+    return NULL;
+  }
+
+  *pSize = spc.fifoSize;
+
+  return fifoReq.value;
+}
+
+/*---------------------------------------------------------------------------
+* Set the free size of the rx buffer. New credits are given to the remote
+* side as in the service, see cbSPS_RX_CREDITS_LOW_WATER. As in the
+* service the size is lowered for each received packet.
+*-------------------------------------------------------------------------*/
+uint8 cbSPC_setRemainingBufSize(uint16 connHandle, uint16 size)
+{
+  bStatus_t status = FAILURE;
+
+  if (spc.state == SPC_S_CONNECTED)
+  {
+    spc.remainingBufSize = size;
+
+    // Only poll if new credits can be given
+    if (getNewRxCredits() > 0)
+    {
+      osal_set_event(spc.taskId, cbSPC_POLL_TX_EVENT);
+    }
+    status = SUCCESS;
+  }
+
+  return status;
+}
+
+/*---------------------------------------------------------------------------
+* Get the fifo payload size used on the link.
+*-------------------------------------------------------------------------*/
+uint8 cbSPC_getFifoSize(uint16 connHandle)
+{
+  return spc.fifoSize;
+}
+
+/*---------------------------------------------------------------------------
+* Report received fifo data that was lost.
+*-------------------------------------------------------------------------*/
+void cbSPC_addLostBytes(uint16 connHandle, uint16 nBytes)
+{
+  if (spc.state == SPC_S_CONNECTED)
+  {
+    spc.nLostBytes += nBytes;
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Description of function. Optional verbose description.
+*-------------------------------------------------------------------------*/
+void cbSPC_enable(void)
+{
+  spc.enabled = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+* Description of function. Optional verbose description.
+*-------------------------------------------------------------------------*/
+void cbSPC_disable(void)
+{
+  spc.enabled = FALSE;
+
+  if (spc.state != SPC_S_IDLE)
+  {
+    // The disconnect callback is called when the link is removed
+    GAPCentralRole_TerminateLink(spc.connHandle);
+  }
+}
+
+/*===========================================================================
+* STATIC FUNCTIONS
+*=========================================================================*/
+
+/*---------------------------------------------------------------------------
+* Connection status callback
+*-------------------------------------------------------------------------*/
+static void handleConnStatusCB( uint16 connHandle, uint8 changeType )
+{
+  if ((connHandle == spc.connHandle) &&
+      ((changeType == LINKDB_STATUS_UPDATE_REMOVED) ||
+       ((changeType == LINKDB_STATUS_UPDATE_STATEFLAGS) && (!linkDB_Up(connHandle)))))
+  {
+    switch (spc.state)
+    {
+    case SPC_S_CONNECTED:
+      spc.state = SPC_S_IDLE;
+      resetLink();
+
+      disconnectEvtCallback(connHandle);
+      break;
+
+    default:
+      // Link lost during service setup
+      spc.state = SPC_S_IDLE;
+      resetLink();
+      break;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Handle GATT responses, notifications and indications
+*-------------------------------------------------------------------------*/
+static void handleGattMsg(gattMsgEvent_t *pMsg)
+{
+  if (pMsg->connHandle != spc.connHandle)
+  {
+    return;
+  }
+
+  switch (pMsg->method)
+  {
+  case ATT_HANDLE_VALUE_NOTI:
+    handleValue(pMsg->msg.handleValueNoti.handle,
+                pMsg->msg.handleValueNoti.value,
+                pMsg->msg.handleValueNoti.len);
+    break;
+
+  case ATT_HANDLE_VALUE_IND:
+    handleValue(pMsg->msg.handleValueInd.handle,
+                pMsg->msg.handleValueInd.value,
+                pMsg->msg.handleValueInd.len);
+    ATT_HandleValueCfm(pMsg->connHandle);
+    break;
+
+#ifdef ATT_MTU_UPDATED_EVENT
+  case ATT_MTU_UPDATED_EVENT:
+    setMtu(pMsg->msg.mtuEvt.MTU);
+    break;
+#endif
+
+  default:
+    // A timed out or failed procedure gives no further responses
+    if ((spc.state != SPC_S_IDLE) && (spc.state != SPC_S_CONNECTED) &&
+        (pMsg->hdr.status != SUCCESS) &&
+        (pMsg->hdr.status != bleProcedureComplete))
+    {
+      setupFailed();
+      break;
+    }
+
+    switch (spc.state)
+    {
+    case SPC_S_DISC_SERVICE:
+      handleServiceDisc(pMsg);
+      break;
+
+    case SPC_S_DISC_CHARS:
+      handleCharDisc(pMsg);
+      break;
+
+    case SPC_S_ENABLE_FIFO:
+    case SPC_S_EXCHANGE_MTU:
+    case SPC_S_ENABLE_CREDITS:
+      handleCharCfgRsp(pMsg);
+      break;
+
+    default:
+      break;
+    }
+    break;
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Handle the result of the service discovery and start discovering the
+* characteristics of the service.
+*-------------------------------------------------------------------------*/
+static void handleServiceDisc(gattMsgEvent_t *pMsg)
+{
+  bStatus_t status;
+
+  if ((pMsg->method == ATT_FIND_BY_TYPE_VALUE_RSP) &&
+      (pMsg->msg.findByTypeValueRsp.numInfo > 0))
+  {
+    spc.startHandle = pMsg->msg.findByTypeValueRsp.handlesInfo[0].handle;
+    spc.endHandle = pMsg->msg.findByTypeValueRsp.handlesInfo[0].grpEndHandle;
+  }
+
+  if (((pMsg->method == ATT_FIND_BY_TYPE_VALUE_RSP) &&
+       (pMsg->hdr.status == bleProcedureComplete)) ||
+      (pMsg->method == ATT_ERROR_RSP))
+  {
+    if (spc.startHandle != 0)
+    {
+      status = GATT_DiscAllChars(spc.connHandle, spc.startHandle,
+                                 spc.endHandle, spc.taskId);
+      if (status == SUCCESS)
+      {
+        spc.state = SPC_S_DISC_CHARS;
+      }
+      else
+      {
+        setupFailed();
+      }
+    }
+    else
+    {
+      // No serial port service on the remote side
+      setupFailed();
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Find the fifo and credits characteristics and enable the fifo.
+*-------------------------------------------------------------------------*/
+static void handleCharDisc(gattMsgEvent_t *pMsg)
+{
+  uint8 i;
+  uint8 *pPair;
+
+  if ((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+      (pMsg->msg.readByTypeRsp.len == cbSPC_CHAR_DECL_LEN))
+  {
+    for (i = 0; i < pMsg->msg.readByTypeRsp.numPairs; i++)
+    {
+      pPair = &pMsg->msg.readByTypeRsp.dataList[i * cbSPC_CHAR_DECL_LEN];
+
+      if (osal_memcmp(&pPair[5], spcFifoUUID, ATT_UUID_SIZE) == TRUE)
+      {
+        spc.fifoHandle = BUILD_UINT16(pPair[3], pPair[4]);
+      }
+      else if (osal_memcmp(&pPair[5], spcCreditsUUID, ATT_UUID_SIZE) == TRUE)
+      {
+        spc.creditsHandle = BUILD_UINT16(pPair[3], pPair[4]);
+      }
+    }
+  }
+
+  if (((pMsg->method == ATT_READ_BY_TYPE_RSP) &&
+       (pMsg->hdr.status == bleProcedureComplete)) ||
+      (pMsg->method == ATT_ERROR_RSP))
+  {
+    if ((spc.fifoHandle != 0) && (spc.creditsHandle != 0) &&
+        (writeCharCfg(spc.fifoHandle) == SUCCESS))
+    {
+      spc.state = SPC_S_ENABLE_FIFO;
+    }
+    else
+    {
+      setupFailed();
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* The fifo is enabled before the credits. The service treats the link as
+* connected when the credits are enabled. In between the ATT MTU is
+* exchanged, the link stays at the default MTU if the remote side does not
+* support it.
+*-------------------------------------------------------------------------*/
+static void handleCharCfgRsp(gattMsgEvent_t *pMsg)
+{
+  switch (spc.state)
+  {
+  case SPC_S_ENABLE_FIFO:
+    if (pMsg->method == ATT_WRITE_RSP)
+    {
+      exchangeMtu();
+    }
+    else if (pMsg->method == ATT_ERROR_RSP)
+    {
+      setupFailed();
+    }
+    break;
+
+  case SPC_S_EXCHANGE_MTU:
+    if (pMsg->method == ATT_EXCHANGE_MTU_RSP)
+    {
+      // The smaller of the two rx MTUs is used
+      setMtu(MIN(pMsg->msg.exchangeMTURsp.serverRxMTU, ATT_MTU_SIZE));
+      enableCredits();
+    }
+    else if (pMsg->method == ATT_ERROR_RSP)
+    {
+      enableCredits();
+    }
+    break;
+
+  case SPC_S_ENABLE_CREDITS:
+    if (pMsg->method == ATT_WRITE_RSP)
+    {
+      spc.state = SPC_S_CONNECTED;
+      connectEvtCallback(spc.connHandle);
+    }
+    else if (pMsg->method == ATT_ERROR_RSP)
+    {
+      setupFailed();
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Request the largest MTU of the stack. If the request cannot be sent the
+* default MTU is used.
+*-------------------------------------------------------------------------*/
+static void exchangeMtu(void)
+{
+  attExchangeMTUReq_t req;
+
+  req.clientRxMTU = ATT_MTU_SIZE;
+
+  if (GATT_ExchangeMTU(spc.connHandle, &req, spc.taskId) == SUCCESS)
+  {
+    spc.state = SPC_S_EXCHANGE_MTU;
+  }
+  else
+  {
+    enableCredits();
+  }
+}
+
+static void enableCredits(void)
+{
+  if (writeCharCfg(spc.creditsHandle) == SUCCESS)
+  {
+    spc.state = SPC_S_ENABLE_CREDITS;
+  }
+  else
+  {
+    setupFailed();
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Write the client characteristic configuration of a characteristic. In
+* the service the configuration directly follows the value.
+*-------------------------------------------------------------------------*/
+static bStatus_t writeCharCfg(uint16 valueHandle)
+{
+  attWriteReq_t req;
+
+  req.handle = valueHandle + 1;
+  req.len = 2;
+  req.value[0] = LO_UINT16(cbSPC_CHAR_CFG);
+  req.value[1] = HI_UINT16(cbSPC_CHAR_CFG);
+  req.sig = FALSE;
+  req.cmd = FALSE;
+
+  return GATT_WriteCharValue(spc.connHandle, &req, spc.taskId);
+}
+
+/*---------------------------------------------------------------------------
+* The service could not be set up. The link is left to the application.
+*-------------------------------------------------------------------------*/
+static void setupFailed(void)
+{
+  spc.state = SPC_S_IDLE;
+  resetLink();
+}
+
+/*---------------------------------------------------------------------------
+* Handle a notified or indicated value
+*-------------------------------------------------------------------------*/
+static void handleValue(uint16 handle, uint8 *pValue, uint8 len)
+{
+  if (spc.state == SPC_S_CONNECTED)
+  {
+    if (handle == spc.fifoHandle)
+    {
+      fifoReceiveHandler(pValue, len);
+    }
+    else if ((handle == spc.creditsHandle) && (len == 1))
+    {
+      creditsReceiveHandler(pValue[0]);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* The fifo payload follows the negotiated ATT MTU, limited to 
+* cbSPS_MAX_FIFO_SIZE, as cbSPS_setMtu of the service.
+*-------------------------------------------------------------------------*/
+static void setMtu(uint16 mtu)
+{
+  uint8 fifoSize;
+
+  if (mtu < cbSPS_DEFAULT_MTU_SIZE)
+  {
+    mtu = cbSPS_DEFAULT_MTU_SIZE;
+  }
+
+  fifoSize = (uint8)MIN(mtu - 3, cbSPS_MAX_FIFO_SIZE);
+
+  if (fifoSize != spc.fifoSize)
+  {
+    spc.fifoSize = fifoSize;
+    fifoSizeEvtCallback(spc.connHandle, fifoSize);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* This operation sends credits and data, as pollTx of the service. Fifo
+* data written to a lower layer is confirmed immediately. If the stack
+* has no free buffers a new poll is trigged after a timeout.
+*-------------------------------------------------------------------------*/
+static void pollTx(void)
+{
+  bStatus_t status = SUCCESS;
+  uint8 newCredits;
+
+  if (spc.state == SPC_S_CONNECTED)
+  {
+    newCredits = getNewRxCredits();
+
+    if (newCredits > 0)
+    {
+      status = writeCredits(newCredits);
+
+      if (status == SUCCESS)
+      {
+        spc.rxCredits += newCredits;
+      }
+    }
+
+    if ((status == SUCCESS) &&
+        (spc.pPendingTxBuf != NULL) &&
+        (spc.txCredits > 0))
+    {
+      status = txBurst();
+
+      if ((status == SUCCESS) &&
+          (spc.pPendingTxBuf != NULL) &&
+          (spc.txCredits > 0))
+      {
+        // Burst limit reached, continue in next poll
+        osal_set_event(spc.taskId, cbSPC_POLL_TX_EVENT);
+      }
+    }
+
+    if (status != SUCCESS)
+    {
+      osal_start_timerEx(spc.taskId, cbSPC_POLL_TX_EVENT, cbSPC_TX_POLL_TIMEOUT_IN_MS);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Send pending fifo data as long as there are credits, the stack accepts
+* the write commands and the data cnf callback provides more data. At most
+* cbSPS_MAX_TX_BURST packets are sent. Returns the status of the last
+* write.
+*-------------------------------------------------------------------------*/
+static bStatus_t txBurst(void)
+{
+  bStatus_t status;
+  uint8     nPackets = 0;
+
+  spc.txBurstActive = TRUE;
+
+  do
+  {
+    status = writeFifo(spc.pPendingTxBuf, spc.pendingTxBufSize,
+                       spc.pPendingTxBuf2, spc.pendingTxBufSize2);
+
+    if (status == SUCCESS)
+    {
+      nPackets++;
+      spc.txCredits--;
+      spc.pPendingTxBuf = NULL;
+      spc.pendingTxBufSize = 0;
+      spc.pPendingTxBuf2 = NULL;
+      spc.pendingTxBufSize2 = 0;
+
+      // The callback may request more data to be sent
+      dataCnfCallback(spc.connHandle);
+    }
+  } while ((status == SUCCESS) &&
+           (spc.pPendingTxBuf != NULL) &&
+           (spc.txCredits > 0) &&
+           (nPackets < cbSPS_MAX_TX_BURST));
+
+  spc.txBurstActive = FALSE;
+
+  return status;
+}
+
+/*---------------------------------------------------------------------------
+* Reset link variables
+*-------------------------------------------------------------------------*/
+static void resetLink(void)
+{
+  spc.txCredits = 0;
+  spc.rxCredits = 0;
+  spc.connHandle = INVALID_CONNHANDLE;
+  spc.startHandle = 0;
+  spc.endHandle = 0;
+  spc.fifoHandle = 0;
+  spc.creditsHandle = 0;
+  spc.remainingBufSize = 0;
+  spc.fifoSize = cbSPS_DEFAULT_FIFO_SIZE;
+  spc.nLostBytes = 0;
+  spc.pPendingTxBuf = NULL;
+  spc.pendingTxBufSize = 0;
+  spc.pPendingTxBuf2 = NULL;
+  spc.pendingTxBufSize2 = 0;
+}
+
+/*---------------------------------------------------------------------------
+* Number of new rx credits that can be given, see getNewRxCredits of the
+* service. The client gives no credits before the MTU exchange, so they
+* are counted at the fifo size of the link.
+*-------------------------------------------------------------------------*/
+static uint8 getNewRxCredits(void)
+{
+  uint16 committed = (uint16)spc.rxCredits * spc.fifoSize;
+
+  if ((spc.rxCredits > cbSPS_RX_CREDITS_LOW_WATER) ||
+      (spc.remainingBufSize < (committed + spc.fifoSize)))
+  {
+    return 0;
+  }
+
+  return (uint8)MIN((spc.remainingBufSize - committed) / spc.fifoSize, 0xFF - spc.rxCredits);
+}
+
+/*---------------------------------------------------------------------------
+* Handle received credits
+*-------------------------------------------------------------------------*/
+static void creditsReceiveHandler(uint8 credits)
+{
+  cb_ASSERT(credits != 0);
+
+  spc.txCredits += credits;
+  osal_set_event(spc.taskId, cbSPC_POLL_TX_EVENT);
+}
+
+/*---------------------------------------------------------------------------
+* Handle incoming fifo data
+*-------------------------------------------------------------------------*/
+static void fifoReceiveHandler(uint8 *pBuf, uint8 size)
+{
+  if (spc.rxCredits > 0)
+  {
+    spc.rxCredits--;
+  }
+
+  spc.remainingBufSize -= MIN(size, spc.remainingBufSize);
+  dataEvtCallback(spc.connHandle, pBuf, size);
+
+  // The application does not have to set the size for new credits
+  if (getNewRxCredits() > 0)
+  {
+    osal_set_event(spc.taskId, cbSPC_POLL_TX_EVENT);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Send fifo data to remote side as a write command
+*-------------------------------------------------------------------------*/
+static bStatus_t writeFifo(uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2)
+{
+  cb_ASSERT((size + size2) <= spc.fifoSize);
+
+  fifoReq.handle = spc.fifoHandle;
+  fifoReq.len = size + size2;
+  fifoReq.sig = FALSE;
+  fifoReq.cmd = TRUE;
+
+  // Data from cbSPC_getTxSlot is already in place
+  if (pBuf != fifoReq.value)
+  {
+    osal_memcpy(fifoReq.value, pBuf, size);
+  }
+  if (size2 != 0)
+  {
+    osal_memcpy(&fifoReq.value[size], pBuf2, size2);
+  }
+
+  return GATT_WriteNoRsp(spc.connHandle, &fifoReq);
+}
+
+/*---------------------------------------------------------------------------
+* Send credits to remote side as a write command
+*-------------------------------------------------------------------------*/
+static bStatus_t writeCredits(uint8 credits)
+{
+  attWriteReq_t req;
+
+  req.handle = spc.creditsHandle;
+  req.len = 1;
+  req.value[0] = credits;
+  req.sig = FALSE;
+  req.cmd = TRUE;
+
+  return GATT_WriteNoRsp(spc.connHandle, &req);
+}
+
+/*---------------------------------------------------------------------------
+* Notify all registered users
+*-------------------------------------------------------------------------*/
+static void connectEvtCallback(uint16 connHandle)
+{
+  uint8 i;
+  for(i = 0; (i < cbSPC_MAX_CALLBACKS); i++)
+  {
+    if ((spcCallbacks[i] != NULL) &&
+      (spcCallbacks[i]->connectEventCallback != NULL))
+    {
+      spcCallbacks[i]->connectEventCallback(connHandle);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Notify all registered users
+*-------------------------------------------------------------------------*/
+static void disconnectEvtCallback(uint16 connHandle)
+{
+  uint8 i;
+  for(i = 0; (i < cbSPC_MAX_CALLBACKS); i++)
+  {
+    if((spcCallbacks[i] != NULL) &&
+      (spcCallbacks[i]->disconnectEventCallback != NULL))
+    {
+      spcCallbacks[i]->disconnectEventCallback(connHandle);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Notify all registered users
+*-------------------------------------------------------------------------*/
+static void dataEvtCallback(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+  uint8 i;
+  for(i = 0; (i < cbSPC_MAX_CALLBACKS); i++)
+  {
+    if((spcCallbacks[i] != NULL) &&
+       (spcCallbacks[i]->dataEventCallback != NULL))
+    {
+      spcCallbacks[i]->dataEventCallback(connHandle, pBuf, size);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Notify all registered users
+*-------------------------------------------------------------------------*/
+static void dataCnfCallback(uint16 connHandle)
+{
+  uint8 i;
+  for(i = 0; (i < cbSPC_MAX_CALLBACKS); i++)
+  {
+    if((spcCallbacks[i] != NULL) &&
+      (spcCallbacks[i]->dataCnfCallback != NULL))
+    {
+      spcCallbacks[i]->dataCnfCallback(connHandle);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Notify all registered users
+*-------------------------------------------------------------------------*/
+static void fifoSizeEvtCallback(uint16 connHandle, uint8 fifoSize)
+{
+  uint8 i;
+  for(i = 0; (i < cbSPC_MAX_CALLBACKS); i++)
+  {
+    if((spcCallbacks[i] != NULL) &&
+      (spcCallbacks[i]->fifoSizeEventCallback != NULL))
+    {
+      spcCallbacks[i]->fifoSizeEventCallback(connHandle, fifoSize);
+    }
+  }
+}
+
+#endif
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,42 @@
+#ifndef SERIAL_PORT_CLIENT_H
+#define SERIAL_PORT_CLIENT_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Serial Port Client
+ * File        : cb_serial_client.h
+ *
+ * Description : Declaration of the central side of the Serial Port
+ *               Service. The client discovers the service on a remote
+ *               device, enables the fifo and credits characteristics and
+ *               runs the same credit protocol as the service. It uses
+ *               the callbacks and UUIDs of cb_serial_service.h.
+ *-------------------------------------------------------------------------*/
+#include "cb_serial_service.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern void cbSPC_init(uint8 taskId);
+extern uint16 cbSPC_processEvent(uint8 taskId, uint16 events);
+extern void cbSPC_register(cbSPS_Callbacks *pCallbacks);
+extern uint8 cbSPC_connect(uint16 connHandle);
+extern uint8 cbSPC_reqData(uint16 connHandle, uint8 *pBuf, uint8 size);
+extern uint8 cbSPC_reqDataVec(uint16 connHandle, uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2);
+extern uint8* cbSPC_getTxSlot(uint16 connHandle, uint8 *pSize);
+extern uint8 cbSPC_setRemainingBufSize(uint16 connHandle, uint16 size);
+extern uint8 cbSPC_getFifoSize(uint16 connHandle);
+extern void cbSPC_addLostBytes(uint16 connHandle, uint16 nBytes);
+extern void cbSPC_enable(void);
+extern void cbSPC_disable(void);
+
+#endif
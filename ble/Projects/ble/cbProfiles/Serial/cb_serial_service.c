@@ -9,9 +9,7 @@
 *-------------------------------------------------------------------------*/
 #include "bcomdef.h"
 #include "OSAL.h"
-#ifndef cbSPS_INDICATIONS
 #include "OSAL_Timers.h"
-#endif
 #include "linkdb.h"
 #include "att.h"
 #include "gatt.h"
@@ -23,7 +21,11 @@
 
 #include "cb_assert.h"
 #include "cb_serial_service.h"
+#ifdef CB_CENTRAL
+#include "central.h"
+#else
 #include "peripheral.h"
+#endif
 
 #ifdef cbSPS_READ_SECURITY_MODE
 #include "cb_gap.h"
@@ -42,7 +44,19 @@
 #define cbSPS_MAX_CALLBACKS (4)
 #endif
 
+// The service serves one central at a time. The peripheral GAPRole of the
+// BLE 1.3 stack accepts a single connection and GAPRole_TerminateConnection
+// takes no connection handle, so a second central can not be connected and
+// the credits, fifo and tx state are kept for one link only. Only the client
+// characteristic configurations are kept per connection, by GATTServApp.
+// The client, cb_serial_client.c, and cbBLS also handle one link. This is
+// not a configuration option.
 #define cbSPS_MAX_LINKS                               (1)
+
+// Fails to compile if the maximum fifo payload does not fit in a 
+// notification or is smaller than the payload of the default MTU
+typedef char cbSPS_MaxFifoSizeCheck[((cbSPS_MAX_FIFO_SIZE >= cbSPS_DEFAULT_FIFO_SIZE) && 
+                                     (cbSPS_MAX_FIFO_SIZE <= cbSPS_FIFO_SIZE)) ? 1 : -1];
 #define cbSPS_INVALID_ID                              (0xFF)
 
 #define cbSPS_POLL_TX_EVENT                           (1 << 0)
@@ -81,11 +95,26 @@ typedef struct
   uint8         rxCredits; // Number of packets that remote side can send
   uint16        connHandle;
   bool          secureConnection; // Encryption required 
+  uint16        encConnHandle;    // Link known to be encrypted
 
   uint16        remainingBufSize;
 
+  uint16        mtuConnHandle; // Link that fifoSize applies to
+  uint8         fifoSize;      // Fifo payload size, negotiated ATT MTU - 3
+
   uint8         *pPendingTxBuf;
   uint8         pendingTxBufSize;
+  uint8         *pPendingTxBuf2;    // Optional second part of pending data
+  uint8         pendingTxBufSize2;
+
+  bool          txBurstActive; // Set while pollTx sends a burst of fifo data
+  cbSPS_TxBurstStats burstStats;
+
+  bool          rxStarved;      // Remote side has run out of credits
+  uint32        rxStarvedStart; // System clock when rxStarved was set
+  cbSPS_RxCreditStats creditStats;
+
+  uint32        nLostBytes; // Read by remote side in the loss characteristic
 #ifdef cbSPS_DEBUG
   uint32        dbgTxCount;
   uint32        dbgRxCount;
@@ -94,21 +123,30 @@ typedef struct
 #endif
 } cbSPS_Class;
 
+#ifdef cbSPS_INDICATIONS
+typedef attHandleValueInd_t cbSPS_FifoAttr;
+#else
+typedef attHandleValueNoti_t cbSPS_FifoAttr;
+#endif
+
 /*===========================================================================
 * DECLARATIONS
 *=========================================================================*/
 // Operations registered to BLE stack
 static void handleConnStatusCB( uint16 connHandle, uint8 changeType );
+static bool isEncrypted(uint16 connHandle);
 static uint8 readAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue, uint8 *pLen, uint16 offset, uint8 maxLen );
 static bStatus_t writeAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue, uint8 len, uint16 offset );
 //static bStatus_t authorizeAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 opcode );
 
 // Operations handles incoming write operations
 static void creditsReceviceHandler(uint16 connHandle, uint8 credits);
+static uint8 getRxCreditSize(void);
+static uint8 getNewRxCredits(void);
 static void fifoReceiveHandler(uint16 connHandle, uint8 *pBuf, uint8 size);
 
 // Operations that sends indications to remote device
-static bStatus_t writeFifo(uint16 connHandle, uint8 *pBuf, uint8 size);
+static bStatus_t writeFifo(uint16 connHandle, uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2);
 static bStatus_t writeCredits(uint16 connHandle, uint8 credits);
 
 // Operations used to call a set of registered callbacks
@@ -116,13 +154,20 @@ static void connectEvtCallback(uint16 connHandle);
 static void disconnectEvtCallback(uint16 connHandle);
 static void dataEvtCallback(uint16 connHandle, uint8 *pBuf, uint8 size);
 static void dataCnfCallback(uint16 connHandle);
+static void fifoSizeEvtCallback(uint16 connHandle, uint8 fifoSize);
 
 #ifdef cbSPS_INDICATIONS
 static void handleIndConf(uint16 connHandle);
 #endif
 static void handleCreditsCharConfigChange(uint16 connHandle, bool enabled);
 static void pollTx(void);
+#ifndef cbSPS_INDICATIONS
+static bStatus_t txBurst(void);
+#endif
 static void resetLink(void);
+static void setMode(uint8 newMode);
+static bool txAllowed(void);
+static void useTxCredit(void);
 
 
 
@@ -136,11 +181,13 @@ CONST uint8 cbSPS_servUUID[ATT_UUID_SIZE] = {cbSPS_SERIAL_SERVICE_UUID};
 CONST uint8 cbSPS_modeUUID[ATT_UUID_SIZE] = {cbSPS_MODE_UUID};
 CONST uint8 cbSPS_fifoUUID[ATT_UUID_SIZE] = { cbSPS_FIFO_UUID };
 CONST uint8 cbSPS_creditsUUID[ATT_UUID_SIZE] = { cbSPS_CREDITS_UUID };
+CONST uint8 cbSPS_lossUUID[ATT_UUID_SIZE] = { cbSPS_LOSS_UUID };
 
 CONST gattAttrType_t cbSPS_serviceUUID = { ATT_UUID_SIZE, cbSPS_servUUID };
 
 // Characteristic properties
 static uint8 modeCharProps = GATT_PROP_READ | GATT_PROP_WRITE_NO_RSP; 
+static uint8 lossCharProps = GATT_PROP_READ; 
 #ifdef cbSPS_INDICATIONS
 static uint8 fifoCharProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY | GATT_PROP_INDICATE; 
 static uint8 creditsCharProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY | GATT_PROP_INDICATE; 
@@ -149,20 +196,27 @@ static uint8 fifoCharProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY /*| GATT_
 static uint8 creditsCharProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY /*| GATT_PROP_INDICATE*/; 
 #endif
 
-// Characteristic configurations
-static gattCharCfg_t modeCharConfig; 
-static gattCharCfg_t fifoCharConfig; 
-static gattCharCfg_t creditsCharConfig;
+// Characteristic configurations, one per connection
+static gattCharCfg_t modeCharConfig[GATT_MAX_NUM_CONN]; 
+static gattCharCfg_t fifoCharConfig[GATT_MAX_NUM_CONN]; 
+static gattCharCfg_t creditsCharConfig[GATT_MAX_NUM_CONN];
 
 //Characteristic data
-static uint8 mode = 0;
+static uint8 mode = cbSPS_MODE_CREDITS;
 static uint8 fifo[1]; // Note that no data is ever stored here. Size set to 1 to save memory
 static uint8 credits;
+static uint8 loss[1]; // Value is read from sps.nLostBytes
+
+// Fifo notification or indication. Data may be written directly into
+// the value, see cbSPS_getTxSlot.
+static cbSPS_FifoAttr fifoAttr;
 
 // Attribute handles that are cached for faster access
+static uint16 attrHandleMode = 0;
 static uint16 attrHandleFifo = 0;
 static uint16 attrHandleCredits = 0;
 static uint16 attrHandleCreditsConfig = 0;
+static uint16 attrHandleLoss = 0;
 
 // Attribute table
 static gattAttribute_t spsAttrTbl[] = 
@@ -183,7 +237,11 @@ static gattAttribute_t spsAttrTbl[] =
   // Credits Characteristic
   ATTRIBUTE16(characterUUID     , GATT_PERMIT_READ, &creditsCharProps),
   ATTRIBUTE128(cbSPS_creditsUUID, GATT_PERMIT_WRITE , &credits),
-  ATTRIBUTE16(clientCharCfgUUID , GATT_PERMIT_READ | GATT_PERMIT_WRITE , &creditsCharConfig)
+  ATTRIBUTE16(clientCharCfgUUID , GATT_PERMIT_READ | GATT_PERMIT_WRITE , &creditsCharConfig),
+
+  // Loss Characteristic
+  ATTRIBUTE16(characterUUID     , GATT_PERMIT_READ, &lossCharProps),
+  ATTRIBUTE128(cbSPS_lossUUID   , GATT_PERMIT_READ , loss)
 };
 
 CONST gattServiceCBs_t serialCBs =
@@ -208,7 +266,13 @@ void cbSPS_init(uint8 taskId)
   sps.rxState = SPS_S_NOT_VALID;
   sps.enabled = FALSE;
   sps.secureConnection = FALSE;
+  sps.mtuConnHandle = INVALID_CONNHANDLE;
+  sps.fifoSize = cbSPS_DEFAULT_FIFO_SIZE;
+  sps.encConnHandle = INVALID_CONNHANDLE;
+  sps.txBurstActive = FALSE;
   resetLink();
+  cbSPS_clearTxBurstStats();
+  cbSPS_clearRxCreditStats();
 
 #ifdef cbSPS_DEBUG
   sps.dbgTxCount = 0;
@@ -216,6 +280,11 @@ void cbSPS_init(uint8 taskId)
   sps.dbgTxCreditsCount = 0;  
   sps.dbgRxCreditsCount = 0;
 #endif
+
+#ifdef ATT_MTU_UPDATED_EVENT
+  // MTU updates are reported to registered tasks as GATT messages
+  GATT_RegisterForMsgs(taskId);
+#endif
 }
 
 /*---------------------------------------------------------------------------
@@ -227,14 +296,19 @@ void cbSPS_addService(void)
   gattAttribute_t *pAttr;
 
   linkDB_Register( handleConnStatusCB );    
-  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, &modeCharConfig );
-  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, &fifoCharConfig );
-  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, &creditsCharConfig );  
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, modeCharConfig );
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, fifoCharConfig );
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, creditsCharConfig );  
 
   status = GATTServApp_RegisterService( spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), &serialCBs );
   cb_ASSERT(status == SUCCESS);
 
-  //Init attribute handles needed for indications and notifications
+  //Init attribute handles needed for indications, notifications and 
+  //for dispatching read and write requests
+
+  pAttr = GATTServApp_FindAttr(spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), &mode );
+  cb_ASSERT(pAttr != NULL);
+  attrHandleMode = pAttr->handle;
 
   pAttr = GATTServApp_FindAttr(spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), fifo );
   cb_ASSERT(pAttr != NULL);
@@ -244,10 +318,14 @@ void cbSPS_addService(void)
   cb_ASSERT(pAttr != NULL);
   attrHandleCredits = pAttr->handle;
 
-  pAttr = GATTServApp_FindAttr(spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), (uint8*)&creditsCharConfig );
+  pAttr = GATTServApp_FindAttr(spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), (uint8*)creditsCharConfig );
   cb_ASSERT(pAttr != NULL);
   attrHandleCreditsConfig = pAttr->handle;
 
+  pAttr = GATTServApp_FindAttr(spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), loss );
+  cb_ASSERT(pAttr != NULL);
+  attrHandleLoss = pAttr->handle;
+
 #ifdef cbSPS_READ_SECURITY_MODE
   {
       cbSEC_SecurityMode securityMode;
@@ -283,11 +361,11 @@ void cbSPS_setSecurity(bool encryption, bool authentication)
   gattAttribute_t *pAttr;
 
   // List of attributes for which security config applies. Some of the attributes are always readable.
-  uint8 *attrValuePointer[6] =  {&mode, fifo, &credits, (uint8*)&modeCharConfig, (uint8*)&fifoCharConfig, (uint8*)&creditsCharConfig};
+  uint8 *attrValuePointer[7] =  {&mode, fifo, &credits, loss, (uint8*)modeCharConfig, (uint8*)fifoCharConfig, (uint8*)creditsCharConfig};
 
   sps.secureConnection = encryption;
 
-  for(uint8 i = 0; i < 6; i++)
+  for(uint8 i = 0; i < 7; i++)
   {
     pAttr = GATTServApp_FindAttr(spsAttrTbl, GATT_NUM_ATTRS( spsAttrTbl ), attrValuePointer[i] );
     cb_ASSERT(pAttr != NULL);
@@ -371,7 +449,7 @@ extern void cbSPS_unregister(cbSPS_Callbacks *pCallbacks)
 *-------------------------------------------------------------------------*/
 uint16 cbSPS_processEvent(uint8 taskId, uint16 events)
 {
-#ifdef cbSPS_INDICATIONS
+#if defined(cbSPS_INDICATIONS) || defined(ATT_MTU_UPDATED_EVENT)
   if ((events & SYS_EVENT_MSG) != 0)
   {    
     uint8* pMsg = osal_msg_receive(sps.taskId);
@@ -381,10 +459,19 @@ uint16 cbSPS_processEvent(uint8 taskId, uint16 events)
       switch (((osal_event_hdr_t*)pMsg)->event )
       {
       case GATT_MSG_EVENT:
+#ifdef cbSPS_INDICATIONS
         if (((gattMsgEvent_t*)pMsg)->method == ATT_HANDLE_VALUE_CFM)
         {
           handleIndConf(((gattMsgEvent_t*)pMsg)->connHandle);
         }
+#endif
+#ifdef ATT_MTU_UPDATED_EVENT
+        if (((gattMsgEvent_t*)pMsg)->method == ATT_MTU_UPDATED_EVENT)
+        {
+          cbSPS_setMtu(((gattMsgEvent_t*)pMsg)->connHandle, 
+                       ((gattMsgEvent_t*)pMsg)->msg.mtuEvt.MTU);
+        }
+#endif
         break;
 
       default:
@@ -415,11 +502,21 @@ uint16 cbSPS_processEvent(uint8 taskId, uint16 events)
 * then fifo data will be sent to remote device.
 *-------------------------------------------------------------------------*/
 uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+  return cbSPS_reqDataVec(connHandle, pBuf, size, NULL, 0);
+}
+
+/*---------------------------------------------------------------------------
+* Write fifo data from two buffers. The two parts are sent in one fifo 
+* packet, e.g. data on both sides of a circular buffer wrap-around.
+*-------------------------------------------------------------------------*/
+uint8 cbSPS_reqDataVec(uint16 connHandle, uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2)
 {
   bStatus_t status = FAILURE;
 
   cb_ASSERT(size != 0);
   cb_ASSERT(pBuf != NULL);
+  cb_ASSERT((size2 == 0) || (pBuf2 != NULL));
   cb_ASSERT(sps.pPendingTxBuf == NULL);
   cb_ASSERT(sps.pendingTxBufSize == 0);
 
@@ -429,13 +526,13 @@ uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
     switch (sps.txState)
     {
     case SPS_S_TX_IDLE:
-      if (sps.txCredits > 0)
+      if (txAllowed() == TRUE)
       {
-        status = writeFifo(connHandle, pBuf, size);
+        status = writeFifo(connHandle, pBuf, size, pBuf2, size2);
         if (status == SUCCESS)
         {
           sps.txState = SPS_S_TX_WAIT_FIFO_WRITE_CNF;
-          sps.txCredits--;
+          useTxCredit();
         }
         else
         {
@@ -447,6 +544,8 @@ uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
       {
         sps.pPendingTxBuf = pBuf;
         sps.pendingTxBufSize = size;
+        sps.pPendingTxBuf2 = pBuf2;
+        sps.pendingTxBufSize2 = size2;
         status = SUCCESS;
       }      
       break;
@@ -455,6 +554,8 @@ uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
       /* Write in progress, store the */
       sps.pPendingTxBuf = pBuf;
       sps.pendingTxBufSize = size;
+      sps.pPendingTxBuf2 = pBuf2;
+      sps.pendingTxBufSize2 = size2;
       status = SUCCESS;
       break;
 
@@ -470,8 +571,14 @@ uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
     case SPS_S_TX_WAIT:
       sps.pPendingTxBuf = pBuf;
       sps.pendingTxBufSize = size;
+      sps.pPendingTxBuf2 = pBuf2;
+      sps.pendingTxBufSize2 = size2;
       status = SUCCESS;
-      osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT); 
+      if (sps.txBurstActive == FALSE)
+      {
+        // During a burst the data is picked up by the ongoing poll
+        osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT); 
+      }
       break;
     
     default:
@@ -484,9 +591,32 @@ uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size)
   return status;
 }
 
+/*---------------------------------------------------------------------------
+* Get the value of the fifo notification so that the data of the next 
+* packet can be written in place. The returned buffer is then passed to
+* cbSPS_reqData or cbSPS_reqDataVec, which then sends it without copying.
+* Returns NULL if there already is pending data.
+*-------------------------------------------------------------------------*/
+uint8* cbSPS_getTxSlot(uint16 connHandle, uint8 *pSize)
+{
+  cb_ASSERT(pSize != NULL);
+
+  if ((sps.state != SPS_S_CONNECTED) || (sps.pPendingTxBuf != NULL))
+  {
+    *pSize = 0;
+    return NULL;
+  }
+
+  *pSize = cbSPS_getFifoSize(connHandle);
+
+  return fifoAttr.value;
+}
+
 /*---------------------------------------------------------------------------
 * Write credits. If notifications or indications have been enabled
-* then credits will be sent to remote device.
+* then credits will be sent to remote device. The size is lowered by the
+* service for each received packet, so it only has to be set again when
+* received data has been consumed.
 *-------------------------------------------------------------------------*/
 uint8 cbSPS_setRemainingBufSize(uint16 connHandle, uint16 size)
 {
@@ -495,13 +625,121 @@ uint8 cbSPS_setRemainingBufSize(uint16 connHandle, uint16 size)
   if (sps.state == SPS_S_CONNECTED)
   {
     sps.remainingBufSize = size;
-    osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT); 
+
+    // Only poll if new credits can be given
+    if (getNewRxCredits() > 0)
+    {
+      osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT); 
+    }
     status = SUCCESS;
   }
 
   return status;
 }
 
+/*---------------------------------------------------------------------------
+* Set the ATT MTU negotiated for a link. Fifo notifications, credits and 
+* write chunking on the link are sized from the MTU, limited to 
+* cbSPS_MAX_FIFO_SIZE. Called from the GATT message handling when the stack 
+* reports MTU updates, or by the application when it handles the MTU 
+* exchange itself. Rx credits given before this are counted at 
+* cbSPS_MAX_FIFO_SIZE, so the remote side may use them with the new size.
+*-------------------------------------------------------------------------*/
+void cbSPS_setMtu(uint16 connHandle, uint16 mtu)
+{
+  uint16 fifoSize;
+
+  if (mtu < cbSPS_DEFAULT_MTU_SIZE)
+  {
+    mtu = cbSPS_DEFAULT_MTU_SIZE;
+  }
+
+  fifoSize = MIN(mtu - 3, cbSPS_MAX_FIFO_SIZE);
+
+  if ((connHandle != sps.mtuConnHandle) || (fifoSize != sps.fifoSize))
+  {
+    sps.mtuConnHandle = connHandle;
+    sps.fifoSize = (uint8)fifoSize;
+
+    fifoSizeEvtCallback(connHandle, (uint8)fifoSize);
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Get the fifo payload size used on a link.
+*-------------------------------------------------------------------------*/
+uint8 cbSPS_getFifoSize(uint16 connHandle)
+{
+  uint8 size = cbSPS_DEFAULT_FIFO_SIZE;
+
+  if ((connHandle != INVALID_CONNHANDLE) && 
+      (connHandle == sps.mtuConnHandle))
+  {
+    size = sps.fifoSize;
+  }
+
+  return size;
+}
+
+/*---------------------------------------------------------------------------
+* Get statistics on the number of fifo notifications sent per tx burst.
+*-------------------------------------------------------------------------*/
+void cbSPS_getTxBurstStats(cbSPS_TxBurstStats *pStats)
+{
+  cb_ASSERT(pStats != NULL);
+
+  osal_memcpy(pStats, &sps.burstStats, sizeof(cbSPS_TxBurstStats));
+}
+
+/*---------------------------------------------------------------------------
+* Clear the tx burst statistics.
+*-------------------------------------------------------------------------*/
+void cbSPS_clearTxBurstStats(void)
+{
+  osal_memset(&sps.burstStats, 0, sizeof(cbSPS_TxBurstStats));
+}
+
+/*---------------------------------------------------------------------------
+* Get statistics on rx credits given and on the time the remote side has
+* been without credits.
+*-------------------------------------------------------------------------*/
+void cbSPS_getRxCreditStats(cbSPS_RxCreditStats *pStats)
+{
+  cb_ASSERT(pStats != NULL);
+
+  osal_memcpy(pStats, &sps.creditStats, sizeof(cbSPS_RxCreditStats));
+}
+
+/*---------------------------------------------------------------------------
+* Clear the rx credit statistics.
+*-------------------------------------------------------------------------*/
+void cbSPS_clearRxCreditStats(void)
+{
+  osal_memset(&sps.creditStats, 0, sizeof(cbSPS_RxCreditStats));
+}
+
+/*---------------------------------------------------------------------------
+* Get the mode selected by the remote side, cbSPS_MODE_CREDITS or 
+* cbSPS_MODE_STREAMING.
+*-------------------------------------------------------------------------*/
+uint8 cbSPS_getMode(uint16 connHandle)
+{
+  return mode;
+}
+
+/*---------------------------------------------------------------------------
+* Report fifo data that was lost, e.g. received data that did not fit in
+* the receive buffer in streaming mode. The remote side reads the total 
+* in the loss characteristic.
+*-------------------------------------------------------------------------*/
+void cbSPS_addLostBytes(uint16 connHandle, uint16 nBytes)
+{
+  if (sps.state == SPS_S_CONNECTED)
+  {
+    sps.nLostBytes += nBytes;
+  }
+}
+
 /*---------------------------------------------------------------------------
 * Description of function. Optional verbose description.
 *-------------------------------------------------------------------------*/
@@ -521,7 +759,11 @@ void cbSPS_disable(void)
     {
         // Disconnect
         // TBD cbGAP not part of demo application
+#ifdef CB_CENTRAL
+        GAPCentralRole_TerminateLink(sps.connHandle);
+#else
         GAPRole_TerminateConnection();
+#endif
     }
 }
 
@@ -531,7 +773,7 @@ void cbSPS_disable(void)
 
 /*---------------------------------------------------------------------------
 * Read callback
-* Read is only allowed on the Mode characteristic
+* Read is only allowed on the Mode and Loss characteristics
 *-------------------------------------------------------------------------*/
 static bStatus_t readAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue, uint8 *pLen, uint16 offset, uint8 maxLen )
 {
@@ -545,7 +787,7 @@ static bStatus_t readAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *p
   }
 
   if ((sps.secureConnection == TRUE) &&
-      (linkDB_Encrypted(connHandle) == FALSE))
+      (isEncrypted(connHandle) == FALSE))
   {
       return ATT_ERR_INSUFFICIENT_AUTHEN;
       //return ATT_ERR_INSUFFICIENT_ENCRYPT; // Does not trig a bonding
@@ -553,12 +795,27 @@ static bStatus_t readAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *p
   
   if ( pAttr->type.len == ATT_UUID_SIZE )
   {
-    if (osal_memcmp(pAttr->type.uuid, cbSPS_modeUUID, ATT_UUID_SIZE) == TRUE)
+    if (pAttr->handle == attrHandleMode)
     {
       *pLen = 1;      
       pValue[0] = pAttr->pValue[0];
       status = SUCCESS;
     }
+    else if (pAttr->handle == attrHandleLoss)
+    {
+      // The 32 bit counter is never truncated
+      if (maxLen < 4)
+      {
+        return ATT_ERR_INVALID_VALUE_SIZE;
+      }
+
+      *pLen = 4;
+      pValue[0] = BREAK_UINT32(sps.nLostBytes, 0);
+      pValue[1] = BREAK_UINT32(sps.nLostBytes, 1);
+      pValue[2] = BREAK_UINT32(sps.nLostBytes, 2);
+      pValue[3] = BREAK_UINT32(sps.nLostBytes, 3);
+      status = SUCCESS;
+    }
     else
     {
       // Should never get here!
@@ -583,7 +840,7 @@ static bStatus_t writeAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *
   bStatus_t status = SUCCESS;
  
   if ((sps.secureConnection == TRUE) &&
-      (linkDB_Encrypted(connHandle) == FALSE))
+      (isEncrypted(connHandle) == FALSE))
   {
       return ATT_ERR_INSUFFICIENT_AUTHEN;
       //return ATT_ERR_INSUFFICIENT_ENCRYPT; // Does not trig a bonding
@@ -591,30 +848,33 @@ static bStatus_t writeAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *
   
   if ( pAttr->type.len == ATT_UUID_SIZE )
   {   
-    // Make sure it is not a blob operation
+    // Attributes are identified by their cached handles. The fifo is 
+    // checked first since it is written for every received packet.
     if ( offset != 0 )
     {
+      // Not a blob operation
       status = ATT_ERR_ATTR_NOT_LONG;
     }
-    else if (osal_memcmp(pAttr->type.uuid, cbSPS_modeUUID, ATT_UUID_SIZE) == TRUE)
+    else if (pAttr->handle == attrHandleFifo)
     {
-      if (len == 1)
+      fifoReceiveHandler(connHandle, pValue, len);
+    }
+    else if (pAttr->handle == attrHandleMode)
+    {
+      if (len != 1)
       {
-        pAttr->pValue[0] = pValue[0];
-        cb_ASSERT(pAttr->pValue[0] == mode);
-        //TODO Mode changes are not implemented
-        //spsCallbacks->pfModeChangeEvent(connHandle, mode);
+        status = ATT_ERR_INVALID_VALUE_SIZE;
+      }
+      else if (pValue[0] > cbSPS_MODE_STREAMING)
+      {
+        status = ATT_ERR_INVALID_VALUE;
       }
       else
       {
-        status = ATT_ERR_INVALID_VALUE_SIZE;
+        setMode(pValue[0]);
       }
     }
-    else if (osal_memcmp(pAttr->type.uuid, cbSPS_fifoUUID, ATT_UUID_SIZE) == TRUE)
-    {
-      fifoReceiveHandler(connHandle, pValue, len);
-    }
-    else if (osal_memcmp(pAttr->type.uuid, cbSPS_creditsUUID, ATT_UUID_SIZE) == TRUE)
+    else if (pAttr->handle == attrHandleCredits)
     {
       if (len == 1)
       {
@@ -648,9 +908,9 @@ static bStatus_t writeAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *
         // before indications are enabled on the credits characteristic. 
         if((status == SUCCESS) &&            
            (pAttr->handle == attrHandleCreditsConfig) &&
-           ((fifoCharConfig.value & (GATT_CLIENT_CFG_NOTIFY | GATT_CLIENT_CFG_INDICATE)) != 0))
+           ((GATTServApp_ReadCharCfg(connHandle, fifoCharConfig) & (GATT_CLIENT_CFG_NOTIFY | GATT_CLIENT_CFG_INDICATE)) != 0))
         {
-          if((creditsCharConfig.value & (GATT_CLIENT_CFG_NOTIFY | GATT_CLIENT_CFG_INDICATE)) != 0)             
+          if((GATTServApp_ReadCharCfg(connHandle, creditsCharConfig) & (GATT_CLIENT_CFG_NOTIFY | GATT_CLIENT_CFG_INDICATE)) != 0)             
           {
             handleCreditsCharConfigChange(connHandle, TRUE);
           }
@@ -677,6 +937,28 @@ static bStatus_t writeAttrCB( uint16 connHandle, gattAttribute_t *pAttr, uint8 *
 }
 
 
+/*---------------------------------------------------------------------------
+* Check if a link is encrypted. The state of the encrypted link is cached
+* from the connection status callback so that attribute accesses do not 
+* have to search the link database. 
+*-------------------------------------------------------------------------*/
+static bool isEncrypted(uint16 connHandle)
+{
+  if (connHandle == sps.encConnHandle)
+  {
+    return TRUE;
+  }
+
+  // Not yet reported by the connection status callback
+  if (linkDB_Encrypted(connHandle) != FALSE)
+  {
+    sps.encConnHandle = connHandle;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
 /*---------------------------------------------------------------------------
 * Connection status callback
 *-------------------------------------------------------------------------*/
@@ -685,13 +967,30 @@ static void handleConnStatusCB( uint16 connHandle, uint8 changeType )
   // Make sure this is not loopback connection
   if(connHandle != LOOPBACK_CONNHANDLE)
   {
+    // Keep the cached encryption state of the link up to date
+    if ((changeType == LINKDB_STATUS_UPDATE_STATEFLAGS) &&
+        (linkDB_Encrypted(connHandle) != FALSE))
+    {
+      sps.encConnHandle = connHandle;
+    }
+    else if (connHandle == sps.encConnHandle)
+    {
+      sps.encConnHandle = INVALID_CONNHANDLE;
+    }
+
     // Reset Client Char Config if connection has dropped
     if((changeType == LINKDB_STATUS_UPDATE_REMOVED) ||
        ((changeType == LINKDB_STATUS_UPDATE_STATEFLAGS) && (!linkDB_Up(connHandle))))
     { 
-      GATTServApp_InitCharCfg( connHandle, &modeCharConfig );
-      GATTServApp_InitCharCfg( connHandle, &fifoCharConfig );
-      GATTServApp_InitCharCfg( connHandle, &creditsCharConfig );        
+      GATTServApp_InitCharCfg( connHandle, modeCharConfig );
+      GATTServApp_InitCharCfg( connHandle, fifoCharConfig );
+      GATTServApp_InitCharCfg( connHandle, creditsCharConfig );        
+
+      if (connHandle == sps.mtuConnHandle)
+      {
+        sps.mtuConnHandle = INVALID_CONNHANDLE;
+        sps.fifoSize = cbSPS_DEFAULT_FIFO_SIZE;
+      }
 
       switch (sps.state)
       {
@@ -718,10 +1017,13 @@ static void handleConnStatusCB( uint16 connHandle, uint8 changeType )
 }
 
 /*---------------------------------------------------------------------------
-* This operation sends credits or data. If fifo data is successfully
+* This operation sends credits and data. If fifo data is successfully
 * written to a lower layer then the data cnf callback is called immidiately
-* allowing a higher layers to start a new write. If data can not be written
-* to lower layer then a new poll is trigged after a timeout.
+* allowing a higher layers to start a new write. New data is sent in the
+* same poll as a burst, see txBurst. Pending data is sent in the same poll
+* as new credits unless the credits have to be confirmed first. If credits
+* can not be written to lower layer then a new poll is trigged after a 
+* timeout.
 *-------------------------------------------------------------------------*/
 static void pollTx(void)
 {
@@ -737,30 +1039,32 @@ static void pollTx(void)
     case SPS_S_TX_WAIT:
 #endif
       {
-        if ((sps.rxCredits == 0) &&
-            (sps.remainingBufSize > cbSPS_FIFO_SIZE))
-        {
-          newCredits = (sps.remainingBufSize / cbSPS_FIFO_SIZE) - sps.rxCredits;          
+        newCredits = getNewRxCredits();
+        status = SUCCESS;
 
+        if (newCredits > 0)
+        {
           status = writeCredits(sps.connHandle, newCredits);
 
           if (status == SUCCESS)
           {
-            sps.remainingBufSize = 0;
             sps.rxCredits += newCredits;
+            sps.creditStats.nGrants++;
+
+            if (sps.rxStarved == TRUE)
+            {
+              sps.creditStats.starvedTime += osal_GetSystemClock() - sps.rxStarvedStart;
+              sps.rxStarved = FALSE;
+            }
              
 #ifdef cbSPS_DEBUG
             sps.dbgRxCreditsCount += newCredits;       
 #endif
             
 #ifdef cbSPS_INDICATIONS
+            // Pending fifo data is sent when the credits are confirmed
             sps.txState = SPS_S_TX_WAIT_CREDITS_WRITE_CNF;
-#else
-            // Trig another poll to send pending fifo data as well
-            if (sps.pPendingTxBuf != NULL)
-            {
-              osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT);        
-            }
+            break;
 #endif
           }
           else
@@ -776,40 +1080,45 @@ static void pollTx(void)
 #endif
           }
         }
-        else if ((sps.pPendingTxBuf != NULL) &&
-                 (sps.txCredits > 0))
+
+        // Send pending fifo data in the same poll as the credits
+        if ((status == SUCCESS) &&
+            (sps.pPendingTxBuf != NULL) &&
+            (txAllowed() == TRUE))
         {
-          status = writeFifo(sps.connHandle, sps.pPendingTxBuf, sps.pendingTxBufSize);
+#ifndef cbSPS_INDICATIONS
+          status = txBurst();
 
-          if (status == SUCCESS)
+          if (status != SUCCESS)
           {
+            sps.txState = SPS_S_TX_WAIT;
+            osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT);
+          }
+          else if ((sps.pPendingTxBuf != NULL) && (txAllowed() == TRUE))
+          {
+            // Burst limit reached, continue in next poll
+            osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT);
+          }
+#else
+          status = writeFifo(sps.connHandle, sps.pPendingTxBuf, sps.pendingTxBufSize,
+                             sps.pPendingTxBuf2, sps.pendingTxBufSize2);
 
-#ifdef cbSPS_DEBUG
-            sps.dbgTxCount += sps.pendingTxBufSize;
-#endif
-            sps.txCredits--;
+          if (status == SUCCESS)
+          {
+            useTxCredit();
             sps.pPendingTxBuf = NULL;
             sps.pendingTxBufSize = 0;
-#ifdef cbSPS_INDICATIONS
+            sps.pPendingTxBuf2 = NULL;
+            sps.pendingTxBufSize2 = 0;
             sps.txState = SPS_S_TX_WAIT_FIFO_WRITE_CNF;
-#else
-            sps.txState = SPS_S_TX_IDLE;
-
-            dataCnfCallback(sps.connHandle);
-#endif
           }
           else
           {
-#ifdef cbSPS_INDICATIONS
             // TBD Remove after debugging
             // How shall this case be handled?
             cb_ASSERT(FALSE);
-#else
-             sps.txState = SPS_S_TX_WAIT;
-             //osal_start_timerEx(sps.taskId, cbSPS_POLL_TX_EVENT, cbSPS_TX_POLL_TIMEOUT_IN_MS);
-             osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT);
-#endif
           }
+#endif
         }
       }
       break;
@@ -827,8 +1136,58 @@ static void pollTx(void)
   }
 }
 
+#ifndef cbSPS_INDICATIONS
+/*---------------------------------------------------------------------------
+* Send pending fifo data as long as there are credits, the stack accepts
+* the notifications and the data cnf callback provides more data. At most
+* cbSPS_MAX_TX_BURST notifications are sent. Returns the status of the
+* last notification.
+*-------------------------------------------------------------------------*/
+static bStatus_t txBurst(void)
+{
+  bStatus_t status;
+  uint8     nPackets = 0;
+
+  sps.txBurstActive = TRUE;
+
+  do
+  {
+    status = writeFifo(sps.connHandle, sps.pPendingTxBuf, sps.pendingTxBufSize,
+                       sps.pPendingTxBuf2, sps.pendingTxBufSize2);
+
+    if (status == SUCCESS)
+    {
+      nPackets++;
+      useTxCredit();
+      sps.pPendingTxBuf = NULL;
+      sps.pendingTxBufSize = 0;
+      sps.pPendingTxBuf2 = NULL;
+      sps.pendingTxBufSize2 = 0;
+      sps.txState = SPS_S_TX_IDLE;
+
+      // The callback may request more data to be sent
+      dataCnfCallback(sps.connHandle);
+    }
+  } while ((status == SUCCESS) &&
+           (sps.pPendingTxBuf != NULL) &&
+           (txAllowed() == TRUE) &&
+           (nPackets < cbSPS_MAX_TX_BURST));
+
+  sps.txBurstActive = FALSE;
+
+  sps.burstStats.lastBurst = nPackets;
+  sps.burstStats.nBursts[nPackets]++;
+
+  return status;
+}
+#endif
+
 /*---------------------------------------------------------------------------
 * Reset link vartiables
+* The mode characteristic is one value for the service, the peripheral has
+* a single link. It is set back to credits mode so every connection starts
+* in the default mode, a remote side that streams writes the mode again
+* after connecting.
 *-------------------------------------------------------------------------*/
 static void resetLink(void)
 {
@@ -836,8 +1195,95 @@ static void resetLink(void)
   sps.rxCredits = 0;
   sps.connHandle = INVALID_CONNHANDLE;
   sps.remainingBufSize = 0;
+  sps.rxStarved = FALSE;
+  sps.nLostBytes = 0;
+  mode = cbSPS_MODE_CREDITS;
   sps.pPendingTxBuf = NULL;
   sps.pendingTxBufSize = 0;
+  sps.pPendingTxBuf2 = NULL;
+  sps.pendingTxBufSize2 = 0;
+}
+
+/*---------------------------------------------------------------------------
+* Number of rx buffer bytes a credit is counted with. A credit lets the
+* remote side send one packet of the fifo size of the link at the time it
+* is used, also when the credit was given before the MTU exchange. Until 
+* the MTU of the link is known the credits are therefore counted at the 
+* largest fifo payload. The MTU is only exchanged once on a link, so the 
+* fifo size can not grow after that.
+*-------------------------------------------------------------------------*/
+static uint8 getRxCreditSize(void)
+{
+  uint8 size = cbSPS_MAX_FIFO_SIZE;
+
+  if (sps.connHandle == sps.mtuConnHandle)
+  {
+    size = sps.fifoSize;
+  }
+
+  return size;
+}
+
+/*---------------------------------------------------------------------------
+* Number of new rx credits that can be given. Credits are only given when
+* the remote side is at or below the low water mark, and only for the part
+* of the remaining rx buffer that the remote side has no credits for.
+*-------------------------------------------------------------------------*/
+static uint8 getNewRxCredits(void)
+{
+  uint8  creditSize = getRxCreditSize();
+  uint16 committed = (uint16)sps.rxCredits * creditSize;
+
+  if ((mode == cbSPS_MODE_STREAMING) ||
+      (sps.rxCredits > cbSPS_RX_CREDITS_LOW_WATER) ||
+      (sps.remainingBufSize < (committed + creditSize)))
+  {
+    return 0;
+  }
+
+  return (uint8)MIN((sps.remainingBufSize - committed) / creditSize, 0xFF - sps.rxCredits);
+}
+
+/*---------------------------------------------------------------------------
+* Change between credits and streaming mode. Credits given in the previous
+* mode are not valid in the new one. 
+*-------------------------------------------------------------------------*/
+static void setMode(uint8 newMode)
+{
+  if (newMode != mode)
+  {
+    mode = newMode;
+
+    sps.txCredits = 0;
+    sps.rxCredits = 0;
+    sps.rxStarved = FALSE;
+
+    if (sps.state == SPS_S_CONNECTED)
+    {
+      // Give new credits or send pending data without credits
+      osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------
+* Check if a fifo packet may be sent. In streaming mode only the stack
+* limits the transmission.
+*-------------------------------------------------------------------------*/
+static bool txAllowed(void)
+{
+  return ((mode == cbSPS_MODE_STREAMING) || (sps.txCredits > 0));
+}
+
+/*---------------------------------------------------------------------------
+* A fifo packet has been sent.
+*-------------------------------------------------------------------------*/
+static void useTxCredit(void)
+{
+  if (mode == cbSPS_MODE_CREDITS)
+  {
+    sps.txCredits--;
+  }
 }
 
 /*---------------------------------------------------------------------------
@@ -899,11 +1345,29 @@ static void fifoReceiveHandler(uint16 connHandle, uint8 *pBuf, uint8 size)
     switch (sps.rxState)
     {
     case SPS_S_RX_READY:
-      sps.rxCredits--;
+      // A remote side that sends without credits is already starved
+      if ((mode == cbSPS_MODE_CREDITS) && (sps.rxCredits > 0))
+      {
+        sps.rxCredits--;
+
+        if (sps.rxCredits == 0)
+        {
+          sps.rxStarved = TRUE;
+          sps.rxStarvedStart = osal_GetSystemClock();
+          sps.creditStats.nStarved++;
+        }
+      }
 #ifdef cbSPS_DEBUG
       sps.dbgRxCount += size;
 #endif
+      sps.remainingBufSize -= MIN(size, sps.remainingBufSize);
       dataEvtCallback(connHandle, pBuf, size);
+
+      // The application does not have to set the size for new credits
+      if (getNewRxCredits() > 0)
+      {
+        osal_set_event(sps.taskId, cbSPS_POLL_TX_EVENT);
+      }
       break;
   
     default:
@@ -995,22 +1459,15 @@ static uint8 previousByte = 0;
 static uint8 previousStart = 0;
 #endif
 
-static bStatus_t writeFifo(uint16 connHandle, uint8 *pBuf, uint8 size)
+static bStatus_t writeFifo(uint16 connHandle, uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2)
 {
   bStatus_t status = FAILURE;
 
-#ifdef cbSPS_INDICATIONS
-  attHandleValueInd_t attribute;
-#else
-  attHandleValueNoti_t attribute;
-#endif
+  cb_ASSERT((size + size2) <= cbSPS_getFifoSize(connHandle));
 
-  cb_ASSERT(size <= cbSPS_FIFO_SIZE);
 
-
-  if (((fifoCharConfig.value & (GATT_CLIENT_CFG_INDICATE | GATT_CLIENT_CFG_NOTIFY)) != 0) &&
-    (fifoCharConfig.connHandle != INVALID_CONNHANDLE) &&
-    (fifoCharConfig.connHandle == connHandle))
+  // No configuration is found for other connections
+  if ((GATTServApp_ReadCharCfg(connHandle, fifoCharConfig) & (GATT_CLIENT_CFG_INDICATE | GATT_CLIENT_CFG_NOTIFY)) != 0)
   {    
     cb_ASSERT(attrHandleFifo != 0);
 
@@ -1040,18 +1497,31 @@ static bStatus_t writeFifo(uint16 connHandle, uint8 *pBuf, uint8 size)
     // End DBG
 #endif
             
-    attribute.handle = attrHandleFifo;
-    attribute.len = size;
-    osal_memcpy(attribute.value, pBuf, size);
+    fifoAttr.handle = attrHandleFifo;
+    fifoAttr.len = size + size2;
 
-#ifdef cbSPS_DEBUG
-    sps.dbgTxCount += size;
-#endif
+    // Data from cbSPS_getTxSlot is already in place
+    if (pBuf != fifoAttr.value)
+    {
+      osal_memcpy(fifoAttr.value, pBuf, size);
+    }
+    if (size2 != 0)
+    {
+      osal_memcpy(&fifoAttr.value[size], pBuf2, size2);
+    }
 
 #ifdef cbSPS_INDICATIONS
-    status = GATT_Indication(fifoCharConfig.connHandle, &attribute, FALSE, sps.taskId);
+    status = GATT_Indication(connHandle, &fifoAttr, FALSE, sps.taskId);
 #else
-    status = GATT_Notification(fifoCharConfig.connHandle, &attribute, FALSE);
+    status = GATT_Notification(connHandle, &fifoAttr, FALSE);
+#endif
+
+#ifdef cbSPS_DEBUG
+    // Only counted here, for every fifo packet accepted by the stack
+    if (status == SUCCESS)
+    {
+      sps.dbgTxCount += size + size2;
+    }
 #endif
   }
 
@@ -1071,9 +1541,7 @@ static bStatus_t writeCredits(uint16 connHandle, uint8 credits)
   attHandleValueNoti_t attribute;
 #endif   
 
-  if(((creditsCharConfig.value & (GATT_CLIENT_CFG_INDICATE | GATT_CLIENT_CFG_NOTIFY)) != 0) &&
-    (creditsCharConfig.connHandle != INVALID_CONNHANDLE) &&
-    (creditsCharConfig.connHandle == connHandle))
+  if((GATTServApp_ReadCharCfg(connHandle, creditsCharConfig) & (GATT_CLIENT_CFG_INDICATE | GATT_CLIENT_CFG_NOTIFY)) != 0)
   {
     cb_ASSERT(attrHandleCredits != 0);
          
@@ -1082,9 +1550,9 @@ static bStatus_t writeCredits(uint16 connHandle, uint8 credits)
     attribute.value[0] = credits;
 
 #ifdef cbSPS_INDICATIONS
-    status = GATT_Indication(creditsCharConfig.connHandle , &attribute, FALSE, sps.taskId);
+    status = GATT_Indication(connHandle, &attribute, FALSE, sps.taskId);
 #else
-    status = GATT_Notification(creditsCharConfig.connHandle , &attribute, FALSE);
+    status = GATT_Notification(connHandle, &attribute, FALSE);
 #endif
   }
 
@@ -1156,6 +1624,22 @@ static void dataCnfCallback(uint16 connHandle)
   }
 }
 
+/*---------------------------------------------------------------------------
+* Notify all registered users
+*-------------------------------------------------------------------------*/
+static void fifoSizeEvtCallback(uint16 connHandle, uint8 fifoSize)
+{
+  uint8 i;
+  for(i = 0; (i < cbSPS_MAX_CALLBACKS); i++)
+  {
+    if((spsCallbacks[i] != NULL) && 
+      (spsCallbacks[i]->fifoSizeEventCallback != NULL))
+    {
+      spsCallbacks[i]->fifoSizeEventCallback(connHandle, fifoSize);
+    }
+  }
+}
+
 
 /*********************************************************************
 *********************************************************************/
@@ -23,8 +23,49 @@
 #define cbSPS_MODE_UUID                              0x02,0xd7,0xe9,0x01,0x4f,0xf3,0x44,0xe7,0x83,0x8f,0xe2,0x26,0xb9,0xe1,0x56,0x24
 #define cbSPS_FIFO_UUID                              0x03,0xd7,0xe9,0x01,0x4f,0xf3,0x44,0xe7,0x83,0x8f,0xe2,0x26,0xb9,0xe1,0x56,0x24
 #define cbSPS_CREDITS_UUID                           0x04,0xd7,0xe9,0x01,0x4f,0xf3,0x44,0xe7,0x83,0x8f,0xe2,0x26,0xb9,0xe1,0x56,0x24
+#define cbSPS_LOSS_UUID                              0x05,0xd7,0xe9,0x01,0x4f,0xf3,0x44,0xe7,0x83,0x8f,0xe2,0x26,0xb9,0xe1,0x56,0x24
 
+// Values of the mode characteristic. In credits mode fifo packets are 
+// only sent when the receiver has given credits. In streaming mode no 
+// credits are used, fifo data is sent as fast as the stack accepts it 
+// and data that can not be stored is counted in the loss characteristic.
+#define cbSPS_MODE_CREDITS                           (0)
+#define cbSPS_MODE_STREAMING                         (1)
+
+// ATT MTU used on a link until a larger MTU has been negotiated
+#define cbSPS_DEFAULT_MTU_SIZE                       (23)
+
+// Largest fifo payload the stack can send, the notification value holds
+// ATT_MTU_SIZE-3 bytes
 #define cbSPS_FIFO_SIZE                              (ATT_MTU_SIZE-3) //20
+#define cbSPS_DEFAULT_FIFO_SIZE                      (cbSPS_DEFAULT_MTU_SIZE-3)
+
+// Maximum fifo payload, the rx buffer and the credits are sized for it. 
+// The payload used on a link follows the negotiated ATT MTU up to this 
+// size, see cbSPS_getFifoSize. The remote side must not write more than
+// this in one fifo packet.
+// It must be between cbSPS_DEFAULT_FIFO_SIZE and cbSPS_FIFO_SIZE. On the 
+// BLE 1.3 stack ATT_MTU_SIZE is 23, so the payload is always 20 bytes and 
+// a larger negotiated MTU does not change it.
+#ifndef cbSPS_MAX_FIFO_SIZE
+#define cbSPS_MAX_FIFO_SIZE                          cbSPS_FIFO_SIZE
+#endif
+
+// Maximum number of fifo notifications sent in one tx poll. The burst ends 
+// earlier if credits run out, the stack has no free tx buffers or there
+// is no more data to send. Set to 1 to send one notification per poll.
+#ifndef cbSPS_MAX_TX_BURST
+#define cbSPS_MAX_TX_BURST                           (4)
+#endif
+
+// New rx credits are given when the remote side has this many credits or
+// less left, as far as the remaining rx buffer size allows. Credits the 
+// remote side still has are subtracted from the remaining buffer size so
+// the buffer is never overcommitted. Set to 0 to give new credits only
+// when the remote side has run out.
+#ifndef cbSPS_RX_CREDITS_LOW_WATER
+#define cbSPS_RX_CREDITS_LOW_WATER                   (4)
+#endif
 
 
 /*===========================================================================
@@ -34,6 +75,7 @@ typedef void (*cbSPS_ConnectEvt)(uint16 connHandle);
 typedef void (*cbSPS_DisconnectEvt)(uint16 connHandle);
 typedef void (*cbSPS_DataEvt)(uint16 connHandle, uint8 *pBuf, uint8 size);
 typedef void (*cbSPS_DataCnf)(uint16 connHandle);
+typedef void (*cbSPS_FifoSizeEvt)(uint16 connHandle, uint8 fifoSize);
 
 typedef struct 
 {
@@ -41,8 +83,22 @@ typedef struct
   cbSPS_DisconnectEvt disconnectEventCallback;
   cbSPS_DataEvt       dataEventCallback;
   cbSPS_DataCnf       dataCnfCallback;
+  cbSPS_FifoSizeEvt   fifoSizeEventCallback;  // Fifo payload changed by the MTU, optional
 } cbSPS_Callbacks;
 
+typedef struct
+{
+  uint8   lastBurst;                        // Packets sent in the last burst
+  uint16  nBursts[cbSPS_MAX_TX_BURST + 1];  // Number of bursts, indexed by packets sent
+} cbSPS_TxBurstStats;
+
+typedef struct
+{
+  uint16  nGrants;        // Number of times new rx credits were given
+  uint16  nStarved;       // Number of times the remote side ran out of credits
+  uint32  starvedTime;    // Total time in ms the remote side had no credits
+} cbSPS_RxCreditStats;
+
 
 /*===========================================================================
  * FUNCTIONS
@@ -53,7 +109,17 @@ extern void cbSPS_addService(void);
 extern void cbSPS_setSecurity(bool encryption, bool authentication);
 extern void cbSPS_register(cbSPS_Callbacks *pCallbacks);
 extern uint8 cbSPS_reqData(uint16 connHandle, uint8 *pBuf, uint8 size);
+extern uint8 cbSPS_reqDataVec(uint16 connHandle, uint8 *pBuf, uint8 size, uint8 *pBuf2, uint8 size2);
+extern uint8* cbSPS_getTxSlot(uint16 connHandle, uint8 *pSize);
 extern uint8 cbSPS_setRemainingBufSize(uint16 connHandle, uint16 size);
+extern void cbSPS_setMtu(uint16 connHandle, uint16 mtu);
+extern uint8 cbSPS_getFifoSize(uint16 connHandle);
+extern void cbSPS_getTxBurstStats(cbSPS_TxBurstStats *pStats);
+extern void cbSPS_clearTxBurstStats(void);
+extern void cbSPS_getRxCreditStats(cbSPS_RxCreditStats *pStats);
+extern void cbSPS_clearRxCreditStats(void);
+extern uint8 cbSPS_getMode(uint16 connHandle);
+extern void cbSPS_addLostBytes(uint16 connHandle, uint16 nBytes);
 extern void cbSPS_enable(void);
 extern void cbSPS_disable(void);
 
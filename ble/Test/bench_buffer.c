@@ -0,0 +1,416 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : bench_buffer.c
+ *
+ * Description : Benchmark of cb_buffer. A stream of bytes is written and
+ *               read in chunks through one buffer, either with the copy
+ *               functions (cbBUF_write/cbBUF_read), one call per byte
+ *               (cbBUF_writeByte/cbBUF_readByte) or in place with the
+ *               write and read buffers (cbBUF_getWriteBuf/cbBUF_getReadBuf).
+ *               The static apis run the same streams through a buffer of
+ *               cb_buffer_static.h, in place (static) and one byte at a 
+ *               time (static_byte). Static buffers are circular only and
+ *               hold BENCH_STATIC_SIZE bytes, the macros are not counted
+ *               as calls.
+ *
+ *               Buffer modes:
+ *               circular - cbBUF_open without reserved size
+ *               reserved - cbBUF_open with minReturnSize and reservedSize
+ *                          set to the chunk size, no chunk is split
+ *               bip      - cbBUF_openBip
+ *
+ *               Patterns:
+ *               lockstep - one chunk is written and then read
+ *               offset   - as lockstep but with data kept in the buffer
+ *                          so that the wrap-around moves through the chunks
+ *               fill     - the buffer is written until full and then
+ *                          read until empty
+ *
+ *               Every case is first run on a small stream with the data
+ *               verified, then timed. One CSV line is printed per case.
+ *               cycles_per_byte is counted with the cpu time stamp 
+ *               counter, compare copy with byte for the gain of the bulk
+ *               functions.
+ *               fill_bytes is the usable capacity, the average number of
+ *               bytes in the buffer when the producer of the fill pattern
+ *               got no more room, 0 for the other patterns.
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comdef.h"
+#include "hal_types.h"
+
+#include "cb_assert.h"
+#include "cb_buffer.h"
+#include "cb_buffer_static.h"
+#include "osal_host.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define BENCH_BUF_SIZE      (200)
+#define BENCH_VERIFY_BYTES  (64UL * 1024)
+#define BENCH_TIMED_BYTES   (2UL * 1024 * 1024)
+#define BENCH_MAX_CHUNK     (128)
+#define BENCH_STATIC_SIZE   (128)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef enum
+{
+    API_COPY = 0,
+    API_BYTE,
+    API_INPLACE,
+    API_STATIC,
+    API_STATIC_BYTE
+} Api;
+
+typedef enum
+{
+    MODE_CIRCULAR = 0,
+    MODE_RESERVED,
+    MODE_BIP
+} Mode;
+
+typedef enum
+{
+    PATTERN_LOCKSTEP = 0,
+    PATTERN_OFFSET,
+    PATTERN_FILL
+} Pattern;
+
+typedef struct
+{
+    Api     api;
+    Mode    mode;
+    uint16  chunk;
+    Pattern pattern;
+    bool    verify;
+
+    uint8   id;
+    uint16  bufSize;
+    uint32  produced;
+    uint32  consumed;
+    uint32  nCalls;
+    uint32  nFills;
+    uint32  fillBytes;      /* Sum of the bytes in buffer when full */
+} Run;
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "bench_buffer";
+
+static const char *apiName[] = {"copy", "byte", "inplace", "static", "static_byte"};
+static const char *modeName[] = {"circular", "reserved", "bip"};
+static const char *patternName[] = {"lockstep", "offset", "fill"};
+static const uint16 chunkSize[] = {1, 20, 64, 128};
+
+/* Source of the stream, byte n of the stream is src[n & 0xFF] */
+static uint8 src[256 + BENCH_MAX_CHUNK];
+static uint8 dst[BENCH_MAX_CHUNK];
+
+cbBUF_STATIC_DECLARE(staticBuf, BENCH_STATIC_SIZE);
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static void check(Run *pRun, const uint8 *pData, uint16 n)
+{
+    if (pRun->verify == TRUE)
+    {
+        if (memcmp(pData, &src[pRun->consumed & 0xFF], n) != 0)
+        {
+            printf("data error at byte %lu\n", (unsigned long)pRun->consumed);
+            exit(1);
+        }
+    }
+}
+
+static uint16 produce(Run *pRun, uint16 n)
+{
+    uint8  *pBuf;
+    uint16 size;
+    uint16 done = 0;
+
+    if (pRun->api == API_COPY)
+    {
+        done = cbBUF_write(pRun->id, &src[pRun->produced & 0xFF], n);
+        pRun->nCalls++;
+    }
+    else if (pRun->api == API_BYTE)
+    {
+        while ((done < n) && 
+               (cbBUF_writeByte(pRun->id, src[(pRun->produced + done) & 0xFF]) == cbBUF_OK))
+        {
+            pRun->nCalls++;
+            done++;
+        }
+        if (done < n)
+        {
+            pRun->nCalls++;
+        }
+    }
+    else if (pRun->api == API_STATIC)
+    {
+        while ((done < n) && !cbBUF_STATIC_IS_FULL(staticBuf))
+        {
+            size = MIN(cbBUF_STATIC_GET_WRITE_SIZE(staticBuf), n - done);
+            memcpy(cbBUF_STATIC_GET_WRITE_BUF(staticBuf), &src[(pRun->produced + done) & 0xFF], size);
+            cbBUF_STATIC_WRITE_PRODUCED(staticBuf, size);
+            done += size;
+        }
+    }
+    else if (pRun->api == API_STATIC_BYTE)
+    {
+        while ((done < n) && !cbBUF_STATIC_IS_FULL(staticBuf))
+        {
+            cbBUF_STATIC_WRITE_BYTE(staticBuf, src[(pRun->produced + done) & 0xFF]);
+            done++;
+        }
+    }
+    else
+    {
+        while ((done < n) && (cbBUF_getWriteBuf(pRun->id, &pBuf, &size) == cbBUF_OK))
+        {
+            size = MIN(size, n - done);
+            memcpy(pBuf, &src[(pRun->produced + done) & 0xFF], size);
+            cbBUF_writeBufProduced(pRun->id, size);
+            pRun->nCalls += 2;
+            done += size;
+        }
+        if (done < n)
+        {
+            pRun->nCalls++;
+        }
+    }
+
+    pRun->produced += done;
+
+    return done;
+}
+
+static uint16 consume(Run *pRun, uint16 n)
+{
+    uint8  *pBuf;
+    uint16 size;
+    uint16 done = 0;
+
+    if (pRun->api == API_COPY)
+    {
+        done = cbBUF_read(pRun->id, dst, n);
+        pRun->nCalls++;
+        check(pRun, dst, done);
+        pRun->consumed += done;
+    }
+    else if (pRun->api == API_BYTE)
+    {
+        while ((done < n) && (cbBUF_readByte(pRun->id, &dst[done]) == cbBUF_OK))
+        {
+            pRun->nCalls++;
+            done++;
+        }
+        if (done < n)
+        {
+            pRun->nCalls++;
+        }
+        check(pRun, dst, done);
+        pRun->consumed += done;
+    }
+    else if (pRun->api == API_STATIC)
+    {
+        while ((done < n) && !cbBUF_STATIC_IS_EMPTY(staticBuf))
+        {
+            size = MIN(cbBUF_STATIC_GET_READ_SIZE(staticBuf), n - done);
+            memcpy(dst, cbBUF_STATIC_GET_READ_BUF(staticBuf), size);
+            check(pRun, dst, size);
+            cbBUF_STATIC_READ_CONSUMED(staticBuf, size);
+            pRun->consumed += size;
+            done += size;
+        }
+    }
+    else if (pRun->api == API_STATIC_BYTE)
+    {
+        while ((done < n) && !cbBUF_STATIC_IS_EMPTY(staticBuf))
+        {
+            dst[done] = cbBUF_STATIC_READ_BYTE(staticBuf);
+            done++;
+        }
+        check(pRun, dst, done);
+        pRun->consumed += done;
+    }
+    else
+    {
+        while ((done < n) && (cbBUF_getReadBuf(pRun->id, &pBuf, &size) == cbBUF_OK))
+        {
+            size = MIN(size, n - done);
+            memcpy(dst, pBuf, size);
+            check(pRun, dst, size);
+            cbBUF_readBufConsumed(pRun->id, size);
+            pRun->nCalls += 2;
+            pRun->consumed += size;
+            done += size;
+        }
+        if (done < n)
+        {
+            pRun->nCalls++;
+        }
+    }
+
+    return done;
+}
+
+static void openBuffer(Run *pRun)
+{
+    uint8 result = cbBUF_ERROR;
+
+    pRun->bufSize = BENCH_BUF_SIZE;
+
+    if ((pRun->api == API_STATIC) || (pRun->api == API_STATIC_BYTE))
+    {
+        cbBUF_STATIC_CLEAR(staticBuf);
+        pRun->bufSize = cbBUF_STATIC_SIZE(staticBuf);
+        return;
+    }
+
+    switch (pRun->mode)
+    {
+    case MODE_CIRCULAR:
+        result = cbBUF_open(BENCH_BUF_SIZE, 0, 0, &pRun->id);
+        break;
+
+    case MODE_RESERVED:
+        result = cbBUF_open(BENCH_BUF_SIZE, pRun->chunk, pRun->chunk, &pRun->id);
+        break;
+
+    case MODE_BIP:
+        result = cbBUF_openBip(BENCH_BUF_SIZE, 0, &pRun->id);
+        break;
+    }
+
+    cb_ASSERT(result == cbBUF_OK);
+}
+
+static void runStream(Run *pRun, uint32 nBytes)
+{
+    uint16 lag;
+
+    pRun->produced = 0;
+    pRun->consumed = 0;
+    pRun->nCalls = 0;
+    pRun->nFills = 0;
+    pRun->fillBytes = 0;
+
+    openBuffer(pRun);
+
+    lag = ((pRun->bufSize - pRun->chunk) / 2) + 7;
+
+    if (pRun->pattern == PATTERN_OFFSET)
+    {
+        while (pRun->produced < lag)
+        {
+            produce(pRun, 1);
+        }
+    }
+
+    while (pRun->consumed < nBytes)
+    {
+        if (pRun->pattern == PATTERN_FILL)
+        {
+            while (produce(pRun, pRun->chunk) != 0)
+            {
+            }
+            pRun->nFills++;
+            pRun->fillBytes += pRun->produced - pRun->consumed;
+            while (consume(pRun, pRun->chunk) != 0)
+            {
+            }
+        }
+        else
+        {
+            produce(pRun, pRun->chunk);
+            consume(pRun, pRun->chunk);
+        }
+    }
+
+    if ((pRun->api != API_STATIC) && (pRun->api != API_STATIC_BYTE))
+    {
+        cbBUF_close(pRun->id);
+    }
+}
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+int main(void)
+{
+    Run      run;
+    uint16   i;
+    uint8    a;
+    uint8    m;
+    uint8    c;
+    uint8    p;
+    uint64_t start;
+    uint64_t startCycles;
+    uint64_t ns;
+    uint64_t cycles;
+
+    for (i = 0; i < sizeof(src); i++)
+    {
+        src[i] = (uint8)i;
+    }
+
+    cbBUF_init();
+
+    printf("bench,api,mode,chunk,pattern,bytes,ns_per_byte,cycles_per_byte,calls_per_kb,fill_bytes\n");
+
+    for (a = API_COPY; a <= API_STATIC_BYTE; a++)
+    {
+        for (m = MODE_CIRCULAR; m <= MODE_BIP; m++)
+        {
+            if ((a >= API_STATIC) && (m != MODE_CIRCULAR))
+            {
+                continue;
+            }
+
+            for (c = 0; c < (sizeof(chunkSize) / sizeof(chunkSize[0])); c++)
+            {
+                for (p = PATTERN_LOCKSTEP; p <= PATTERN_FILL; p++)
+                {
+                    run.api = (Api)a;
+                    run.mode = (Mode)m;
+                    run.chunk = chunkSize[c];
+                    run.pattern = (Pattern)p;
+
+                    run.verify = TRUE;
+                    runStream(&run, BENCH_VERIFY_BYTES);
+
+                    run.verify = FALSE;
+                    start = osalHost_getNs();
+                    startCycles = osalHost_getCycles();
+                    runStream(&run, BENCH_TIMED_BYTES);
+                    cycles = osalHost_getCycles() - startCycles;
+                    ns = osalHost_getNs() - start;
+
+                    printf("buffer,%s,%s,%u,%s,%lu,%.3f,%.2f,%.1f,%.1f\n",
+                           apiName[a], modeName[m], run.chunk, patternName[p],
+                           (unsigned long)run.consumed,
+                           (double)ns / run.consumed,
+                           (double)cycles / run.consumed,
+                           run.nCalls * 1024.0 / run.consumed,
+                           (run.nFills != 0) ? (double)run.fillBytes / run.nFills : 0.0);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,483 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : bench_sps.c
+ *
+ * Description : Throughput and latency of the serial port over BLE. The
+ *               Serial Port Service and cb_ble_serial run unmodified on
+ *               the host OSAL and on the link model of ble_host, the
+ *               remote side is the peer model of sps_peer.
+ *
+ *               Directions:
+ *               tx - the application writes with cbBLS_write and the
+ *                    peer receives the notifications
+ *               rx - the peer writes the fifo and the application reads
+ *                    with cbBLS_getReadBuf
+ *
+ *               The time of every byte is recorded when it is written,
+ *               the latency is the virtual time until it is received.
+ *               Bytes/s is the virtual throughput. The link and peer
+ *               parameters are swept, one CSV line is printed per case.
+ *               The ATT MTU is swept last with the link parameters fixed.
+ *               The fifo payload follows the MTU only up to
+ *               cbSPS_MAX_FIFO_SIZE, with the ATT_MTU_SIZE 23 of the BLE
+ *               1.3 stack all MTUs give the same result. Build with a
+ *               larger ATT_MTU_SIZE (bench_sps_mtu) to see the effect of
+ *               larger payloads. The air time of a packet is not
+ *               modelled, only pkts_per_event limits the packets.
+ *               tx_full counts the packets refused because all tx buffers
+ *               of the sending side were in use. In the tx direction the
+ *               service polls again directly, so it also shows how often
+ *               the poll spins while the link is full.
+ *               dev_low_water is the cbSPS_RX_CREDITS_LOW_WATER of the
+ *               service, it sets when the service gives credits in the rx
+ *               direction. bench_sps_lw0 is built with it set to 0 to 
+ *               compare with the default.
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+
+#include "cb_assert.h"
+#include "cb_buffer.h"
+#include "cb_ble_serial.h"
+#include "cb_serial_service.h"
+#include "osal_host.h"
+#include "ble_host.h"
+#include "sps_peer.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#ifndef BENCH_BYTES
+#define BENCH_BYTES             (256UL * 1024)
+#endif
+
+#define BENCH_CHUNK             (4 * cbSPS_MAX_FIFO_SIZE)
+#define BENCH_SAMPLE_SHIFT      (4)     /* Latency of every 16th byte */
+#define BENCH_TIMEOUT_US        (600UL * 1000 * 1000)
+
+/* Low water of the peer, the default of the service independent of the
+   cbSPS_RX_CREDITS_LOW_WATER the bench is built with */
+#define BENCH_PEER_LOW_WATER    (4)
+
+#define APP_WRITE_EVENT         (0x0001)
+#define APP_READ_EVENT          (0x0002)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef enum
+{
+    DIR_TX = 0,
+    DIR_RX
+} Dir;
+
+typedef struct
+{
+    Dir             dir;
+    uint16          mtu;
+    bleHost_LinkCfg link;
+    spsPeer_Cfg     peer;
+} BenchCase;
+
+typedef struct
+{
+    Dir     dir;
+    uint32  total;
+    uint32  written;
+    uint32  received;
+    uint32  *pTime;         /* Write time of every byte, us */
+    uint32  *pLatency;      /* Sampled latencies, us */
+    uint32  nLatency;
+
+    uint8   chunk[cbBLS_TX_QUEUE_SIZE][BENCH_CHUNK];
+    uint8   nextChunk;
+    uint8   nQueued;
+} Bench;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static uint16 app_processEvent(uint8 taskId, uint16 events);
+static void dataAvailable(uint8 port);
+static void writeComplete(uint8 port, uint16 bufSize);
+static void blsError(uint8 port, uint8 error);
+static uint8 requestConnection(uint8 port);
+static uint8 peerTxData(uint8 *pBuf, uint8 maxLen);
+static void peerRxData(uint8 *pBuf, uint8 len);
+static void writeChunks(void);
+static void readData(void);
+static uint8 pattern(uint32 i);
+static void produce(uint8 *pBuf, uint16 len);
+static void consume(uint8 *pBuf, uint16 len);
+static int compareU32(const void *pA, const void *pB);
+static double percentile(uint32 p);
+static void runCase(const BenchCase *pCase);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "bench_sps";
+
+const pTaskEventHandlerFn tasksArr[] =
+{
+    cbSPS_processEvent,
+    app_processEvent
+};
+
+const uint8 tasksCnt = sizeof(tasksArr) / sizeof(tasksArr[0]);
+uint16 *tasksEvents;
+
+static cbBLS_Callbacks blsCallbacks =
+{
+    dataAvailable,
+    writeComplete,
+    blsError,
+    requestConnection
+};
+
+static const spsPeer_Callbacks peerCallbacks =
+{
+    peerTxData,
+    peerRxData
+};
+
+static uint8 appTaskId;
+static Bench bench;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+void osalInitTasks(void)
+{
+    uint8 taskID = 0;
+
+    tasksEvents = calloc(tasksCnt, sizeof(uint16));
+    cb_ASSERT(tasksEvents != NULL);
+
+    cbSPS_init(taskID++);
+    appTaskId = taskID++;
+}
+
+int main(void)
+{
+    static const uint32 intervals[] = { 7500, 30000 };
+    static const uint8 pkts[] = { 1, 4, 6 };
+    static const uint8 txBuffers[] = { 2, 4, 8 };
+    static const uint16 mtus[] = { 23, 64, 128, 247 };
+    BenchCase c;
+    uint8 d, i, p, t;
+
+    bench.pTime = malloc(BENCH_BYTES * sizeof(uint32));
+    bench.pLatency = malloc(((BENCH_BYTES >> BENCH_SAMPLE_SHIFT) + 1) * sizeof(uint32));
+    cb_ASSERT((bench.pTime != NULL) && (bench.pLatency != NULL));
+
+    bleHost_init();
+    osal_init_system();
+    cbBUF_init();
+    cbSPS_addService();
+    spsPeer_init(&peerCallbacks);
+
+    cbBLS_init();
+    cbBLS_registerCallbacks(&blsCallbacks);
+    cbBLS_open(cbBLS_PORT_0, NULL);
+
+    printf("bench,dir,mtu,fifo_size,interval_us,pkts_per_event,tx_buffers,"
+           "peer_low_water,peer_consume,dev_low_water,bytes,bytes_per_s,bytes_per_event,"
+           "lat_p50_ms,lat_p90_ms,lat_p99_ms,tx_full\n");
+
+    memset(&c, 0, sizeof(c));
+    c.peer.rxBufSize = 256;
+    c.peer.streaming = FALSE;
+
+    for (d = DIR_TX; d <= DIR_RX; d++)
+    {
+        c.dir = (Dir)d;
+        c.mtu = cbSPS_DEFAULT_MTU_SIZE;
+
+        // Link parameters with a fast peer
+        for (i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++)
+        {
+            for (p = 0; p < sizeof(pkts); p++)
+            {
+                for (t = 0; t < sizeof(txBuffers); t++)
+                {
+                    c.link.connIntervalUs = intervals[i];
+                    c.link.pktsPerEvent = pkts[p];
+                    c.link.txBuffers = txBuffers[t];
+                    c.peer.creditsLowWater = BENCH_PEER_LOW_WATER;
+                    c.peer.consumePerEvent = 0;
+                    runCase(&c);
+                }
+            }
+        }
+
+        c.link.connIntervalUs = 7500;
+        c.link.pktsPerEvent = 4;
+        c.link.txBuffers = 4;
+
+        // Credit policy and a slow application of the peer, only the peer
+        // gives credits in the tx direction
+        for (p = 0; (p < 2) && (c.dir == DIR_TX); p++)
+        {
+            c.peer.creditsLowWater = (p == 0) ? 0 : BENCH_PEER_LOW_WATER;
+            c.peer.consumePerEvent = 0;
+            runCase(&c);
+            c.peer.consumePerEvent = 40;
+            runCase(&c);
+        }
+
+        c.peer.creditsLowWater = BENCH_PEER_LOW_WATER;
+        c.peer.consumePerEvent = 0;
+        for (i = 0; i < sizeof(mtus) / sizeof(mtus[0]); i++)
+        {
+            c.mtu = mtus[i];
+            runCase(&c);
+        }
+    }
+
+    free(bench.pTime);
+    free(bench.pLatency);
+
+    return 0;
+}
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static uint16 app_processEvent(uint8 taskId, uint16 events)
+{
+    if (events & APP_WRITE_EVENT)
+    {
+        writeChunks();
+        return (events ^ APP_WRITE_EVENT);
+    }
+
+    if (events & APP_READ_EVENT)
+    {
+        readData();
+        return (events ^ APP_READ_EVENT);
+    }
+
+    return 0;
+}
+
+static void dataAvailable(uint8 port)
+{
+    osal_set_event(appTaskId, APP_READ_EVENT);
+}
+
+static void writeComplete(uint8 port, uint16 bufSize)
+{
+    cb_ASSERT(bench.nQueued > 0);
+    bench.nQueued--;
+
+    osal_set_event(appTaskId, APP_WRITE_EVENT);
+}
+
+static void blsError(uint8 port, uint8 error)
+{
+    cb_ASSERT(FALSE);
+}
+
+/*---------------------------------------------------------------------------
+ * The peer connects, nothing to do.
+ *-------------------------------------------------------------------------*/
+static uint8 requestConnection(uint8 port)
+{
+    return FAILURE;
+}
+
+static uint8 peerTxData(uint8 *pBuf, uint8 maxLen)
+{
+    uint8 n = 0;
+
+    if ((bench.dir == DIR_RX) && (bench.written < bench.total))
+    {
+        n = (uint8)MIN((uint32)maxLen, bench.total - bench.written);
+        produce(pBuf, n);
+    }
+
+    return n;
+}
+
+static void peerRxData(uint8 *pBuf, uint8 len)
+{
+    cb_ASSERT(bench.dir == DIR_TX);
+    consume(pBuf, len);
+}
+
+/*---------------------------------------------------------------------------
+ * Keeps the tx queue of cb_ble_serial full.
+ *-------------------------------------------------------------------------*/
+static void writeChunks(void)
+{
+    uint8    *pChunk;
+    uint16   n;
+    Status_t status;
+
+    while ((bench.dir == DIR_TX) &&
+           (bench.written < bench.total) &&
+           (bench.nQueued < cbBLS_TX_QUEUE_SIZE))
+    {
+        pChunk = bench.chunk[bench.nextChunk];
+        n = (uint16)MIN((uint32)BENCH_CHUNK, bench.total - bench.written);
+
+        produce(pChunk, n);
+
+        status = cbBLS_write(cbBLS_PORT_0, pChunk, n);
+        cb_ASSERT(status == SUCCESS);
+
+        bench.nQueued++;
+        bench.nextChunk = (bench.nextChunk + 1) % cbBLS_TX_QUEUE_SIZE;
+    }
+}
+
+static void readData(void)
+{
+    uint8  *pBuf;
+    uint16 size;
+
+    while ((cbBLS_getReadBuf(cbBLS_PORT_0, &pBuf, &size) == SUCCESS) && (size > 0))
+    {
+        consume(pBuf, size);
+        cbBLS_readBufConsumed(cbBLS_PORT_0, size);
+    }
+}
+
+static uint8 pattern(uint32 i)
+{
+    return (uint8)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+static void produce(uint8 *pBuf, uint16 len)
+{
+    uint32 now = (uint32)osalHost_getTimeUs();
+    uint16 i;
+
+    for (i = 0; i < len; i++)
+    {
+        pBuf[i] = pattern(bench.written);
+        bench.pTime[bench.written] = now;
+        bench.written++;
+    }
+}
+
+static void consume(uint8 *pBuf, uint16 len)
+{
+    uint32 now = (uint32)osalHost_getTimeUs();
+    uint16 i;
+
+    for (i = 0; i < len; i++)
+    {
+        cb_ASSERT(bench.received < bench.written);
+        cb_ASSERT(pBuf[i] == pattern(bench.received));
+
+        if ((bench.received & ((1UL << BENCH_SAMPLE_SHIFT) - 1)) == 0)
+        {
+            bench.pLatency[bench.nLatency++] = now - bench.pTime[bench.received];
+        }
+        bench.received++;
+    }
+}
+
+static int compareU32(const void *pA, const void *pB)
+{
+    uint32 a = *(const uint32*)pA;
+    uint32 b = *(const uint32*)pB;
+
+    return (a > b) - (a < b);
+}
+
+/*---------------------------------------------------------------------------
+ * Returns the p:th percentile of the sorted latencies in ms.
+ *-------------------------------------------------------------------------*/
+static double percentile(uint32 p)
+{
+    uint32 i = (bench.nLatency * p) / 100;
+
+    if (i >= bench.nLatency)
+    {
+        i = bench.nLatency - 1;
+    }
+
+    return bench.pLatency[i] / 1000.0;
+}
+
+static void runCase(const BenchCase *pCase)
+{
+    bleHost_Stats   stats;
+    spsPeer_Stats   peerStats;
+    spsPeer_Cfg     peer = pCase->peer;
+    uint64_t        start;
+    uint64_t        elapsed;
+
+    bench.dir = pCase->dir;
+    bench.total = BENCH_BYTES;
+    bench.written = 0;
+    bench.received = 0;
+    bench.nLatency = 0;
+    bench.nextChunk = 0;
+    bench.nQueued = 0;
+
+    bleHost_connect(&pCase->link);
+
+    // Both sides use the payload of the negotiated MTU, the peer rx buffer
+    // holds at least as many packets as the one of cb_ble_serial
+    cbSPS_setMtu(BLE_HOST_CONN_HANDLE, pCase->mtu);
+    peer.fifoSize = cbSPS_getFifoSize(BLE_HOST_CONN_HANDLE);
+    peer.rxBufSize = MAX(peer.rxBufSize, cbBLS_CREDITS_TOTAL * peer.fifoSize);
+
+    spsPeer_connect(&peer);
+    osalHost_runUntilIdle();
+    bleHost_clearStats();
+
+    start = osalHost_getTimeUs();
+
+    osal_set_event(appTaskId, APP_WRITE_EVENT);
+
+    while ((bench.received < bench.total) &&
+           ((osalHost_getTimeUs() - start) < BENCH_TIMEOUT_US))
+    {
+        osalHost_advanceTime(pCase->link.connIntervalUs);
+    }
+    cb_ASSERT(bench.received == bench.total);
+
+    elapsed = osalHost_getTimeUs() - start;
+
+    bleHost_getStats(&stats);
+    spsPeer_getStats(&peerStats);
+    cb_ASSERT((peerStats.nLostBytes == 0) && (peerStats.nCreditErrors == 0));
+
+    bleHost_disconnect();
+    osalHost_runUntilIdle();
+
+    qsort(bench.pLatency, bench.nLatency, sizeof(uint32), compareU32);
+
+    printf("sps,%s,%u,%u,%lu,%u,%u,%u,%u,%u,%lu,%.0f,%.1f,%.2f,%.2f,%.2f,%lu\n",
+           (pCase->dir == DIR_TX) ? "tx" : "rx",
+           pCase->mtu,
+           peer.fifoSize,
+           (unsigned long)pCase->link.connIntervalUs,
+           pCase->link.pktsPerEvent,
+           pCase->link.txBuffers,
+           pCase->peer.creditsLowWater,
+           pCase->peer.consumePerEvent,
+           cbSPS_RX_CREDITS_LOW_WATER,
+           (unsigned long)bench.total,
+           bench.total * 1e6 / (double)elapsed,
+           bench.total / (double)stats.nConnEvents,
+           percentile(50),
+           percentile(90),
+           percentile(99),
+           (unsigned long)((pCase->dir == DIR_TX) ? stats.nTxFull : stats.nRxFull));
+}
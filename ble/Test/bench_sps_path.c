@@ -0,0 +1,368 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : bench_sps_path.c
+ *
+ * Description : CPU cycles per fifo packet in the Serial Port Service.
+ *               The service runs on the host OSAL and the link model of
+ *               ble_host in streaming mode, the application is a minimal
+ *               one registered with cbSPS_register. Every packet is timed
+ *               on its own with osalHost_getCycles and the median is
+ *               printed, the service tasks are run outside of the timed
+ *               part. The baseline and the faster path take turns so
+ *               that both see the same caches and clock frequency.
+ *
+ *               Paths:
+ *               rx_handle - the peer writes the fifo with
+ *                           bleHost_peerWriteReq, the write callback of
+ *                           the service dispatches on the cached
+ *                           attribute handles. The baseline rx_uuid does
+ *                           the 16 byte UUID compares of the earlier
+ *                           dispatch, mode and then fifo, before the same
+ *                           write.
+ *               tx_slot   - the application builds the packet in the
+ *                           buffer of cbSPS_getTxSlot and sends it with
+ *                           cbSPS_reqData, the service sends it without
+ *                           copying. The baseline tx_copy builds the
+ *                           packet in a buffer of its own that the
+ *                           service copies. The timed part is the
+ *                           building of the packet, cbSPS_reqData and the
+ *                           tx poll that sends the notification.
+ *
+ *               The packet sizes are 1, 8 and the largest fifo payload.
+ *               bench_sps_path_mtu is built with a 247 byte ATT MTU to
+ *               time the copy of 244 byte packets.
+ *
+ *               The host osal_memcmp is the one of the C library, on the
+ *               target the compares are byte loops and cost more.
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "att.h"
+#include "gatt.h"
+
+#include "cb_assert.h"
+#include "cb_serial_service.h"
+#include "osal_host.h"
+#include "ble_host.h"
+#include "sps_peer.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#ifndef BENCH_PACKETS
+#define BENCH_PACKETS           (100000UL)
+#endif
+
+#define BENCH_INTERVAL_US       (7500)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef enum
+{
+    RX_HANDLE = 0,
+    RX_UUID,
+    TX_SLOT,
+    TX_COPY
+} Path;
+
+typedef struct
+{
+    uint32      rxBytes;
+    uint8       fifoSize;
+    uint64_t    *pBase;     /* Cycles of every packet of the baseline */
+    uint64_t    *pFast;     /* and of the faster path */
+} Bench;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static void connectEvt(uint16 connHandle);
+static void disconnectEvt(uint16 connHandle);
+static void dataEvt(uint16 connHandle, uint8 *pBuf, uint8 size);
+static void dataCnf(uint16 connHandle);
+static uint64_t rxPacket(Path path, gattAttribute_t *pFifo, uint8 *pData, uint8 size);
+static void runRx(uint8 size);
+static uint64_t txPacket(Path path, uint8 size);
+static void runTx(uint8 size);
+static int compareU64(const void *pA, const void *pB);
+static uint64_t median(uint64_t *pCycles);
+static void printResult(const char *pPath, const char *pBaseline, uint8 size);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "bench_sps_path";
+
+const pTaskEventHandlerFn tasksArr[] =
+{
+    cbSPS_processEvent
+};
+
+const uint8 tasksCnt = sizeof(tasksArr) / sizeof(tasksArr[0]);
+uint16 *tasksEvents;
+
+static cbSPS_Callbacks spsCallbacks =
+{
+    connectEvt,
+    disconnectEvt,
+    dataEvt,
+    dataCnf,
+    NULL
+};
+
+static const spsPeer_Callbacks peerCallbacks =
+{
+    NULL,
+    NULL
+};
+
+static const uint8 modeUUID[ATT_UUID_SIZE] = { cbSPS_MODE_UUID };
+static const uint8 fifoUUID[ATT_UUID_SIZE] = { cbSPS_FIFO_UUID };
+
+static Bench bench;
+
+/* Keeps the results of the UUID compares */
+static volatile uint8 uuidMatch;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+void osalInitTasks(void)
+{
+    tasksEvents = calloc(tasksCnt, sizeof(uint16));
+    cb_ASSERT(tasksEvents != NULL);
+
+    cbSPS_init(0);
+}
+
+int main(void)
+{
+    static const uint8 sizes[] = { 1, 8, cbSPS_MAX_FIFO_SIZE };
+    bleHost_LinkCfg link;
+    spsPeer_Cfg     peer;
+    uint8           i;
+
+    bench.pBase = malloc(BENCH_PACKETS * sizeof(uint64_t));
+    bench.pFast = malloc(BENCH_PACKETS * sizeof(uint64_t));
+    cb_ASSERT((bench.pBase != NULL) && (bench.pFast != NULL));
+
+    bleHost_init();
+    osal_init_system();
+    cbSPS_addService();
+    cbSPS_register(&spsCallbacks);
+    cbSPS_enable();
+    spsPeer_init(&peerCallbacks);
+
+    memset(&link, 0, sizeof(link));
+    link.connIntervalUs = BENCH_INTERVAL_US;
+    link.pktsPerEvent = 4;
+    link.txBuffers = 4;
+    bleHost_connect(&link);
+
+    // The largest payload of the stack, see bench_sps_path_mtu
+    cbSPS_setMtu(BLE_HOST_CONN_HANDLE, ATT_MTU_SIZE);
+    bench.fifoSize = cbSPS_getFifoSize(BLE_HOST_CONN_HANDLE);
+
+    memset(&peer, 0, sizeof(peer));
+    peer.rxBufSize = 256;
+    peer.fifoSize = bench.fifoSize;
+    peer.streaming = TRUE;
+    spsPeer_connect(&peer);
+    osalHost_runUntilIdle();
+
+    printf("bench,path,baseline,packet_bytes,packets,base_cycles_per_packet,"
+           "cycles_per_packet,saved_cycles_per_packet,saved_cycles_per_kb\n");
+
+    for (i = 0; i < sizeof(sizes); i++)
+    {
+        if (sizes[i] <= bench.fifoSize)
+        {
+            runRx(sizes[i]);
+            printResult("rx_handle", "rx_uuid", sizes[i]);
+
+            runTx(sizes[i]);
+            printResult("tx_slot", "tx_copy", sizes[i]);
+        }
+    }
+
+    bleHost_disconnect();
+    osalHost_runUntilIdle();
+
+    free(bench.pBase);
+    free(bench.pFast);
+
+    return 0;
+}
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static void connectEvt(uint16 connHandle)
+{
+}
+
+static void disconnectEvt(uint16 connHandle)
+{
+}
+
+static void dataEvt(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+    bench.rxBytes += size;
+}
+
+static void dataCnf(uint16 connHandle)
+{
+}
+
+/*---------------------------------------------------------------------------
+ * One peer write of the fifo. The UUID path compares the type of the
+ * attribute as the write callback did before the handles were cached.
+ *-------------------------------------------------------------------------*/
+static uint64_t rxPacket(Path path, gattAttribute_t *pFifo, uint8 *pData, uint8 size)
+{
+    uint64_t  start;
+    uint64_t  stop;
+    bStatus_t status;
+
+    start = osalHost_getCycles();
+
+    if (path == RX_UUID)
+    {
+        uuidMatch = osal_memcmp(pFifo->type.uuid, modeUUID, ATT_UUID_SIZE);
+        if (uuidMatch == FALSE)
+        {
+            uuidMatch = osal_memcmp(pFifo->type.uuid, fifoUUID, ATT_UUID_SIZE);
+        }
+    }
+    status = bleHost_peerWriteReq(pFifo->handle, pData, size);
+
+    stop = osalHost_getCycles();
+
+    cb_ASSERT(status == SUCCESS);
+
+    return stop - start;
+}
+
+static void runRx(uint8 size)
+{
+    gattAttribute_t *pFifo = bleHost_findAttrByType(fifoUUID, ATT_UUID_SIZE, 0);
+    uint8           data[cbSPS_MAX_FIFO_SIZE];
+    uint32          n;
+
+    cb_ASSERT(pFifo != NULL);
+
+    memset(data, 0x55, sizeof(data));
+    bench.rxBytes = 0;
+
+    for (n = 0; n < BENCH_PACKETS; n++)
+    {
+        bench.pBase[n] = rxPacket(RX_UUID, pFifo, data, size);
+        osalHost_runUntilIdle();
+
+        bench.pFast[n] = rxPacket(RX_HANDLE, pFifo, data, size);
+        osalHost_runUntilIdle();
+    }
+    cb_ASSERT(bench.rxBytes == 2 * BENCH_PACKETS * size);
+}
+
+/*---------------------------------------------------------------------------
+ * One fifo notification. The copy path builds the packet in a buffer of
+ * the application, the slot path in the notification of the service.
+ *-------------------------------------------------------------------------*/
+static uint64_t txPacket(Path path, uint8 size)
+{
+    static uint8 appBuf[cbSPS_MAX_FIFO_SIZE];
+    uint64_t     start;
+    uint64_t     stop;
+    uint8        *pBuf;
+    uint8        slotSize;
+    uint8        status;
+
+    start = osalHost_getCycles();
+
+    if (path == TX_SLOT)
+    {
+        pBuf = cbSPS_getTxSlot(BLE_HOST_CONN_HANDLE, &slotSize);
+        cb_ASSERT((pBuf != NULL) && (slotSize >= size));
+    }
+    else
+    {
+        pBuf = appBuf;
+    }
+    memset(pBuf, 0x55, size);
+
+    status = cbSPS_reqData(BLE_HOST_CONN_HANDLE, pBuf, size);
+    osalHost_runUntilIdle();
+
+    stop = osalHost_getCycles();
+
+    cb_ASSERT(status == SUCCESS);
+
+    return stop - start;
+}
+
+/*---------------------------------------------------------------------------
+ * The link is run between the packets so that a tx buffer is always free.
+ *-------------------------------------------------------------------------*/
+static void runTx(uint8 size)
+{
+    spsPeer_Stats peerStats;
+    uint32        start;
+    uint32        n;
+
+    spsPeer_getStats(&peerStats);
+    start = peerStats.rxBytes;
+
+    for (n = 0; n < BENCH_PACKETS; n++)
+    {
+        bench.pBase[n] = txPacket(TX_COPY, size);
+        bench.pFast[n] = txPacket(TX_SLOT, size);
+
+        osalHost_advanceTime(BENCH_INTERVAL_US);
+    }
+
+    spsPeer_getStats(&peerStats);
+    cb_ASSERT(peerStats.rxBytes - start == 2 * BENCH_PACKETS * size);
+}
+
+static int compareU64(const void *pA, const void *pB)
+{
+    uint64_t a = *(const uint64_t*)pA;
+    uint64_t b = *(const uint64_t*)pB;
+
+    return (a > b) - (a < b);
+}
+
+static uint64_t median(uint64_t *pCycles)
+{
+    qsort(pCycles, BENCH_PACKETS, sizeof(uint64_t), compareU64);
+
+    return pCycles[BENCH_PACKETS / 2];
+}
+
+static void printResult(const char *pPath, const char *pBaseline, uint8 size)
+{
+    uint64_t base = median(bench.pBase);
+    uint64_t fast = median(bench.pFast);
+
+    printf("sps_path,%s,%s,%u,%lu,%llu,%llu,%lld,%.0f\n",
+           pPath,
+           pBaseline,
+           size,
+           (unsigned long)BENCH_PACKETS,
+           (unsigned long long)base,
+           (unsigned long long)fast,
+           (long long)(base - fast),
+           ((double)base - (double)fast) * 1024.0 / size);
+}
@@ -0,0 +1,965 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : ble_host.c
+ *
+ * Description : Host stand-in for the GATT server and client, linkDB and
+ *               GAP roles of the TI BLE stack, see ble_host.h.
+ *-------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "osal_cbtimer.h"
+#include "att.h"
+#include "gatt.h"
+#include "gatt_uuid.h"
+#include "gattservapp.h"
+#include "linkdb.h"
+#include "peripheral.h"
+#include "central.h"
+
+#include "cb_assert.h"
+#include "osal_host.h"
+#include "ble_host.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define BLE_HOST_MAX_SERVICES       (4)
+#define BLE_HOST_MAX_LINKDB_CBS     (4)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    uint16  handle;
+    uint8   len;
+    uint8   value[ATT_MTU_SIZE - 3];
+    bool    indication;
+    uint8   taskId;     /* Gets the confirmation of an indication */
+} BleHost_Packet;
+
+typedef struct
+{
+    BleHost_Packet  pkt[BLE_HOST_MAX_TX_BUFFERS];
+    uint8           head;
+    uint8           count;
+} BleHost_TxQueue;
+
+typedef struct
+{
+    gattAttribute_t         *pAttrs;
+    uint16                  numAttrs;
+    const gattServiceCBs_t  *pCBs;
+} BleHost_Service;
+
+typedef struct
+{
+    bool                    connected;
+    bool                    encrypted;
+    bool                    terminate;
+    bleHost_LinkCfg         cfg;
+    uint8                   timerId;
+
+    BleHost_TxQueue         localTx;    /* Notifications and indications */
+    BleHost_TxQueue         peerTx;     /* Write commands of the peer */
+
+    bool                    indPending; /* Indication not yet confirmed */
+    bool                    cfmPending; /* Confirmation sent in next event */
+    uint8                   cfmTaskId;
+
+    BleHost_Service         services[BLE_HOST_MAX_SERVICES];
+    uint8                   nServices;
+    uint16                  nextHandle;
+
+    pfnLinkDBCB_t           linkDBCallbacks[BLE_HOST_MAX_LINKDB_CBS];
+    uint8                   nLinkDBCallbacks;
+
+    bool                    clientRegistered;
+    uint8                   clientTaskId;   /* Gets notifications and indications */
+    bleHost_MtuCallback     mtuCallback;
+    uint8                   timeoutMethod;  /* Response of a procedure to time out */
+
+    bleHost_PeerCallbacks   peer;
+    bleHost_Stats           stats;
+} BleHost_Class;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static void connEvent(uint8 *pData);
+static void notifyLinkDB(uint8 changeType);
+static bStatus_t enqueue(BleHost_TxQueue *pQueue, uint16 handle, uint8 *pValue, uint8 len);
+static BleHost_Packet *dequeue(BleHost_TxQueue *pQueue);
+static gattAttribute_t *findAttr(uint16 handle, const gattServiceCBs_t **ppCBs);
+static bStatus_t writeAttr(uint16 handle, uint8 *pValue, uint8 len);
+static void sendCfm(void);
+static gattMsgEvent_t *allocGattMsg(uint8 method, uint8 status);
+static void sendValue(BleHost_Packet *pPkt);
+static bool timeoutProcedure(uint8 method, uint8 taskId);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "ble_host";
+
+CONST uint8 primaryServiceUUID[ATT_BT_UUID_SIZE] =
+    { LO_UINT16(GATT_PRIMARY_SERVICE_UUID), HI_UINT16(GATT_PRIMARY_SERVICE_UUID) };
+CONST uint8 characterUUID[ATT_BT_UUID_SIZE] =
+    { LO_UINT16(GATT_CHARACTER_UUID), HI_UINT16(GATT_CHARACTER_UUID) };
+CONST uint8 clientCharCfgUUID[ATT_BT_UUID_SIZE] =
+    { LO_UINT16(GATT_CLIENT_CHAR_CFG_UUID), HI_UINT16(GATT_CLIENT_CHAR_CFG_UUID) };
+
+static BleHost_Class ble;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Host functions, see ble_host.h
+ *-------------------------------------------------------------------------*/
+void bleHost_init(void)
+{
+    memset(&ble, 0, sizeof(ble));
+
+    ble.timerId = INVALID_TIMER_ID;
+    ble.nextHandle = 1;
+}
+
+void bleHost_registerPeer(const bleHost_PeerCallbacks *pCallbacks)
+{
+    cb_ASSERT(pCallbacks != NULL);
+
+    ble.peer = *pCallbacks;
+}
+
+void bleHost_registerMtuCallback(bleHost_MtuCallback mtuCallback)
+{
+    ble.mtuCallback = mtuCallback;
+}
+
+void bleHost_connect(const bleHost_LinkCfg *pCfg)
+{
+    Status_t status;
+
+    cb_ASSERT(ble.connected == FALSE);
+    cb_ASSERT((pCfg->txBuffers > 0) && (pCfg->txBuffers <= BLE_HOST_MAX_TX_BUFFERS));
+    cb_ASSERT((pCfg->pktsPerEvent > 0) && (pCfg->connIntervalUs > 0));
+
+    ble.cfg = *pCfg;
+    ble.connected = TRUE;
+    ble.encrypted = FALSE;
+    ble.terminate = FALSE;
+    ble.indPending = FALSE;
+    ble.cfmPending = FALSE;
+    memset(&ble.localTx, 0, sizeof(ble.localTx));
+    memset(&ble.peerTx, 0, sizeof(ble.peerTx));
+
+    status = osalHost_startTimerUs(connEvent, NULL, pCfg->connIntervalUs,
+                                   pCfg->connIntervalUs, &ble.timerId);
+    cb_ASSERT(status == SUCCESS);
+
+    notifyLinkDB(LINKDB_STATUS_UPDATE_NEW);
+}
+
+void bleHost_disconnect(void)
+{
+    if (ble.connected == TRUE)
+    {
+        osal_CbTimerStop(ble.timerId);
+        ble.timerId = INVALID_TIMER_ID;
+
+        ble.connected = FALSE;
+        ble.encrypted = FALSE;
+        ble.localTx.count = 0;
+        ble.peerTx.count = 0;
+
+        notifyLinkDB(LINKDB_STATUS_UPDATE_REMOVED);
+    }
+}
+
+void bleHost_timeoutProcedure(uint8 method)
+{
+    ble.timeoutMethod = method;
+}
+
+bool bleHost_isConnected(void)
+{
+    return ble.connected;
+}
+
+void bleHost_setEncrypted(void)
+{
+    cb_ASSERT(ble.connected == TRUE);
+
+    ble.encrypted = TRUE;
+    notifyLinkDB(LINKDB_STATUS_UPDATE_STATEFLAGS);
+}
+
+gattAttribute_t *bleHost_findAttrByType(const uint8 *pUuid, uint8 len, uint8 n)
+{
+    gattAttribute_t *pAttr;
+    uint8           s;
+    uint16          i;
+
+    for (s = 0; s < ble.nServices; s++)
+    {
+        for (i = 0; i < ble.services[s].numAttrs; i++)
+        {
+            pAttr = &ble.services[s].pAttrs[i];
+
+            if ((pAttr->type.len == len) &&
+                (memcmp(pAttr->type.uuid, pUuid, len) == 0))
+            {
+                if (n == 0)
+                {
+                    return pAttr;
+                }
+                n--;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+bStatus_t bleHost_peerWrite(uint16 handle, uint8 *pValue, uint8 len)
+{
+    bStatus_t status;
+
+    if (ble.connected == FALSE)
+    {
+        return bleNotConnected;
+    }
+
+    status = enqueue(&ble.peerTx, handle, pValue, len);
+    if (status != SUCCESS)
+    {
+        ble.stats.nRxFull++;
+    }
+
+    return status;
+}
+
+bStatus_t bleHost_peerWriteReq(uint16 handle, uint8 *pValue, uint8 len)
+{
+    if (ble.connected == FALSE)
+    {
+        return bleNotConnected;
+    }
+
+    return writeAttr(handle, pValue, len);
+}
+
+bStatus_t bleHost_peerReadReq(uint16 handle, uint8 *pValue, uint8 *pLen, uint8 maxLen)
+{
+    gattAttribute_t         *pAttr;
+    const gattServiceCBs_t  *pCBs;
+
+    if (ble.connected == FALSE)
+    {
+        return bleNotConnected;
+    }
+
+    pAttr = findAttr(handle, &pCBs);
+    if (pAttr == NULL)
+    {
+        return ATT_ERR_INVALID_HANDLE;
+    }
+
+    if ((pAttr->permissions & (GATT_PERMIT_READ | GATT_PERMIT_AUTHEN_READ)) == 0)
+    {
+        return ATT_ERR_READ_NOT_PERMITTED;
+    }
+
+    return pCBs->pfnReadAttrCB(BLE_HOST_CONN_HANDLE, pAttr, pValue, pLen, 0, maxLen);
+}
+
+void bleHost_getStats(bleHost_Stats *pStats)
+{
+    *pStats = ble.stats;
+}
+
+void bleHost_clearStats(void)
+{
+    memset(&ble.stats, 0, sizeof(ble.stats));
+}
+
+/*---------------------------------------------------------------------------
+ * GATT server
+ *-------------------------------------------------------------------------*/
+bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated)
+{
+    bStatus_t status;
+
+    if ((ble.connected == FALSE) || (connHandle != BLE_HOST_CONN_HANDLE))
+    {
+        return bleNotConnected;
+    }
+
+    cb_ASSERT(pNoti->len <= (ATT_MTU_SIZE - 3));
+
+    status = enqueue(&ble.localTx, pNoti->handle, pNoti->value, pNoti->len);
+    if (status != SUCCESS)
+    {
+        ble.stats.nTxFull++;
+    }
+
+    return status;
+}
+
+/*---------------------------------------------------------------------------
+ * As on the target only one indication may wait for its confirmation.
+ *-------------------------------------------------------------------------*/
+bStatus_t GATT_Indication(uint16 connHandle, attHandleValueInd_t *pInd, uint8 authenticated, uint8 taskId)
+{
+    bStatus_t       status;
+    BleHost_Packet  *pPkt;
+
+    if ((ble.connected == FALSE) || (connHandle != BLE_HOST_CONN_HANDLE))
+    {
+        return bleNotConnected;
+    }
+
+    if (ble.indPending == TRUE)
+    {
+        return blePending;
+    }
+
+    status = enqueue(&ble.localTx, pInd->handle, pInd->value, pInd->len);
+    if (status == SUCCESS)
+    {
+        pPkt = &ble.localTx.pkt[(ble.localTx.head + ble.localTx.count - 1) % BLE_HOST_MAX_TX_BUFFERS];
+        pPkt->indication = TRUE;
+        pPkt->taskId = taskId;
+        ble.indPending = TRUE;
+    }
+    else
+    {
+        ble.stats.nTxFull++;
+    }
+
+    return status;
+}
+
+/*---------------------------------------------------------------------------
+ * GATT client. The client runs on the local side and uses the services
+ * registered on the same link, the local side is then both central and
+ * peripheral. Responses are sent to the task of the request as GATT
+ * messages. Write commands share the tx buffers of the peer.
+ *-------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------
+ * The local server gets the negotiated MTU through the MTU callback, as an
+ * application that handles the exchange, before the client gets the
+ * response.
+ *-------------------------------------------------------------------------*/
+bStatus_t GATT_ExchangeMTU(uint16 connHandle, attExchangeMTUReq_t *pReq, uint8 taskId)
+{
+    gattMsgEvent_t *pMsg;
+
+    if ((ble.connected == FALSE) || (connHandle != BLE_HOST_CONN_HANDLE))
+    {
+        return bleNotConnected;
+    }
+
+    if (timeoutProcedure(ATT_EXCHANGE_MTU_RSP, taskId) == TRUE)
+    {
+        return SUCCESS;
+    }
+
+    if (ble.mtuCallback != NULL)
+    {
+        ble.mtuCallback(BLE_HOST_CONN_HANDLE, MIN(pReq->clientRxMTU, ATT_MTU_SIZE));
+    }
+
+    pMsg = allocGattMsg(ATT_EXCHANGE_MTU_RSP, SUCCESS);
+    pMsg->msg.exchangeMTURsp.serverRxMTU = ATT_MTU_SIZE;
+    osal_msg_send(taskId, (uint8*)pMsg);
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * A found service is reported in one response, the procedure is then
+ * completed with an empty response as on the target.
+ *-------------------------------------------------------------------------*/
+bStatus_t GATT_DiscPrimaryServiceByUUID(uint16 connHandle, uint8 *pValue, uint8 len, uint8 taskId)
+{
+    gattMsgEvent_t  *pMsg;
+    gattAttribute_t *pDecl;
+    gattAttrType_t  *pService;
+    uint8           s;
+
+    if ((ble.connected == FALSE) || (connHandle != BLE_HOST_CONN_HANDLE))
+    {
+        return bleNotConnected;
+    }
+
+    if (timeoutProcedure(ATT_FIND_BY_TYPE_VALUE_RSP, taskId) == TRUE)
+    {
+        return SUCCESS;
+    }
+
+    for (s = 0; s < ble.nServices; s++)
+    {
+        pDecl = &ble.services[s].pAttrs[0];
+        pService = (gattAttrType_t*)pDecl->pValue;
+
+        if ((pDecl->type.len == ATT_BT_UUID_SIZE) &&
+            (memcmp(pDecl->type.uuid, primaryServiceUUID, ATT_BT_UUID_SIZE) == 0) &&
+            (pService->len == len) &&
+            (memcmp(pService->uuid, pValue, len) == 0))
+        {
+            pMsg = allocGattMsg(ATT_FIND_BY_TYPE_VALUE_RSP, SUCCESS);
+            pMsg->msg.findByTypeValueRsp.numInfo = 1;
+            pMsg->msg.findByTypeValueRsp.handlesInfo[0].handle = pDecl->handle;
+            pMsg->msg.findByTypeValueRsp.handlesInfo[0].grpEndHandle =
+                ble.services[s].pAttrs[ble.services[s].numAttrs - 1].handle;
+            osal_msg_send(taskId, (uint8*)pMsg);
+        }
+    }
+
+    pMsg = allocGattMsg(ATT_FIND_BY_TYPE_VALUE_RSP, bleProcedureComplete);
+    osal_msg_send(taskId, (uint8*)pMsg);
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * Every characteristic is reported in a response of its own: handle,
+ * properties, value handle and UUID of the value.
+ *-------------------------------------------------------------------------*/
+bStatus_t GATT_DiscAllChars(uint16 connHandle, uint16 startHandle, uint16 endHandle, uint8 taskId)
+{
+    gattMsgEvent_t          *pMsg;
+    gattAttribute_t         *pDecl;
+    gattAttribute_t         *pValueAttr;
+    const gattServiceCBs_t  *pCBs;
+    uint8                   *pPair;
+    uint16                  handle;
+
+    if ((ble.connected == FALSE) || (connHandle != BLE_HOST_CONN_HANDLE))
+    {
+        return bleNotConnected;
+    }
+
+    if (timeoutProcedure(ATT_READ_BY_TYPE_RSP, taskId) == TRUE)
+    {
+        return SUCCESS;
+    }
+
+    for (handle = startHandle; handle < endHandle; handle++)
+    {
+        pDecl = findAttr(handle, &pCBs);
+        pValueAttr = findAttr(handle + 1, &pCBs);
+
+        if ((pDecl == NULL) || (pValueAttr == NULL) ||
+            (pDecl->type.len != ATT_BT_UUID_SIZE) ||
+            (memcmp(pDecl->type.uuid, characterUUID, ATT_BT_UUID_SIZE) != 0))
+        {
+            continue;
+        }
+
+        pMsg = allocGattMsg(ATT_READ_BY_TYPE_RSP, SUCCESS);
+        pMsg->msg.readByTypeRsp.numPairs = 1;
+        pMsg->msg.readByTypeRsp.len = 5 + pValueAttr->type.len;
+
+        pPair = pMsg->msg.readByTypeRsp.dataList;
+        pPair[0] = LO_UINT16(handle);
+        pPair[1] = HI_UINT16(handle);
+        pPair[2] = *pDecl->pValue;
+        pPair[3] = LO_UINT16(handle + 1);
+        pPair[4] = HI_UINT16(handle + 1);
+        memcpy(&pPair[5], pValueAttr->type.uuid, pValueAttr->type.len);
+
+        osal_msg_send(taskId, (uint8*)pMsg);
+    }
+
+    pMsg = allocGattMsg(ATT_READ_BY_TYPE_RSP, bleProcedureComplete);
+    osal_msg_send(taskId, (uint8*)pMsg);
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * Written at once, the status of the write callback is returned in a
+ * write or error response.
+ *-------------------------------------------------------------------------*/
+bStatus_t GATT_WriteCharValue(uint16 connHandle, attWriteReq_t *pReq, uint8 taskId)
+{
+    gattMsgEvent_t  *pMsg;
+    bStatus_t       status;
+
+    if ((ble.connected == FALSE) || (connHandle != BLE_HOST_CONN_HANDLE))
+    {
+        return bleNotConnected;
+    }
+
+    if (timeoutProcedure(ATT_WRITE_RSP, taskId) == TRUE)
+    {
+        return SUCCESS;
+    }
+
+    status = writeAttr(pReq->handle, pReq->value, pReq->len);
+
+    if (status == SUCCESS)
+    {
+        pMsg = allocGattMsg(ATT_WRITE_RSP, SUCCESS);
+    }
+    else
+    {
+        pMsg = allocGattMsg(ATT_ERROR_RSP, SUCCESS);
+        pMsg->msg.errorRsp.reqOpcode = ATT_WRITE_REQ;
+        pMsg->msg.errorRsp.handle = pReq->handle;
+        pMsg->msg.errorRsp.errCode = status;
+    }
+    osal_msg_send(taskId, (uint8*)pMsg);
+
+    return SUCCESS;
+}
+
+bStatus_t GATT_WriteNoRsp(uint16 connHandle, attWriteReq_t *pReq)
+{
+    if (connHandle != BLE_HOST_CONN_HANDLE)
+    {
+        return bleNotConnected;
+    }
+
+    return bleHost_peerWrite(pReq->handle, pReq->value, pReq->len);
+}
+
+void GATT_RegisterForInd(uint8 taskId)
+{
+    ble.clientRegistered = TRUE;
+    ble.clientTaskId = taskId;
+}
+
+/*---------------------------------------------------------------------------
+ * The link confirms indications itself at the next connection event.
+ *-------------------------------------------------------------------------*/
+bStatus_t ATT_HandleValueCfm(uint16 connHandle)
+{
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * GATT server application
+ *-------------------------------------------------------------------------*/
+bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs,
+                                      CONST gattServiceCBs_t *pServiceCBs)
+{
+    uint16 i;
+
+    if (ble.nServices == BLE_HOST_MAX_SERVICES)
+    {
+        return bleNoResources;
+    }
+
+    for (i = 0; i < numAttrs; i++)
+    {
+        pAttrs[i].handle = ble.nextHandle++;
+    }
+
+    ble.services[ble.nServices].pAttrs = pAttrs;
+    ble.services[ble.nServices].numAttrs = numAttrs;
+    ble.services[ble.nServices].pCBs = pServiceCBs;
+    ble.nServices++;
+
+    return SUCCESS;
+}
+
+gattAttribute_t *GATTServApp_FindAttr(gattAttribute_t *pAttrTbl, uint16 numAttrs, uint8 *pValue)
+{
+    uint16 i;
+
+    for (i = 0; i < numAttrs; i++)
+    {
+        if (pAttrTbl[i].pValue == pValue)
+        {
+            return &pAttrTbl[i];
+        }
+    }
+
+    return NULL;
+}
+
+void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+    uint8 i;
+
+    for (i = 0; i < GATT_MAX_NUM_CONN; i++)
+    {
+        if ((connHandle == INVALID_CONNHANDLE) || (charCfgTbl[i].connHandle == connHandle))
+        {
+            charCfgTbl[i].connHandle = INVALID_CONNHANDLE;
+            charCfgTbl[i].value = 0;
+        }
+    }
+}
+
+uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+    uint8 i;
+
+    for (i = 0; i < GATT_MAX_NUM_CONN; i++)
+    {
+        if (charCfgTbl[i].connHandle == connHandle)
+        {
+            return charCfgTbl[i].value;
+        }
+    }
+
+    return 0;
+}
+
+bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr,
+                                         uint8 *pValue, uint8 len, uint16 offset,
+                                         uint16 validCfg)
+{
+    gattCharCfg_t   *pCfg = (gattCharCfg_t*)pAttr->pValue;
+    uint16          value;
+    uint8           i;
+    uint8           freeIdx = GATT_MAX_NUM_CONN;
+
+    if (offset != 0)
+    {
+        return ATT_ERR_ATTR_NOT_LONG;
+    }
+
+    if (len != 2)
+    {
+        return ATT_ERR_INVALID_VALUE_SIZE;
+    }
+
+    value = BUILD_UINT16(pValue[0], pValue[1]);
+    if ((value & ~validCfg) != 0)
+    {
+        return ATT_ERR_INVALID_VALUE;
+    }
+
+    for (i = 0; i < GATT_MAX_NUM_CONN; i++)
+    {
+        if (pCfg[i].connHandle == connHandle)
+        {
+            break;
+        }
+        if ((pCfg[i].connHandle == INVALID_CONNHANDLE) && (freeIdx == GATT_MAX_NUM_CONN))
+        {
+            freeIdx = i;
+        }
+    }
+
+    if (i == GATT_MAX_NUM_CONN)
+    {
+        i = freeIdx;
+    }
+
+    if (i == GATT_MAX_NUM_CONN)
+    {
+        return ATT_ERR_INSUFFICIENT_RESOURCES;
+    }
+
+    pCfg[i].connHandle = connHandle;
+    pCfg[i].value = (uint8)value;
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * Link database
+ *-------------------------------------------------------------------------*/
+uint8 linkDB_Register(pfnLinkDBCB_t pFunc)
+{
+    if (ble.nLinkDBCallbacks == BLE_HOST_MAX_LINKDB_CBS)
+    {
+        return bleMemAllocError;
+    }
+
+    ble.linkDBCallbacks[ble.nLinkDBCallbacks++] = pFunc;
+
+    return SUCCESS;
+}
+
+uint8 linkDB_State(uint16 connectionHandle, uint8 state)
+{
+    uint8 flags = LINK_NOT_CONNECTED;
+
+    if ((connectionHandle == BLE_HOST_CONN_HANDLE) && (ble.connected == TRUE))
+    {
+        flags = LINK_CONNECTED;
+        if (ble.encrypted == TRUE)
+        {
+            flags |= LINK_ENCRYPTED;
+        }
+    }
+
+    return ((flags & state) == state) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * GAP peripheral role. The link is dropped at the next connection event.
+ *-------------------------------------------------------------------------*/
+bStatus_t GAPRole_TerminateConnection(void)
+{
+    if (ble.connected == FALSE)
+    {
+        return bleIncorrectMode;
+    }
+
+    ble.terminate = TRUE;
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * GAP central role, as the peripheral role.
+ *-------------------------------------------------------------------------*/
+bStatus_t GAPCentralRole_TerminateLink(uint16 connHandle)
+{
+    if (connHandle != BLE_HOST_CONN_HANDLE)
+    {
+        return bleIncorrectMode;
+    }
+
+    return GAPRole_TerminateConnection();
+}
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * One connection event. The peer runs first, then the write commands of
+ * the peer and the notifications of the local side are delivered. The
+ * tx buffers of delivered packets are free for the next event.
+ *-------------------------------------------------------------------------*/
+static void connEvent(uint8 *pData)
+{
+    BleHost_Packet          pkt;
+    gattAttribute_t         *pAttr;
+    const gattServiceCBs_t  *pCBs;
+    uint8                   n;
+
+    ble.stats.nConnEvents++;
+
+    if (ble.terminate == TRUE)
+    {
+        bleHost_disconnect();
+        return;
+    }
+
+    if (ble.cfmPending == TRUE)
+    {
+        sendCfm();
+    }
+
+    if (ble.peer.connEventCallback != NULL)
+    {
+        ble.peer.connEventCallback();
+    }
+
+    for (n = 0; (n < ble.cfg.pktsPerEvent) && (ble.peerTx.count > 0) && (ble.connected == TRUE); n++)
+    {
+        pkt = *dequeue(&ble.peerTx);
+        ble.stats.nRxPackets++;
+
+        // Write commands have no response, errors are ignored by the stack
+        pAttr = findAttr(pkt.handle, &pCBs);
+        if (pAttr != NULL)
+        {
+            pCBs->pfnWriteAttrCB(BLE_HOST_CONN_HANDLE, pAttr, pkt.value, pkt.len, 0);
+        }
+    }
+
+    for (n = 0; (n < ble.cfg.pktsPerEvent) && (ble.localTx.count > 0) && (ble.connected == TRUE); n++)
+    {
+        // Copied since the callback may queue new packets
+        pkt = *dequeue(&ble.localTx);
+        ble.stats.nTxPackets++;
+
+        if (pkt.indication == TRUE)
+        {
+            ble.cfmPending = TRUE;
+            ble.cfmTaskId = pkt.taskId;
+        }
+
+        if (ble.peer.valueCallback != NULL)
+        {
+            ble.peer.valueCallback(pkt.handle, pkt.value, pkt.len);
+        }
+
+        if (ble.clientRegistered == TRUE)
+        {
+            sendValue(&pkt);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * The confirmation of an indication is reported to the task that sent it.
+ *-------------------------------------------------------------------------*/
+static void sendCfm(void)
+{
+    gattMsgEvent_t *pMsg;
+
+    ble.cfmPending = FALSE;
+    ble.indPending = FALSE;
+
+    pMsg = allocGattMsg(ATT_HANDLE_VALUE_CFM, SUCCESS);
+    osal_msg_send(ble.cfmTaskId, (uint8*)pMsg);
+}
+
+static gattMsgEvent_t *allocGattMsg(uint8 method, uint8 status)
+{
+    gattMsgEvent_t *pMsg;
+
+    pMsg = (gattMsgEvent_t*)osal_msg_allocate(sizeof(gattMsgEvent_t));
+    cb_ASSERT(pMsg != NULL);
+
+    memset(&pMsg->msg, 0, sizeof(pMsg->msg));
+    pMsg->hdr.event = GATT_MSG_EVENT;
+    pMsg->hdr.status = status;
+    pMsg->connHandle = BLE_HOST_CONN_HANDLE;
+    pMsg->method = method;
+
+    return pMsg;
+}
+
+/*---------------------------------------------------------------------------
+ * A procedure set up to time out ends with a single message with the
+ * timeout status, as when the remote side never responds.
+ *-------------------------------------------------------------------------*/
+static bool timeoutProcedure(uint8 method, uint8 taskId)
+{
+    gattMsgEvent_t *pMsg;
+
+    if (ble.timeoutMethod != method)
+    {
+        return FALSE;
+    }
+
+    ble.timeoutMethod = 0;
+    pMsg = allocGattMsg(method, bleTimeout);
+    osal_msg_send(taskId, (uint8*)pMsg);
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * A notification or indication received by the local client.
+ *-------------------------------------------------------------------------*/
+static void sendValue(BleHost_Packet *pPkt)
+{
+    gattMsgEvent_t *pMsg;
+
+    if (pPkt->indication == TRUE)
+    {
+        pMsg = allocGattMsg(ATT_HANDLE_VALUE_IND, SUCCESS);
+        pMsg->msg.handleValueInd.handle = pPkt->handle;
+        pMsg->msg.handleValueInd.len = pPkt->len;
+        memcpy(pMsg->msg.handleValueInd.value, pPkt->value, pPkt->len);
+    }
+    else
+    {
+        pMsg = allocGattMsg(ATT_HANDLE_VALUE_NOTI, SUCCESS);
+        pMsg->msg.handleValueNoti.handle = pPkt->handle;
+        pMsg->msg.handleValueNoti.len = pPkt->len;
+        memcpy(pMsg->msg.handleValueNoti.value, pPkt->value, pPkt->len);
+    }
+
+    osal_msg_send(ble.clientTaskId, (uint8*)pMsg);
+}
+
+static void notifyLinkDB(uint8 changeType)
+{
+    uint8 i;
+
+    for (i = 0; i < ble.nLinkDBCallbacks; i++)
+    {
+        ble.linkDBCallbacks[i](BLE_HOST_CONN_HANDLE, changeType);
+    }
+}
+
+static bStatus_t enqueue(BleHost_TxQueue *pQueue, uint16 handle, uint8 *pValue, uint8 len)
+{
+    BleHost_Packet *pPkt;
+
+    if (pQueue->count >= ble.cfg.txBuffers)
+    {
+        return bleNoResources;
+    }
+
+    cb_ASSERT(len <= (ATT_MTU_SIZE - 3));
+
+    pPkt = &pQueue->pkt[(pQueue->head + pQueue->count) % BLE_HOST_MAX_TX_BUFFERS];
+    pPkt->handle = handle;
+    pPkt->len = len;
+    pPkt->indication = FALSE;
+    memcpy(pPkt->value, pValue, len);
+    pQueue->count++;
+
+    return SUCCESS;
+}
+
+static BleHost_Packet *dequeue(BleHost_TxQueue *pQueue)
+{
+    BleHost_Packet *pPkt = &pQueue->pkt[pQueue->head];
+
+    cb_ASSERT(pQueue->count > 0);
+
+    pQueue->head = (pQueue->head + 1) % BLE_HOST_MAX_TX_BUFFERS;
+    pQueue->count--;
+
+    return pPkt;
+}
+
+static gattAttribute_t *findAttr(uint16 handle, const gattServiceCBs_t **ppCBs)
+{
+    uint8 s;
+
+    for (s = 0; s < ble.nServices; s++)
+    {
+        if ((handle >= ble.services[s].pAttrs[0].handle) &&
+            (handle < (ble.services[s].pAttrs[0].handle + ble.services[s].numAttrs)))
+        {
+            *ppCBs = ble.services[s].pCBs;
+            return &ble.services[s].pAttrs[handle - ble.services[s].pAttrs[0].handle];
+        }
+    }
+
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------
+ * A write request to a local attribute, the permissions are checked
+ * before the write callback of the service as in the stack.
+ *-------------------------------------------------------------------------*/
+static bStatus_t writeAttr(uint16 handle, uint8 *pValue, uint8 len)
+{
+    gattAttribute_t         *pAttr;
+    const gattServiceCBs_t  *pCBs;
+
+    pAttr = findAttr(handle, &pCBs);
+    if (pAttr == NULL)
+    {
+        return ATT_ERR_INVALID_HANDLE;
+    }
+
+    if ((pAttr->permissions & (GATT_PERMIT_WRITE | GATT_PERMIT_AUTHEN_WRITE)) == 0)
+    {
+        return ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+
+    if (((pAttr->permissions & GATT_PERMIT_AUTHEN_WRITE) != 0) && (ble.encrypted == FALSE))
+    {
+        return ATT_ERR_INSUFFICIENT_AUTHEN;
+    }
+
+    return pCBs->pfnWriteAttrCB(BLE_HOST_CONN_HANDLE, pAttr, pValue, len, 0);
+}
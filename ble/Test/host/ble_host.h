@@ -0,0 +1,160 @@
+#ifndef _BLE_HOST_H_
+#define _BLE_HOST_H_
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : ble_host.h
+ *
+ * Description : Host stand-in for the GATT server and client, linkDB and
+ *               GAP roles of the TI BLE stack, running on the host OSAL.
+ *
+ *               One link is modelled. Notifications, indications and the
+ *               write commands of the remote side are queued in the tx
+ *               buffers of the sending side and are delivered at the
+ *               connection events, at most pktsPerEvent packets in each
+ *               direction per event. When all tx buffers of the local
+ *               side are in use, GATT_Notification fails with
+ *               bleNoResources as on the target.
+ *
+ *               The remote side is the peer, see sps_peer.h, which gets
+ *               the notifications through the value callback and writes
+ *               the attributes of the local services with
+ *               bleHost_peerWrite and bleHost_peerWriteReq.
+ *
+ *               The GATT client functions use the local services as the
+ *               remote server, a client and a server on the same OSAL then
+ *               talk to each other over the link. The client gets the
+ *               notifications when it has called GATT_RegisterForInd.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+#include "gatt.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define BLE_HOST_CONN_HANDLE        (0)
+
+#ifndef BLE_HOST_MAX_TX_BUFFERS
+#define BLE_HOST_MAX_TX_BUFFERS     (16)
+#endif
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    uint32  connIntervalUs;     /* Time between connection events */
+    uint8   pktsPerEvent;       /* Packets per direction and event */
+    uint8   txBuffers;          /* Tx buffers per side, <= BLE_HOST_MAX_TX_BUFFERS */
+} bleHost_LinkCfg;
+
+/*---------------------------------------------------------------------------
+ * Called at the start of every connection event, before any packet is
+ * delivered, and for every notification or indication that the peer
+ * receives.
+ *-------------------------------------------------------------------------*/
+typedef void (*bleHost_ConnEventCallback)(void);
+typedef void (*bleHost_ValueCallback)(uint16 handle, uint8 *pValue, uint8 len);
+
+/*---------------------------------------------------------------------------
+ * Called when the client exchanges the MTU, with the negotiated MTU.
+ *-------------------------------------------------------------------------*/
+typedef void (*bleHost_MtuCallback)(uint16 connHandle, uint16 mtu);
+
+typedef struct
+{
+    bleHost_ConnEventCallback   connEventCallback;
+    bleHost_ValueCallback       valueCallback;
+} bleHost_PeerCallbacks;
+
+typedef struct
+{
+    uint32  nConnEvents;
+    uint32  nTxPackets;     /* Notifications and indications delivered */
+    uint32  nRxPackets;     /* Write commands delivered */
+    uint32  nTxFull;        /* Notifications rejected, no free tx buffer */
+    uint32  nRxFull;        /* Peer writes rejected, no free tx buffer */
+} bleHost_Stats;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Clears the registered services and link callbacks, called once before
+ * the services are added.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_init(void);
+
+/*---------------------------------------------------------------------------
+ * Registers the peer that receives the notifications.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_registerPeer(const bleHost_PeerCallbacks *pCallbacks);
+
+/*---------------------------------------------------------------------------
+ * Registers the server application that takes the MTU of GATT_ExchangeMTU,
+ * e.g. cbSPS_setMtu.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_registerMtuCallback(bleHost_MtuCallback mtuCallback);
+
+/*---------------------------------------------------------------------------
+ * Sets up the link, the linkDB callbacks are called and the connection
+ * events start.
+ * - pCfg: Link parameters, used until the link is disconnected.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_connect(const bleHost_LinkCfg *pCfg);
+
+/*---------------------------------------------------------------------------
+ * Drops the link. Queued packets are thrown away.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_disconnect(void);
+
+/*---------------------------------------------------------------------------
+ * The next GATT client procedure answered with the given response method
+ * times out instead. The client only gets one message, with the status
+ * bleTimeout.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_timeoutProcedure(uint8 method);
+
+/*---------------------------------------------------------------------------
+ * Returns TRUE while the link is up.
+ *-------------------------------------------------------------------------*/
+extern bool bleHost_isConnected(void);
+
+/*---------------------------------------------------------------------------
+ * Marks the link as encrypted, reported through the linkDB callbacks.
+ *-------------------------------------------------------------------------*/
+extern void bleHost_setEncrypted(void);
+
+/*---------------------------------------------------------------------------
+ * Returns the attribute of the local services that has the given type,
+ * used by the peer to find the handles. The n:th match is returned.
+ *-------------------------------------------------------------------------*/
+extern gattAttribute_t *bleHost_findAttrByType(const uint8 *pUuid, uint8 len, uint8 n);
+
+/*---------------------------------------------------------------------------
+ * Queues a write command from the peer, written to the attribute at a
+ * connection event. Returns bleNoResources when all tx buffers of the
+ * peer are in use.
+ *-------------------------------------------------------------------------*/
+extern bStatus_t bleHost_peerWrite(uint16 handle, uint8 *pValue, uint8 len);
+
+/*---------------------------------------------------------------------------
+ * Writes an attribute directly, as a write request from the peer. Returns
+ * the status of the write callback of the service.
+ *-------------------------------------------------------------------------*/
+extern bStatus_t bleHost_peerWriteReq(uint16 handle, uint8 *pValue, uint8 len);
+
+/*---------------------------------------------------------------------------
+ * Reads an attribute, as a read request from the peer.
+ * - maxLen: Size of pValue.
+ *-------------------------------------------------------------------------*/
+extern bStatus_t bleHost_peerReadReq(uint16 handle, uint8 *pValue, uint8 *pLen, uint8 maxLen);
+
+extern void bleHost_getStats(bleHost_Stats *pStats);
+extern void bleHost_clearStats(void);
+
+#endif
@@ -0,0 +1,178 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : osal_host.c
+ *
+ * Description : Host implementation of the OSAL memory and simple 
+ *               non-volatile memory functions and of the cb platform
+ *               functions, see osal_host.h.
+ *-------------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "comdef.h"
+#include "OSAL.h"
+#include "osal_snv.h"
+
+#include "cb_assert.h"
+#include "osal_host.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define OSAL_HOST_MAX_SNV_ITEMS     (16)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    bool            used;
+    osalSnvId_t     id;
+    osalSnvLen_t    len;
+    uint8           data[0xFF];
+} OsalHost_SnvItem;
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static OsalHost_SnvItem     snv[OSAL_HOST_MAX_SNV_ITEMS];
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Memory
+ *-------------------------------------------------------------------------*/
+void *osal_mem_alloc(uint16 size)
+{
+    return malloc(size);
+}
+
+void osal_mem_free(void *ptr)
+{
+    free(ptr);
+}
+
+void *osal_memcpy(void *pDst, const void *pSrc, unsigned int len)
+{
+    return memcpy(pDst, pSrc, len);
+}
+
+void *osal_memset(void *pDst, uint8 value, int len)
+{
+    return memset(pDst, value, len);
+}
+
+uint8 osal_memcmp(const void *pSrc1, const void *pSrc2, unsigned int len)
+{
+    return (memcmp(pSrc1, pSrc2, len) == 0) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * Simple non-volatile memory
+ *-------------------------------------------------------------------------*/
+uint8 osal_snv_init(void)
+{
+    return SUCCESS;
+}
+
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf)
+{
+    uint8 i;
+
+    for (i = 0; i < OSAL_HOST_MAX_SNV_ITEMS; i++)
+    {
+        if ((snv[i].used == TRUE) && (snv[i].id == id))
+        {
+            if (len > snv[i].len)
+            {
+                return NV_BAD_ITEM_LEN;
+            }
+
+            memcpy(pBuf, snv[i].data, len);
+            return SUCCESS;
+        }
+    }
+
+    return NV_OPER_FAILED;
+}
+
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf)
+{
+    uint8 i;
+    uint8 freeIdx = OSAL_HOST_MAX_SNV_ITEMS;
+
+    for (i = 0; i < OSAL_HOST_MAX_SNV_ITEMS; i++)
+    {
+        if ((snv[i].used == TRUE) && (snv[i].id == id))
+        {
+            break;
+        }
+
+        if ((snv[i].used == FALSE) && (freeIdx == OSAL_HOST_MAX_SNV_ITEMS))
+        {
+            freeIdx = i;
+        }
+    }
+
+    if (i == OSAL_HOST_MAX_SNV_ITEMS)
+    {
+        i = freeIdx;
+    }
+
+    if (i == OSAL_HOST_MAX_SNV_ITEMS)
+    {
+        return NV_OPER_FAILED;
+    }
+
+    snv[i].used = TRUE;
+    snv[i].id = id;
+    snv[i].len = len;
+    memcpy(snv[i].data, pBuf, len);
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * Asserts end the test with an error.
+ *-------------------------------------------------------------------------*/
+void cbASSERT_handler(int32 errorCode, const char* file, int32 line)
+{
+    fprintf(stderr, "ASSERT %s:%ld error %ld\n", file, (long)line, (long)errorCode);
+    exit(2);
+}
+
+void cbASSERT_resetHandler(void)
+{
+    fprintf(stderr, "RESET\n");
+    exit(3);
+}
+
+uint64_t osalHost_getNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t osalHost_getCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return osalHost_getNs();
+#endif
+}
@@ -0,0 +1,84 @@
+#ifndef _OSAL_HOST_H_
+#define _OSAL_HOST_H_
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : osal_host.h
+ *
+ * Description : Host implementation of OSAL and of the cb platform 
+ *               functions that the cb components use.
+ *
+ *               Tasks are dispatched from tasksArr as by OSAL on the 
+ *               target, the application defines tasksArr, tasksCnt, 
+ *               tasksEvents and osalInitTasks. Timers run on a virtual
+ *               clock with microsecond resolution that only moves when
+ *               the test calls osalHost_advanceTime. The functions
+ *               declared here are only used by the host tests.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+#include "osal_cbtimer.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+
+/* Task passes after which osalHost_runUntilIdle gives up, a task that
+   keeps setting its own events does not stop the virtual clock */
+#ifndef OSAL_HOST_MAX_PASSES
+#define OSAL_HOST_MAX_PASSES        (1000)
+#endif
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Runs the tasks until no task has events and no timer has expired.
+ * Returns FALSE if the tasks were still busy after OSAL_HOST_MAX_PASSES.
+ *-------------------------------------------------------------------------*/
+extern bool osalHost_runUntilIdle(void);
+
+/*---------------------------------------------------------------------------
+ * Moves the virtual clock forward. Timers expire in order and the tasks
+ * are run until idle after every expired timer.
+ * - us: Time in microseconds.
+ *-------------------------------------------------------------------------*/
+extern void osalHost_advanceTime(uint32 us);
+
+/*---------------------------------------------------------------------------
+ * Returns the virtual clock in microseconds.
+ *-------------------------------------------------------------------------*/
+extern uint64_t osalHost_getTimeUs(void);
+
+/*---------------------------------------------------------------------------
+ * Starts a callback timer with microsecond resolution, used by the host
+ * stand-ins that run faster than the millisecond OSAL timers. Stopped
+ * with osal_CbTimerStop.
+ * - pfnCbTimer: Callback.
+ * - pData: Passed to the callback.
+ * - timeoutUs: Time to the first callback.
+ * - reloadUs: Time between the following callbacks, 0 for one callback.
+ * - pTimerId: Returned timer id.
+ *-------------------------------------------------------------------------*/
+extern Status_t osalHost_startTimerUs(
+    pfnCbTimer_t pfnCbTimer, 
+    uint8 *pData, 
+    uint32 timeoutUs, 
+    uint32 reloadUs, 
+    uint8 *pTimerId);
+
+/*---------------------------------------------------------------------------
+ * Returns a monotonic host time stamp in ns, used to time benchmarks.
+ *-------------------------------------------------------------------------*/
+extern uint64_t osalHost_getNs(void);
+
+/*---------------------------------------------------------------------------
+ * Returns the cpu time stamp counter, used to count cycles in benchmarks.
+ * Hosts without a known counter return osalHost_getNs.
+ *-------------------------------------------------------------------------*/
+extern uint64_t osalHost_getCycles(void);
+
+#endif
@@ -0,0 +1,559 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : osal_tasks_host.c
+ *
+ * Description : Host implementation of the OSAL tasks, messages and
+ *               timers on the virtual clock, see osal_host.h.
+ *-------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "comdef.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "OSAL_Timers.h"
+#include "osal_cbtimer.h"
+
+#include "cb_assert.h"
+#include "osal_host.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+
+/* Task timers and callback timers share the table. The index of a
+   callback timer is its timer id. */
+#define OSAL_HOST_MAX_TIMERS        (32)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    bool            used;
+    uint64_t        expiry;     /* Virtual time in us */
+    uint32          reload;     /* us, 0 for a one-shot timer */
+
+    /* Task timer */
+    uint8           taskId;
+    uint16          event;
+
+    /* Callback timer, NULL for task timers */
+    pfnCbTimer_t    pfnCbTimer;
+    uint8           *pData;
+} OsalHost_Timer;
+
+typedef struct OsalHost_MsgHdr
+{
+    struct OsalHost_MsgHdr  *pNext;
+    uint8                   destTask;   /* TASK_NO_TASK when not queued */
+    uint16                  len;
+} OsalHost_MsgHdr;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static OsalHost_Timer *findTaskTimer(uint8 taskId, uint16 event);
+static uint8 startTaskTimer(uint8 taskId, uint16 event, uint32 timeout, bool reload);
+static uint8 allocTimer(void);
+static bool fireNextTimer(uint64_t until);
+static bool tasksBusy(void);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "osal_tasks_host";
+
+static uint64_t             now;
+static OsalHost_Timer       timers[OSAL_HOST_MAX_TIMERS];
+static OsalHost_MsgHdr      *pMsgQueue;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * System
+ *-------------------------------------------------------------------------*/
+uint8 osal_init_system(void)
+{
+    OsalHost_MsgHdr *pHdr;
+
+    memset(timers, 0, sizeof(timers));
+
+    while (pMsgQueue != NULL)
+    {
+        pHdr = pMsgQueue;
+        pMsgQueue = pHdr->pNext;
+        free(pHdr);
+    }
+
+    osalInitTasks();
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * One pass of the OSAL main loop. Expired timers are handled and then
+ * the task with the highest priority, the lowest index, that has events.
+ *-------------------------------------------------------------------------*/
+void osal_run_system(void)
+{
+    uint8  idx;
+    uint16 events;
+
+    while (fireNextTimer(now) == TRUE)
+    {
+    }
+
+    for (idx = 0; (idx < tasksCnt) && (tasksEvents[idx] == 0); idx++)
+    {
+    }
+
+    if (idx < tasksCnt)
+    {
+        events = tasksEvents[idx];
+        tasksEvents[idx] = 0;
+
+        events = (tasksArr[idx])(idx, events);
+
+        tasksEvents[idx] |= events;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Task events
+ *-------------------------------------------------------------------------*/
+uint8 osal_set_event(uint8 task_id, uint16 event_flag)
+{
+    if (task_id >= tasksCnt)
+    {
+        return INVALID_TASK;
+    }
+
+    tasksEvents[task_id] |= event_flag;
+
+    return SUCCESS;
+}
+
+uint8 osal_clear_event(uint8 task_id, uint16 event_flag)
+{
+    if (task_id >= tasksCnt)
+    {
+        return INVALID_TASK;
+    }
+
+    tasksEvents[task_id] &= ~event_flag;
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * Messages. A message is queued until it is received by its task.
+ *-------------------------------------------------------------------------*/
+uint8 *osal_msg_allocate(uint16 len)
+{
+    OsalHost_MsgHdr *pHdr;
+
+    pHdr = calloc(1, sizeof(OsalHost_MsgHdr) + len);
+    cb_ASSERT(pHdr != NULL);
+
+    pHdr->destTask = TASK_NO_TASK;
+    pHdr->len = len;
+
+    return (uint8*)(pHdr + 1);
+}
+
+uint8 osal_msg_deallocate(uint8 *msg_ptr)
+{
+    OsalHost_MsgHdr *pHdr;
+
+    if (msg_ptr == NULL)
+    {
+        return INVALID_MSG_POINTER;
+    }
+
+    pHdr = ((OsalHost_MsgHdr*)msg_ptr) - 1;
+
+    if (pHdr->destTask != TASK_NO_TASK)
+    {
+        return MSG_BUFFER_NOT_AVAIL;
+    }
+
+    free(pHdr);
+
+    return SUCCESS;
+}
+
+uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr)
+{
+    OsalHost_MsgHdr *pHdr;
+    OsalHost_MsgHdr **ppLast = &pMsgQueue;
+
+    if (msg_ptr == NULL)
+    {
+        return INVALID_MSG_POINTER;
+    }
+
+    if (destination_task >= tasksCnt)
+    {
+        osal_msg_deallocate(msg_ptr);
+        return INVALID_TASK;
+    }
+
+    pHdr = ((OsalHost_MsgHdr*)msg_ptr) - 1;
+    cb_ASSERT(pHdr->destTask == TASK_NO_TASK);
+
+    while (*ppLast != NULL)
+    {
+        ppLast = &((*ppLast)->pNext);
+    }
+
+    pHdr->pNext = NULL;
+    pHdr->destTask = destination_task;
+    *ppLast = pHdr;
+
+    return osal_set_event(destination_task, SYS_EVENT_MSG);
+}
+
+/*---------------------------------------------------------------------------
+ * Returns the oldest message of the task. SYS_EVENT_MSG is set again if
+ * the task has more messages, as on the target.
+ *-------------------------------------------------------------------------*/
+uint8 *osal_msg_receive(uint8 task_id)
+{
+    OsalHost_MsgHdr *pHdr;
+    OsalHost_MsgHdr **ppHdr = &pMsgQueue;
+
+    while ((*ppHdr != NULL) && ((*ppHdr)->destTask != task_id))
+    {
+        ppHdr = &((*ppHdr)->pNext);
+    }
+
+    pHdr = *ppHdr;
+    if (pHdr == NULL)
+    {
+        osal_clear_event(task_id, SYS_EVENT_MSG);
+        return NULL;
+    }
+
+    *ppHdr = pHdr->pNext;
+    pHdr->pNext = NULL;
+    pHdr->destTask = TASK_NO_TASK;
+
+    while ((*ppHdr != NULL) && ((*ppHdr)->destTask != task_id))
+    {
+        ppHdr = &((*ppHdr)->pNext);
+    }
+
+    if (*ppHdr != NULL)
+    {
+        osal_set_event(task_id, SYS_EVENT_MSG);
+    }
+    else
+    {
+        osal_clear_event(task_id, SYS_EVENT_MSG);
+    }
+
+    return (uint8*)(pHdr + 1);
+}
+
+/*---------------------------------------------------------------------------
+ * Task timers. Starting a running timer restarts it.
+ *-------------------------------------------------------------------------*/
+uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint32 timeout_value)
+{
+    return startTaskTimer(task_id, event_id, timeout_value, FALSE);
+}
+
+uint8 osal_start_reload_timer(uint8 task_id, uint16 event_id, uint32 timeout_value)
+{
+    return startTaskTimer(task_id, event_id, timeout_value, TRUE);
+}
+
+uint8 osal_stop_timerEx(uint8 task_id, uint16 event_id)
+{
+    OsalHost_Timer *pTimer = findTaskTimer(task_id, event_id);
+
+    if (pTimer == NULL)
+    {
+        return INVALID_EVENT_ID;
+    }
+
+    pTimer->used = FALSE;
+
+    return SUCCESS;
+}
+
+uint32 osal_get_timeoutEx(uint8 task_id, uint16 event_id)
+{
+    OsalHost_Timer *pTimer = findTaskTimer(task_id, event_id);
+
+    if (pTimer == NULL)
+    {
+        return 0;
+    }
+
+    return (uint32)((pTimer->expiry - now + 999) / 1000);
+}
+
+uint32 osal_GetSystemClock(void)
+{
+    return (uint32)(now / 1000);
+}
+
+/*---------------------------------------------------------------------------
+ * Callback timers
+ *-------------------------------------------------------------------------*/
+Status_t osal_CbTimerStart(pfnCbTimer_t pfnCbTimer, uint8 *pData, uint16 timeout, uint8 *pTimerId)
+{
+    return osalHost_startTimerUs(pfnCbTimer, pData, (uint32)timeout * 1000, 0, pTimerId);
+}
+
+Status_t osal_CbTimerUpdate(uint8 timerId, uint16 timeout)
+{
+    if ((timerId >= OSAL_HOST_MAX_TIMERS) ||
+        (timers[timerId].used == FALSE) ||
+        (timers[timerId].pfnCbTimer == NULL))
+    {
+        return INVALIDPARAMETER;
+    }
+
+    timers[timerId].expiry = now + ((uint64_t)timeout * 1000);
+
+    return SUCCESS;
+}
+
+Status_t osal_CbTimerStop(uint8 timerId)
+{
+    if ((timerId >= OSAL_HOST_MAX_TIMERS) ||
+        (timers[timerId].used == FALSE) ||
+        (timers[timerId].pfnCbTimer == NULL))
+    {
+        return INVALIDPARAMETER;
+    }
+
+    timers[timerId].used = FALSE;
+
+    return SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ * Host functions, see osal_host.h
+ *-------------------------------------------------------------------------*/
+bool osalHost_runUntilIdle(void)
+{
+    uint16 pass;
+
+    for (pass = 0; pass < OSAL_HOST_MAX_PASSES; pass++)
+    {
+        if (tasksBusy() == FALSE)
+        {
+            return TRUE;
+        }
+
+        osal_run_system();
+    }
+
+    return (tasksBusy() == FALSE);
+}
+
+void osalHost_advanceTime(uint32 us)
+{
+    uint64_t until = now + us;
+
+    osalHost_runUntilIdle();
+
+    while (fireNextTimer(until) == TRUE)
+    {
+        osalHost_runUntilIdle();
+    }
+
+    now = until;
+}
+
+uint64_t osalHost_getTimeUs(void)
+{
+    return now;
+}
+
+Status_t osalHost_startTimerUs(
+    pfnCbTimer_t pfnCbTimer,
+    uint8 *pData,
+    uint32 timeoutUs,
+    uint32 reloadUs,
+    uint8 *pTimerId)
+{
+    uint8 id;
+
+    cb_ASSERT(pfnCbTimer != NULL);
+
+    id = allocTimer();
+    if (id == INVALID_TIMER_ID)
+    {
+        if (pTimerId != NULL)
+        {
+            *pTimerId = INVALID_TIMER_ID;
+        }
+        return NO_TIMER_AVAIL;
+    }
+
+    timers[id].expiry = now + timeoutUs;
+    timers[id].reload = reloadUs;
+    timers[id].pfnCbTimer = pfnCbTimer;
+    timers[id].pData = pData;
+
+    if (pTimerId != NULL)
+    {
+        *pTimerId = id;
+    }
+
+    return SUCCESS;
+}
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static OsalHost_Timer *findTaskTimer(uint8 taskId, uint16 event)
+{
+    uint8 i;
+
+    for (i = 0; i < OSAL_HOST_MAX_TIMERS; i++)
+    {
+        if ((timers[i].used == TRUE) &&
+            (timers[i].pfnCbTimer == NULL) &&
+            (timers[i].taskId == taskId) &&
+            (timers[i].event == event))
+        {
+            return &timers[i];
+        }
+    }
+
+    return NULL;
+}
+
+static uint8 startTaskTimer(uint8 taskId, uint16 event, uint32 timeout, bool reload)
+{
+    OsalHost_Timer *pTimer;
+    uint8 id;
+
+    if (taskId >= tasksCnt)
+    {
+        return INVALID_TASK;
+    }
+
+    pTimer = findTaskTimer(taskId, event);
+    if (pTimer == NULL)
+    {
+        id = allocTimer();
+        if (id == INVALID_TIMER_ID)
+        {
+            return NO_TIMER_AVAIL;
+        }
+        pTimer = &timers[id];
+    }
+
+    pTimer->taskId = taskId;
+    pTimer->event = event;
+    pTimer->expiry = now + ((uint64_t)timeout * 1000);
+    pTimer->reload = (reload == TRUE) ? (timeout * 1000) : 0;
+
+    return SUCCESS;
+}
+
+static uint8 allocTimer(void)
+{
+    uint8 i;
+
+    for (i = 0; i < OSAL_HOST_MAX_TIMERS; i++)
+    {
+        if (timers[i].used == FALSE)
+        {
+            memset(&timers[i], 0, sizeof(OsalHost_Timer));
+            timers[i].used = TRUE;
+            return i;
+        }
+    }
+
+    return INVALID_TIMER_ID;
+}
+
+/*---------------------------------------------------------------------------
+ * Handles the timer that expires first, if it expires before or at until.
+ * The virtual clock is moved to the expiry time. Returns FALSE if no timer
+ * expired.
+ *-------------------------------------------------------------------------*/
+static bool fireNextTimer(uint64_t until)
+{
+    OsalHost_Timer  *pTimer = NULL;
+    pfnCbTimer_t    pfnCbTimer;
+    uint8           i;
+
+    for (i = 0; i < OSAL_HOST_MAX_TIMERS; i++)
+    {
+        if ((timers[i].used == TRUE) &&
+            (timers[i].expiry <= until) &&
+            ((pTimer == NULL) || (timers[i].expiry < pTimer->expiry)))
+        {
+            pTimer = &timers[i];
+        }
+    }
+
+    if (pTimer == NULL)
+    {
+        return FALSE;
+    }
+
+    if (pTimer->expiry > now)
+    {
+        now = pTimer->expiry;
+    }
+
+    if (pTimer->reload != 0)
+    {
+        pTimer->expiry += pTimer->reload;
+    }
+    else
+    {
+        pTimer->used = FALSE;
+    }
+
+    if (pTimer->pfnCbTimer != NULL)
+    {
+        pfnCbTimer = pTimer->pfnCbTimer;
+        pfnCbTimer(pTimer->pData);
+    }
+    else
+    {
+        osal_set_event(pTimer->taskId, pTimer->event);
+    }
+
+    return TRUE;
+}
+
+static bool tasksBusy(void)
+{
+    uint8 i;
+
+    for (i = 0; i < OSAL_HOST_MAX_TIMERS; i++)
+    {
+        if ((timers[i].used == TRUE) && (timers[i].expiry <= now))
+        {
+            return TRUE;
+        }
+    }
+
+    for (i = 0; i < tasksCnt; i++)
+    {
+        if (tasksEvents[i] != 0)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
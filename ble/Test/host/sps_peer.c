@@ -0,0 +1,277 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : sps_peer.c
+ *
+ * Description : Model of the remote side of the Serial Port Service,
+ *               see sps_peer.h.
+ *-------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "bcomdef.h"
+#include "att.h"
+#include "gatt.h"
+
+#include "cb_assert.h"
+#include "cb_serial_service.h"
+#include "ble_host.h"
+#include "sps_peer.h"
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    spsPeer_Callbacks   callbacks;
+    spsPeer_Cfg         cfg;
+
+    uint16              modeHandle;
+    uint16              fifoHandle;
+    uint16              creditsHandle;
+
+    uint8               txCredits;
+    uint8               rxCredits;
+    uint16              rxBuffered;
+
+    uint8               txBuf[ATT_MTU_SIZE - 3];
+    uint8               txLen;      /* Packet waiting for a free tx buffer */
+
+    spsPeer_Stats       stats;
+} SpsPeer_Class;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static void connEvent(void);
+static void valueReceived(uint16 handle, uint8 *pValue, uint8 len);
+static uint16 findValueHandle(const uint8 *pUuid);
+static void enableNotifications(uint16 valueHandle);
+static void giveCredits(void);
+static void sendData(void);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "sps_peer";
+
+static const uint8 modeUUID[ATT_UUID_SIZE] = { cbSPS_MODE_UUID };
+static const uint8 fifoUUID[ATT_UUID_SIZE] = { cbSPS_FIFO_UUID };
+static const uint8 creditsUUID[ATT_UUID_SIZE] = { cbSPS_CREDITS_UUID };
+
+static const bleHost_PeerCallbacks peerCallbacks =
+{
+    connEvent,
+    valueReceived
+};
+
+static SpsPeer_Class peer;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+void spsPeer_init(const spsPeer_Callbacks *pCallbacks)
+{
+    memset(&peer, 0, sizeof(peer));
+
+    peer.callbacks = *pCallbacks;
+
+    peer.modeHandle = findValueHandle(modeUUID);
+    peer.fifoHandle = findValueHandle(fifoUUID);
+    peer.creditsHandle = findValueHandle(creditsUUID);
+
+    bleHost_registerPeer(&peerCallbacks);
+}
+
+void spsPeer_connect(const spsPeer_Cfg *pCfg)
+{
+    uint8     value;
+    bStatus_t status;
+
+    cb_ASSERT((pCfg->fifoSize > 0) && (pCfg->fifoSize <= (ATT_MTU_SIZE - 3)));
+    cb_ASSERT(pCfg->rxBufSize >= pCfg->fifoSize);
+
+    peer.cfg = *pCfg;
+    peer.txCredits = 0;
+    peer.rxCredits = 0;
+    peer.rxBuffered = 0;
+    peer.txLen = 0;
+    memset(&peer.stats, 0, sizeof(peer.stats));
+
+    value = (pCfg->streaming == TRUE) ? cbSPS_MODE_STREAMING : cbSPS_MODE_CREDITS;
+    status = bleHost_peerWriteReq(peer.modeHandle, &value, 1);
+    cb_ASSERT(status == SUCCESS);
+
+    // The service connects when the credits notifications are enabled
+    enableNotifications(peer.fifoHandle);
+    enableNotifications(peer.creditsHandle);
+}
+
+void spsPeer_setFifoSize(uint8 fifoSize)
+{
+    cb_ASSERT((fifoSize > 0) && (fifoSize <= (ATT_MTU_SIZE - 3)));
+    cb_ASSERT(peer.cfg.rxBufSize >= fifoSize);
+
+    peer.cfg.fifoSize = fifoSize;
+}
+
+void spsPeer_getStats(spsPeer_Stats *pStats)
+{
+    *pStats = peer.stats;
+}
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static void connEvent(void)
+{
+    uint16 n = peer.rxBuffered;
+
+    if ((peer.cfg.consumePerEvent != 0) && (n > peer.cfg.consumePerEvent))
+    {
+        n = peer.cfg.consumePerEvent;
+    }
+    peer.rxBuffered -= n;
+
+    if (peer.cfg.streaming == FALSE)
+    {
+        giveCredits();
+    }
+
+    sendData();
+}
+
+static void valueReceived(uint16 handle, uint8 *pValue, uint8 len)
+{
+    uint16 room;
+
+    if (handle == peer.creditsHandle)
+    {
+        cb_ASSERT(len == 1);
+        peer.txCredits += pValue[0];
+    }
+    else if (handle == peer.fifoHandle)
+    {
+        if (peer.cfg.streaming == FALSE)
+        {
+            if (peer.rxCredits == 0)
+            {
+                peer.stats.nCreditErrors++;
+            }
+            else
+            {
+                peer.rxCredits--;
+            }
+        }
+
+        room = peer.cfg.rxBufSize - peer.rxBuffered;
+        if (len > room)
+        {
+            peer.stats.nLostBytes += len - room;
+            peer.rxBuffered = peer.cfg.rxBufSize;
+        }
+        else
+        {
+            peer.rxBuffered += len;
+        }
+
+        peer.stats.rxBytes += len;
+
+        if (peer.callbacks.rxDataCallback != NULL)
+        {
+            peer.callbacks.rxDataCallback(pValue, len);
+        }
+    }
+}
+
+static uint16 findValueHandle(const uint8 *pUuid)
+{
+    gattAttribute_t *pAttr = bleHost_findAttrByType(pUuid, ATT_UUID_SIZE, 0);
+
+    cb_ASSERT(pAttr != NULL);
+
+    return pAttr->handle;
+}
+
+/*---------------------------------------------------------------------------
+ * The client characteristic configuration follows the value.
+ *-------------------------------------------------------------------------*/
+static void enableNotifications(uint16 valueHandle)
+{
+    uint8     value[2] = { LO_UINT16(GATT_CLIENT_CFG_NOTIFY), HI_UINT16(GATT_CLIENT_CFG_NOTIFY) };
+    bStatus_t status;
+
+    status = bleHost_peerWriteReq(valueHandle + 1, value, sizeof(value));
+    cb_ASSERT(status == SUCCESS);
+}
+
+/*---------------------------------------------------------------------------
+ * Same rule as the service: credits are given for the part of the free
+ * rx buffer that is not already committed by outstanding credits.
+ *-------------------------------------------------------------------------*/
+static void giveCredits(void)
+{
+    uint16 fifoSize = peer.cfg.fifoSize;
+    uint16 committed = (uint16)peer.rxCredits * fifoSize;
+    uint16 room = peer.cfg.rxBufSize - peer.rxBuffered;
+    uint8  newCredits;
+
+    if ((peer.rxCredits > peer.cfg.creditsLowWater) ||
+        (room < (committed + fifoSize)))
+    {
+        return;
+    }
+
+    newCredits = (uint8)MIN((room - committed) / fifoSize, 0xFF - peer.rxCredits);
+
+    if (bleHost_peerWrite(peer.creditsHandle, &newCredits, 1) == SUCCESS)
+    {
+        peer.rxCredits += newCredits;
+        peer.stats.nGrants++;
+    }
+}
+
+static void sendData(void)
+{
+    bool credits = TRUE;
+
+    while (peer.callbacks.txDataCallback != NULL)
+    {
+        credits = ((peer.cfg.streaming == TRUE) || (peer.txCredits > 0));
+        if (credits == FALSE)
+        {
+            break;
+        }
+
+        if (peer.txLen == 0)
+        {
+            peer.txLen = peer.callbacks.txDataCallback(peer.txBuf, peer.cfg.fifoSize);
+            if (peer.txLen == 0)
+            {
+                break;
+            }
+        }
+
+        if (bleHost_peerWrite(peer.fifoHandle, peer.txBuf, peer.txLen) != SUCCESS)
+        {
+            // Sent when a tx buffer is free
+            break;
+        }
+
+        peer.stats.txBytes += peer.txLen;
+        peer.txLen = 0;
+
+        if (peer.cfg.streaming == FALSE)
+        {
+            peer.txCredits--;
+        }
+    }
+
+    if ((credits == FALSE) && (peer.callbacks.txDataCallback != NULL))
+    {
+        peer.stats.nTxStalled++;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef _SPS_PEER_H_
+#define _SPS_PEER_H_
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : sps_peer.h
+ *
+ * Description : Model of the remote side of the Serial Port Service,
+ *               running on the link of ble_host.h.
+ *
+ *               The peer enables the fifo and credits notifications and
+ *               then runs the credit protocol at every connection event:
+ *               its application reads consumePerEvent bytes from the rx
+ *               buffer, new credits are given when the outstanding credits
+ *               are at or below creditsLowWater and the free rx buffer
+ *               allows it, and fifo data is written as long as there are
+ *               tx credits and free tx buffers.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    uint16  rxBufSize;          /* Rx buffer of the peer in bytes */
+    uint16  consumePerEvent;    /* Bytes read per event, 0 to read all */
+    uint8   creditsLowWater;    /* Credits are given at or below this */
+    uint8   fifoSize;           /* Fifo payload of the link */
+    bool    streaming;          /* Streaming mode, no credits are used */
+} spsPeer_Cfg;
+
+/*---------------------------------------------------------------------------
+ * The tx data callback fills in the next fifo packet and returns its size,
+ * 0 when there is no more data. The rx data callback gets the received
+ * fifo data.
+ *-------------------------------------------------------------------------*/
+typedef uint8 (*spsPeer_TxDataCallback)(uint8 *pBuf, uint8 maxLen);
+typedef void (*spsPeer_RxDataCallback)(uint8 *pBuf, uint8 len);
+
+typedef struct
+{
+    spsPeer_TxDataCallback  txDataCallback;
+    spsPeer_RxDataCallback  rxDataCallback;
+} spsPeer_Callbacks;
+
+typedef struct
+{
+    uint32  rxBytes;
+    uint32  txBytes;
+    uint32  nLostBytes;     /* Received without room in the rx buffer */
+    uint32  nCreditErrors;  /* Fifo packets received without credits */
+    uint32  nGrants;        /* Credit notifications written */
+    uint32  nTxStalled;     /* Events where data waited for credits */
+} spsPeer_Stats;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Registers the peer to ble_host, called after the service is added.
+ *-------------------------------------------------------------------------*/
+extern void spsPeer_init(const spsPeer_Callbacks *pCallbacks);
+
+/*---------------------------------------------------------------------------
+ * Sets up the serial port on a connected link. The mode is written and
+ * the notifications are enabled, the fifo before the credits.
+ *-------------------------------------------------------------------------*/
+extern void spsPeer_connect(const spsPeer_Cfg *pCfg);
+
+/*---------------------------------------------------------------------------
+ * Changes the fifo payload of the peer on a connected link, as after an
+ * MTU exchange. Credits the peer already has are used with the new size.
+ *-------------------------------------------------------------------------*/
+extern void spsPeer_setFifoSize(uint8 fifoSize);
+
+extern void spsPeer_getStats(spsPeer_Stats *pStats);
+
+#endif
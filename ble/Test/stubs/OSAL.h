@@ -0,0 +1,58 @@
+#ifndef OSAL_H
+#define OSAL_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : OSAL.h
+ *
+ * Description : Host replacement of the OSAL API of the TI BLE stack.
+ *               Implemented in host/osal_host.c and host/osal_tasks_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+#include "OSAL_Timers.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define SYS_EVENT_MSG               (0x8000)
+
+#define TASK_NO_TASK                (0xFF)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+  uint8  event;
+  uint8  status;
+} osal_event_hdr_t;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/* Task events */
+extern uint8 osal_set_event(uint8 task_id, uint16 event_flag);
+extern uint8 osal_clear_event(uint8 task_id, uint16 event_flag);
+
+/* Messages */
+extern uint8 *osal_msg_allocate(uint16 len);
+extern uint8 osal_msg_deallocate(uint8 *msg_ptr);
+extern uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr);
+extern uint8 *osal_msg_receive(uint8 task_id);
+
+/* Memory */
+extern void *osal_mem_alloc(uint16 size);
+extern void osal_mem_free(void *ptr);
+extern void *osal_memcpy(void *pDst, const void *pSrc, unsigned int len);
+extern void *osal_memset(void *pDst, uint8 value, int len);
+extern uint8 osal_memcmp(const void *pSrc1, const void *pSrc2, unsigned int len);
+
+/* System */
+extern uint8 osal_init_system(void);
+extern void osal_run_system(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef OSAL_TASKS_H
+#define OSAL_TASKS_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : OSAL_Tasks.h
+ *
+ * Description : Host replacement of the OSAL task table. As on the target 
+ *               the table, the event array and osalInitTasks are defined 
+ *               by the application, see OSAL_init.c of the demo.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef uint16 (*pTaskEventHandlerFn)(uint8 task_id, uint16 event);
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+extern const pTaskEventHandlerFn tasksArr[];
+extern const uint8 tasksCnt;
+extern uint16 *tasksEvents;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern void osalInitTasks(void);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef OSAL_TIMERS_H
+#define OSAL_TIMERS_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : OSAL_Timers.h
+ *
+ * Description : Host replacement of the OSAL timers. The timers run on
+ *               the virtual clock of host/osal_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint32 timeout_value);
+extern uint8 osal_start_reload_timer(uint8 task_id, uint16 event_id, uint32 timeout_value);
+extern uint8 osal_stop_timerEx(uint8 task_id, uint16 event_id);
+extern uint32 osal_get_timeoutEx(uint8 task_id, uint16 event_id);
+extern uint32 osal_GetSystemClock(void);
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef ATT_H
+#define ATT_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : att.h
+ *
+ * Description : Host replacement of the ATT definitions of the TI BLE 
+ *               stack. ATT_MTU_SIZE may be set on the command line to 
+ *               build for a stack with a larger MTU.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#ifndef ATT_MTU_SIZE
+#define ATT_MTU_SIZE                        (23)
+#endif
+
+#define ATT_BT_UUID_SIZE                    (2)
+#define ATT_UUID_SIZE                       (16)
+
+#define ATT_MAX_NUM_HANDLES_INFO            ((ATT_MTU_SIZE - 1) / 4)
+
+/* Methods */
+#define ATT_ERROR_RSP                       (0x01)
+#define ATT_EXCHANGE_MTU_REQ                (0x02)
+#define ATT_EXCHANGE_MTU_RSP                (0x03)
+#define ATT_FIND_INFO_REQ                   (0x04)
+#define ATT_FIND_INFO_RSP                   (0x05)
+#define ATT_FIND_BY_TYPE_VALUE_REQ          (0x06)
+#define ATT_FIND_BY_TYPE_VALUE_RSP          (0x07)
+#define ATT_READ_BY_TYPE_REQ                (0x08)
+#define ATT_READ_BY_TYPE_RSP                (0x09)
+#define ATT_READ_REQ                        (0x0A)
+#define ATT_READ_RSP                        (0x0B)
+#define ATT_WRITE_REQ                       (0x12)
+#define ATT_WRITE_RSP                       (0x13)
+#define ATT_HANDLE_VALUE_NOTI               (0x1B)
+#define ATT_HANDLE_VALUE_IND                (0x1D)
+#define ATT_HANDLE_VALUE_CFM                (0x1E)
+
+/* Error codes */
+#define ATT_ERR_INVALID_HANDLE              (0x01)
+#define ATT_ERR_READ_NOT_PERMITTED          (0x02)
+#define ATT_ERR_WRITE_NOT_PERMITTED         (0x03)
+#define ATT_ERR_INVALID_PDU                 (0x04)
+#define ATT_ERR_INSUFFICIENT_AUTHEN         (0x05)
+#define ATT_ERR_UNSUPPORTED_REQ             (0x06)
+#define ATT_ERR_INVALID_OFFSET              (0x07)
+#define ATT_ERR_INSUFFICIENT_AUTHOR         (0x08)
+#define ATT_ERR_ATTR_NOT_FOUND              (0x0A)
+#define ATT_ERR_ATTR_NOT_LONG               (0x0B)
+#define ATT_ERR_INVALID_VALUE_SIZE          (0x0D)
+#define ATT_ERR_INSUFFICIENT_ENCRYPT        (0x0F)
+#define ATT_ERR_INSUFFICIENT_RESOURCES      (0x11)
+#define ATT_ERR_INVALID_VALUE               (0x80)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+  uint8   reqOpcode;
+  uint16  handle;
+  uint8   errCode;
+} attErrorRsp_t;
+
+typedef struct
+{
+  uint16  clientRxMTU;
+} attExchangeMTUReq_t;
+
+typedef struct
+{
+  uint16  serverRxMTU;
+} attExchangeMTURsp_t;
+
+typedef struct
+{
+  uint16  handle;
+  uint16  grpEndHandle;
+} attHandlesInfo_t;
+
+typedef struct
+{
+  uint8             numInfo;
+  attHandlesInfo_t  handlesInfo[ATT_MAX_NUM_HANDLES_INFO];
+} attFindByTypeValueRsp_t;
+
+typedef struct
+{
+  uint8   numPairs;
+  uint8   len;
+  uint8   dataList[ATT_MTU_SIZE - 2];
+} attReadByTypeRsp_t;
+
+typedef struct
+{
+  uint16  handle;
+  uint8   len;
+  uint8   value[ATT_MTU_SIZE - 3];
+  uint8   sig;
+  uint8   cmd;
+} attWriteReq_t;
+
+typedef struct
+{
+  uint16  handle;
+  uint8   len;
+  uint8   value[ATT_MTU_SIZE - 3];
+} attHandleValueNoti_t;
+
+typedef struct
+{
+  uint16  handle;
+  uint8   len;
+  uint8   value[ATT_MTU_SIZE - 3];
+} attHandleValueInd_t;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern bStatus_t ATT_HandleValueCfm(uint16 connHandle);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BCOMDEF_H
+#define BCOMDEF_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : bcomdef.h
+ *
+ * Description : Host replacement of the common BLE definitions of the TI 
+ *               BLE stack.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define B_ADDR_LEN                  (6)
+
+#define INVALID_CONNHANDLE          (0xFFFF)
+#define LOOPBACK_CONNHANDLE         (0xFFFE)
+
+/* BLE status values */
+#define bleNotReady                 (0x10)
+#define bleAlreadyInRequestedMode   (0x11)
+#define bleIncorrectMode            (0x12)
+#define bleMemAllocError            (0x13)
+#define bleNotConnected             (0x14)
+#define bleNoResources              (0x15)
+#define blePending                  (0x16)
+#define bleTimeout                  (0x17)
+#define bleInvalidRange             (0x18)
+#define bleLinkEncrypted            (0x19)
+#define bleProcedureComplete        (0x1A)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef Status_t bStatus_t;
+
+#endif
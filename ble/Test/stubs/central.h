@@ -0,0 +1,21 @@
+#ifndef CENTRAL_H
+#define CENTRAL_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : central.h
+ *
+ * Description : Host replacement of the central GAP role of the TI BLE 
+ *               stack. Implemented in host/ble_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern bStatus_t GAPCentralRole_TerminateLink(uint16 connHandle);
+
+#endif
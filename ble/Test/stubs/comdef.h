@@ -0,0 +1,59 @@
+#ifndef COMDEF_H
+#define COMDEF_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : comdef.h
+ *
+ * Description : Host replacement of the common definitions of the TI BLE
+ *               stack. Only what the cb components use is defined.
+ *-------------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include "hal_types.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define CONST                       const
+
+/* Generic status return values */
+#define SUCCESS                     (0x00)
+#define FAILURE                     (0x01)
+#define INVALIDPARAMETER            (0x02)
+#define INVALID_TASK                (0x03)
+#define MSG_BUFFER_NOT_AVAIL        (0x04)
+#define INVALID_MSG_POINTER         (0x05)
+#define INVALID_EVENT_ID            (0x06)
+#define INVALID_INTERRUPT_ID        (0x07)
+#define NO_TIMER_AVAIL              (0x08)
+#define NV_ITEM_UNINIT              (0x09)
+#define NV_OPER_FAILED              (0x0A)
+#define INVALID_MEM_SIZE            (0x0B)
+#define NV_BAD_ITEM_LEN             (0x0C)
+
+#ifndef MIN
+#define MIN(n, m)                   (((n) < (m)) ? (n) : (m))
+#endif
+
+#ifndef MAX
+#define MAX(n, m)                   (((n) < (m)) ? (m) : (n))
+#endif
+
+#define BUILD_UINT16(loByte, hiByte) \
+          ((uint16)(((loByte) & 0x00FF) + (((hiByte) & 0x00FF) << 8)))
+
+#define BREAK_UINT32(var, ByteNum) \
+          (uint8)((uint32)(((var) >> ((ByteNum) * 8)) & 0x00FF))
+
+#define HI_UINT16(a)                (((a) >> 8) & 0xFF)
+#define LO_UINT16(a)                ((a) & 0xFF)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef uint8 Status_t;
+
+#endif
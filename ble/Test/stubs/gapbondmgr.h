@@ -0,0 +1,14 @@
+#ifndef GAPBONDMGR_H
+#define GAPBONDMGR_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : gapbondmgr.h
+ *
+ * Description : Empty host replacement, nothing in it is used by the
+ *               components built for the host.
+ *-------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef GATT_H
+#define GATT_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : gatt.h
+ *
+ * Description : Host replacement of the GATT API of the TI BLE stack.
+ *               Implemented in host/ble_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "att.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#ifndef GATT_MAX_NUM_CONN
+#define GATT_MAX_NUM_CONN                   (1)
+#endif
+
+#define GATT_MSG_EVENT                      (0xB0)
+
+/* Attribute permissions */
+#define GATT_PERMIT_READ                    (0x01)
+#define GATT_PERMIT_WRITE                   (0x02)
+#define GATT_PERMIT_AUTHEN_READ             (0x04)
+#define GATT_PERMIT_AUTHEN_WRITE            (0x08)
+#define GATT_PERMIT_AUTHOR_READ             (0x10)
+#define GATT_PERMIT_AUTHOR_WRITE            (0x20)
+
+/* Characteristic properties */
+#define GATT_PROP_BCAST                     (0x01)
+#define GATT_PROP_READ                      (0x02)
+#define GATT_PROP_WRITE_NO_RSP              (0x04)
+#define GATT_PROP_WRITE                     (0x08)
+#define GATT_PROP_NOTIFY                    (0x10)
+#define GATT_PROP_INDICATE                  (0x20)
+
+/* Client characteristic configuration */
+#define GATT_CLIENT_CFG_NOTIFY              (0x0001)
+#define GATT_CLIENT_CFG_INDICATE            (0x0002)
+
+#define GATT_NUM_ATTRS(attrs)               (sizeof(attrs) / sizeof(gattAttribute_t))
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+  uint8         len;
+  const uint8   *uuid;
+} gattAttrType_t;
+
+typedef struct
+{
+  gattAttrType_t  type;
+  uint8           permissions;
+  uint16          handle;
+  uint8 * const   pValue;
+} gattAttribute_t;
+
+typedef struct
+{
+  uint16  connHandle;
+  uint8   value;
+} gattCharCfg_t;
+
+typedef union
+{
+  attErrorRsp_t             errorRsp;
+  attExchangeMTURsp_t       exchangeMTURsp;
+  attFindByTypeValueRsp_t   findByTypeValueRsp;
+  attReadByTypeRsp_t        readByTypeRsp;
+  attHandleValueNoti_t      handleValueNoti;
+  attHandleValueInd_t       handleValueInd;
+} gattMsg_t;
+
+typedef struct
+{
+  osal_event_hdr_t  hdr;
+  uint16            connHandle;
+  uint8             method;
+  gattMsg_t         msg;
+} gattMsgEvent_t;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+/* Server */
+extern bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated);
+extern bStatus_t GATT_Indication(uint16 connHandle, attHandleValueInd_t *pInd, uint8 authenticated, uint8 taskId);
+
+/* Client */
+extern bStatus_t GATT_ExchangeMTU(uint16 connHandle, attExchangeMTUReq_t *pReq, uint8 taskId);
+extern bStatus_t GATT_DiscPrimaryServiceByUUID(uint16 connHandle, uint8 *pValue, uint8 len, uint8 taskId);
+extern bStatus_t GATT_DiscAllChars(uint16 connHandle, uint16 startHandle, uint16 endHandle, uint8 taskId);
+extern bStatus_t GATT_WriteCharValue(uint16 connHandle, attWriteReq_t *pReq, uint8 taskId);
+extern bStatus_t GATT_WriteNoRsp(uint16 connHandle, attWriteReq_t *pReq);
+extern void GATT_RegisterForInd(uint8 taskId);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef GATT_UUID_H
+#define GATT_UUID_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : gatt_uuid.h
+ *
+ * Description : Host replacement of the GATT attribute type UUIDs. 
+ *               Defined in host/ble_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define GATT_PRIMARY_SERVICE_UUID   (0x2800)
+#define GATT_CHARACTER_UUID         (0x2803)
+#define GATT_CLIENT_CHAR_CFG_UUID   (0x2902)
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+extern CONST uint8 primaryServiceUUID[];
+extern CONST uint8 characterUUID[];
+extern CONST uint8 clientCharCfgUUID[];
+
+#endif
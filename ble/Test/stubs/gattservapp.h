@@ -0,0 +1,48 @@
+#ifndef GATTSERVAPP_H
+#define GATTSERVAPP_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : gattservapp.h
+ *
+ * Description : Host replacement of the GATT server application of the 
+ *               TI BLE stack. Implemented in host/ble_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+#include "gatt.h"
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef bStatus_t (*pfnReadAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr, 
+                                     uint8 *pValue, uint8 *pLen, uint16 offset,
+                                     uint8 maxLen);
+typedef bStatus_t (*pfnWriteAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr,
+                                      uint8 *pValue, uint8 len, uint16 offset);
+typedef bStatus_t (*pfnAuthorizeAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr,
+                                          uint8 opcode);
+
+typedef struct
+{
+  pfnReadAttrCB_t       pfnReadAttrCB;
+  pfnWriteAttrCB_t      pfnWriteAttrCB;
+  pfnAuthorizeAttrCB_t  pfnAuthorizeAttrCB;
+} gattServiceCBs_t;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs,
+                                             CONST gattServiceCBs_t *pServiceCBs);
+extern gattAttribute_t *GATTServApp_FindAttr(gattAttribute_t *pAttrTbl, uint16 numAttrs,
+                                             uint8 *pValue);
+extern void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+extern uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+extern bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr,
+                                                uint8 *pValue, uint8 len, uint16 offset,
+                                                uint16 validCfg);
+
+#endif
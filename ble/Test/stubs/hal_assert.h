@@ -0,0 +1,14 @@
+#ifndef HAL_ASSERT_H
+#define HAL_ASSERT_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : hal_assert.h
+ *
+ * Description : Empty host replacement, nothing in it is used by the
+ *               components built for the host.
+ *-------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef HAL_TYPES_H
+#define HAL_TYPES_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : hal_types.h
+ *
+ * Description : Host replacement of the HAL types of the TI BLE stack.
+ *               The sizes follow the CC2540, int32 and uint32 are 32 bits
+ *               also on a 64 bit host.
+ *-------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef int8_t      int8;
+typedef uint8_t     uint8;
+typedef int16_t     int16;
+typedef uint16_t    uint16;
+typedef int32_t     int32;
+typedef uint32_t    uint32;
+
+typedef uint8       bool;
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#ifndef TRUE
+#define TRUE        (1)
+#endif
+
+#ifndef FALSE
+#define FALSE       (0)
+#endif
+
+#ifndef NULL
+#define NULL        ((void*)0)
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LINKDB_H
+#define LINKDB_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : linkdb.h
+ *
+ * Description : Host replacement of the link database of the TI BLE 
+ *               stack. Implemented in host/ble_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define LINKDB_STATUS_UPDATE_NEW            (0)
+#define LINKDB_STATUS_UPDATE_REMOVED        (1)
+#define LINKDB_STATUS_UPDATE_STATEFLAGS     (2)
+
+#define LINK_NOT_CONNECTED                  (0x00)
+#define LINK_CONNECTED                      (0x01)
+#define LINK_AUTHENTICATED                  (0x02)
+#define LINK_BOUND                          (0x04)
+#define LINK_ENCRYPTED                      (0x10)
+
+#define linkDB_Up(connHandle)               linkDB_State((connHandle), LINK_CONNECTED)
+#define linkDB_Encrypted(connHandle)        linkDB_State((connHandle), LINK_ENCRYPTED)
+#define linkDB_Authenticated(connHandle)    linkDB_State((connHandle), LINK_AUTHENTICATED)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef void (*pfnLinkDBCB_t)(uint16 connectionHandle, uint8 changeType);
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern uint8 linkDB_Register(pfnLinkDBCB_t pFunc);
+extern uint8 linkDB_State(uint16 connectionHandle, uint8 state);
+
+#endif
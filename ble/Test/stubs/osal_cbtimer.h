@@ -0,0 +1,36 @@
+#ifndef OSAL_CBTIMER_H
+#define OSAL_CBTIMER_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : osal_cbtimer.h
+ *
+ * Description : Host replacement of the OSAL callback timers. On the host
+ *               the callbacks are called directly from the virtual clock
+ *               instead of from the callback timer tasks.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define NUM_CBTIMERS                (16)
+
+#define INVALID_TIMER_ID            (0xFF)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef void (*pfnCbTimer_t)(uint8 *pData);
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern Status_t osal_CbTimerStart(pfnCbTimer_t pfnCbTimer, uint8 *pData, uint16 timeout, uint8 *pTimerId);
+extern Status_t osal_CbTimerUpdate(uint8 timerId, uint16 timeout);
+extern Status_t osal_CbTimerStop(uint8 timerId);
+
+#endif
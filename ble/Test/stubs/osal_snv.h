@@ -0,0 +1,33 @@
+#ifndef OSAL_SNV_H
+#define OSAL_SNV_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : osal_snv.h
+ *
+ * Description : Host replacement of the OSAL simple non-volatile memory.
+ *               The items are kept in RAM for the life of the process.
+ *-------------------------------------------------------------------------*/
+
+#include "comdef.h"
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+#ifdef OSAL_SNV_UINT16_ID
+typedef uint16 osalSnvId_t;
+#else
+typedef uint8 osalSnvId_t;
+#endif
+typedef uint8 osalSnvLen_t;
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern uint8 osal_snv_init(void);
+extern uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf);
+extern uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf);
+
+#endif
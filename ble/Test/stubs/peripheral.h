@@ -0,0 +1,21 @@
+#ifndef PERIPHERAL_H
+#define PERIPHERAL_H
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : peripheral.h
+ *
+ * Description : Host replacement of the peripheral GAP role of the TI BLE 
+ *               stack. Implemented in host/ble_host.c.
+ *-------------------------------------------------------------------------*/
+
+#include "bcomdef.h"
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+extern bStatus_t GAPRole_TerminateConnection(void);
+
+#endif
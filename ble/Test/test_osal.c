@@ -0,0 +1,349 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : test_osal.c
+ *
+ * Description : Test of the host OSAL layer that the other host tests
+ *               run on: task dispatch, events, task timers, callback
+ *               timers, messages and simple non-volatile memory on the
+ *               virtual clock.
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comdef.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "OSAL_Timers.h"
+#include "osal_cbtimer.h"
+#include "osal_snv.h"
+
+#include "cb_assert.h"
+#include "osal_host.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define CHECK(c) \
+    do { if (!(c)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c); exit(1); } } while (0)
+
+#define TEST_EVENT_A        (0x0001)
+#define TEST_EVENT_B        (0x0002)
+#define TEST_EVENT_REPEAT   (0x0004)
+
+#define TEST_MSG_EVENT      (0xD0)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    osal_event_hdr_t    hdr;
+    uint8               value;
+} TestMsg;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static uint16 lowTask_processEvent(uint8 taskId, uint16 events);
+static uint16 highTask_processEvent(uint8 taskId, uint16 events);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "test_osal";
+
+/* Index 0 has the highest priority, as in OSAL_init.c */
+const pTaskEventHandlerFn tasksArr[] =
+{
+    highTask_processEvent,
+    lowTask_processEvent
+};
+
+const uint8 tasksCnt = sizeof(tasksArr) / sizeof(tasksArr[0]);
+uint16 *tasksEvents;
+
+static uint8 highTaskId;
+static uint8 lowTaskId;
+
+/* Log of handled events, one entry per call */
+static struct
+{
+    uint8       taskId;
+    uint16      events;
+    uint64_t    time;
+} eventLog[64];
+static uint8 nEvents;
+
+static uint8 nRepeat;
+static uint8 msgValues[8];
+static uint8 nMsgs;
+
+static uint64_t cbTime[4];
+static uint8 nCb;
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static void logEvent(uint8 taskId, uint16 events)
+{
+    cb_ASSERT(nEvents < (sizeof(eventLog) / sizeof(eventLog[0])));
+
+    eventLog[nEvents].taskId = taskId;
+    eventLog[nEvents].events = events;
+    eventLog[nEvents].time = osalHost_getTimeUs();
+    nEvents++;
+}
+
+static uint16 highTask_processEvent(uint8 taskId, uint16 events)
+{
+    logEvent(taskId, events);
+
+    return 0;
+}
+
+static uint16 lowTask_processEvent(uint8 taskId, uint16 events)
+{
+    TestMsg *pMsg;
+
+    if (events & SYS_EVENT_MSG)
+    {
+        /* One message per call, the event is set again by
+           osal_msg_receive while messages remain */
+        pMsg = (TestMsg*)osal_msg_receive(taskId);
+        if (pMsg != NULL)
+        {
+            CHECK(pMsg->hdr.event == TEST_MSG_EVENT);
+            msgValues[nMsgs++] = pMsg->value;
+            CHECK(osal_msg_deallocate((uint8*)pMsg) == SUCCESS);
+        }
+        return (events ^ SYS_EVENT_MSG);
+    }
+
+    logEvent(taskId, events);
+
+    /* Returned events are kept and handled in a later pass */
+    if ((events & TEST_EVENT_REPEAT) && (++nRepeat < 3))
+    {
+        return TEST_EVENT_REPEAT;
+    }
+
+    return 0;
+}
+
+static void cbTimerHandler(uint8 *pData)
+{
+    cbTime[nCb++] = osalHost_getTimeUs();
+    (*pData)++;
+}
+
+static void resetLog(void)
+{
+    nEvents = 0;
+    nRepeat = 0;
+    nMsgs = 0;
+    nCb = 0;
+}
+
+static void testEvents(void)
+{
+    resetLog();
+
+    CHECK(osal_set_event(lowTaskId, TEST_EVENT_A) == SUCCESS);
+    CHECK(osal_set_event(highTaskId, TEST_EVENT_B) == SUCCESS);
+    CHECK(osal_set_event(tasksCnt, TEST_EVENT_A) == INVALID_TASK);
+
+    CHECK(osalHost_runUntilIdle() == TRUE);
+
+    /* The task with the lowest index runs first */
+    CHECK(nEvents == 2);
+    CHECK((eventLog[0].taskId == highTaskId) && (eventLog[0].events == TEST_EVENT_B));
+    CHECK((eventLog[1].taskId == lowTaskId) && (eventLog[1].events == TEST_EVENT_A));
+
+    resetLog();
+    CHECK(osal_set_event(lowTaskId, TEST_EVENT_A | TEST_EVENT_B) == SUCCESS);
+    CHECK(osal_clear_event(lowTaskId, TEST_EVENT_B) == SUCCESS);
+    CHECK(osalHost_runUntilIdle() == TRUE);
+    CHECK((nEvents == 1) && (eventLog[0].events == TEST_EVENT_A));
+
+    resetLog();
+    CHECK(osal_set_event(lowTaskId, TEST_EVENT_REPEAT) == SUCCESS);
+    CHECK(osalHost_runUntilIdle() == TRUE);
+    CHECK(nEvents == 3);
+}
+
+static void testTaskTimers(void)
+{
+    uint64_t start = osalHost_getTimeUs();
+
+    resetLog();
+
+    CHECK(osal_start_timerEx(lowTaskId, TEST_EVENT_A, 10) == SUCCESS);
+    CHECK(osal_start_timerEx(highTaskId, TEST_EVENT_B, 5) == SUCCESS);
+    CHECK(osal_get_timeoutEx(lowTaskId, TEST_EVENT_A) == 10);
+
+    osalHost_advanceTime(4999);
+    CHECK(nEvents == 0);
+
+    /* Timers expire in order and the clock stands at the expiry time
+       while the task runs */
+    osalHost_advanceTime(20000);
+    CHECK(nEvents == 2);
+    CHECK((eventLog[0].taskId == highTaskId) && (eventLog[0].time == start + 5000));
+    CHECK((eventLog[1].taskId == lowTaskId) && (eventLog[1].time == start + 10000));
+    CHECK(osalHost_getTimeUs() == start + 24999);
+    CHECK(osal_GetSystemClock() == (uint32)((start + 24999) / 1000));
+
+    /* Starting a running timer restarts it */
+    resetLog();
+    start = osalHost_getTimeUs();
+    CHECK(osal_start_timerEx(lowTaskId, TEST_EVENT_A, 10) == SUCCESS);
+    osalHost_advanceTime(6000);
+    CHECK(osal_start_timerEx(lowTaskId, TEST_EVENT_A, 10) == SUCCESS);
+    osalHost_advanceTime(20000);
+    CHECK((nEvents == 1) && (eventLog[0].time == start + 16000));
+
+    /* Stopped timers do not expire */
+    resetLog();
+    CHECK(osal_start_timerEx(lowTaskId, TEST_EVENT_A, 10) == SUCCESS);
+    CHECK(osal_stop_timerEx(lowTaskId, TEST_EVENT_A) == SUCCESS);
+    CHECK(osal_stop_timerEx(lowTaskId, TEST_EVENT_A) == INVALID_EVENT_ID);
+    CHECK(osal_get_timeoutEx(lowTaskId, TEST_EVENT_A) == 0);
+    osalHost_advanceTime(20000);
+    CHECK(nEvents == 0);
+
+    /* Reload timer */
+    resetLog();
+    start = osalHost_getTimeUs();
+    CHECK(osal_start_reload_timer(highTaskId, TEST_EVENT_A, 7) == SUCCESS);
+    osalHost_advanceTime(30000);
+    CHECK(nEvents == 4);
+    CHECK(eventLog[3].time == start + 28000);
+    CHECK(osal_stop_timerEx(highTaskId, TEST_EVENT_A) == SUCCESS);
+    osalHost_advanceTime(30000);
+    CHECK(nEvents == 4);
+}
+
+static void testCbTimers(void)
+{
+    uint8    count = 0;
+    uint8    id;
+    uint8    id2;
+    uint64_t start = osalHost_getTimeUs();
+
+    resetLog();
+
+    CHECK(osal_CbTimerStart(cbTimerHandler, &count, 10, &id) == SUCCESS);
+    CHECK(id != INVALID_TIMER_ID);
+    CHECK(osal_CbTimerStart(cbTimerHandler, &count, 3, &id2) == SUCCESS);
+    CHECK(id2 != id);
+
+    /* Update restarts the timer from now */
+    osalHost_advanceTime(5000);
+    CHECK((count == 1) && (cbTime[0] == start + 3000));
+    CHECK(osal_CbTimerUpdate(id, 10) == SUCCESS);
+    osalHost_advanceTime(20000);
+    CHECK((count == 2) && (cbTime[1] == start + 15000));
+
+    /* An expired callback timer is released and can not be stopped */
+    CHECK(osal_CbTimerStop(id) == INVALIDPARAMETER);
+    CHECK(osal_CbTimerStop(INVALID_TIMER_ID) == INVALIDPARAMETER);
+
+    CHECK(osal_CbTimerStart(cbTimerHandler, &count, 10, &id) == SUCCESS);
+    CHECK(osal_CbTimerStop(id) == SUCCESS);
+    osalHost_advanceTime(20000);
+    CHECK(count == 2);
+
+    /* Microsecond timer with reload */
+    start = osalHost_getTimeUs();
+    nCb = 0;
+    CHECK(osalHost_startTimerUs(cbTimerHandler, &count, 1250, 1250, &id) == SUCCESS);
+    osalHost_advanceTime(3800);
+    CHECK((count == 5) && (cbTime[2] == start + 3750));
+    CHECK(osal_CbTimerStop(id) == SUCCESS);
+}
+
+static void testMessages(void)
+{
+    TestMsg *pMsg;
+    uint8   i;
+
+    resetLog();
+
+    for (i = 0; i < 3; i++)
+    {
+        pMsg = (TestMsg*)osal_msg_allocate(sizeof(TestMsg));
+        CHECK(pMsg != NULL);
+        pMsg->hdr.event = TEST_MSG_EVENT;
+        pMsg->value = 10 + i;
+        CHECK(osal_msg_send(lowTaskId, (uint8*)pMsg) == SUCCESS);
+    }
+
+    /* A queued message can not be freed by the sender */
+    CHECK(osal_msg_deallocate((uint8*)pMsg) == MSG_BUFFER_NOT_AVAIL);
+
+    pMsg = (TestMsg*)osal_msg_allocate(sizeof(TestMsg));
+    CHECK(osal_msg_send(tasksCnt, (uint8*)pMsg) == INVALID_TASK);
+    CHECK(osal_msg_send(lowTaskId, NULL) == INVALID_MSG_POINTER);
+
+    CHECK(osalHost_runUntilIdle() == TRUE);
+    CHECK((nMsgs == 3) && (msgValues[0] == 10) && (msgValues[1] == 11) && (msgValues[2] == 12));
+    CHECK(nEvents == 0);
+    CHECK(osal_msg_receive(lowTaskId) == NULL);
+}
+
+static void testSnv(void)
+{
+    uint8 wr[4] = {1, 2, 3, 4};
+    uint8 rd[4];
+
+    CHECK(osal_snv_init() == SUCCESS);
+    CHECK(osal_snv_read(0x80, sizeof(rd), rd) == NV_OPER_FAILED);
+
+    CHECK(osal_snv_write(0x80, sizeof(wr), wr) == SUCCESS);
+    memset(rd, 0, sizeof(rd));
+    CHECK(osal_snv_read(0x80, sizeof(rd), rd) == SUCCESS);
+    CHECK(memcmp(rd, wr, sizeof(wr)) == 0);
+
+    wr[0] = 9;
+    CHECK(osal_snv_write(0x80, sizeof(wr), wr) == SUCCESS);
+    CHECK(osal_snv_read(0x80, 1, rd) == SUCCESS);
+    CHECK(rd[0] == 9);
+
+    CHECK(osal_snv_write(0x81, 2, wr) == SUCCESS);
+    CHECK(osal_snv_read(0x81, 4, rd) == NV_BAD_ITEM_LEN);
+}
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+void osalInitTasks(void)
+{
+    uint8 taskID = 0;
+
+    tasksEvents = calloc(tasksCnt, sizeof(uint16));
+    cb_ASSERT(tasksEvents != NULL);
+
+    highTaskId = taskID++;
+    lowTaskId = taskID++;
+}
+
+int main(void)
+{
+    osal_init_system();
+
+    testEvents();
+    testTaskTimers();
+    testCbTimers();
+    testMessages();
+    testSnv();
+
+    printf("test_osal: OK\n");
+
+    return 0;
+}
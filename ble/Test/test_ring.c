@@ -0,0 +1,273 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : test_ring.c
+ *
+ * Description : Test of cb_ring. The full and empty checks are tested at
+ *               every position of the free running byte indexes, then a
+ *               producer and a consumer thread stream a numbered byte
+ *               sequence through rings of different sizes using both the
+ *               single byte and the block functions. The consumer now and
+ *               then waits until the producer has filled the ring, so the
+ *               full ring is also tested with both threads running.
+ *-------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comdef.h"
+#include "hal_types.h"
+
+#include "cb_ring.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define CHECK(c) \
+    do { if (!(c)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c); exit(1); } } while (0)
+
+#define TEST_STREAM_BYTES   (4UL * 1024 * 1024)
+#define TEST_MAX_BLOCK      (37)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    cbRING_Ring ring;
+    uint32      nBytes;
+    uint32      nFull;      /* Producer found the ring full */
+    uint32      nEmpty;     /* Consumer found the ring empty */
+    uint32      maxBytes;   /* Most bytes seen in the ring by the consumer */
+} Stream;
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static uint8 ringData[cbRING_MAX_SIZE];
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * Small pseudo random numbers, one generator per thread.
+ *-------------------------------------------------------------------------*/
+static uint32 nextRandom(uint32 *pState)
+{
+    *pState = (*pState * 1103515245UL) + 12345UL;
+    return (*pState >> 16) & 0x7FFF;
+}
+
+static uint8 seqByte(uint32 n)
+{
+    return (uint8)(n ^ (n >> 8) ^ (n >> 16));
+}
+
+/*---------------------------------------------------------------------------
+ * A full ring of the largest size holds 128 bytes, one more than an
+ * uint8 index difference of mask. Tested with the indexes starting at
+ * every byte value so that all wrap-arounds are covered.
+ *-------------------------------------------------------------------------*/
+static void testWrap(void)
+{
+    cbRING_Ring ring;
+    uint8       buf[cbRING_MAX_SIZE];
+    uint8       byte;
+    uint16      start;
+    uint16      i;
+
+    for (start = 0; start < 256; start++)
+    {
+        CHECK(cbRING_init(&ring, ringData, cbRING_MAX_SIZE) == cbRING_OK);
+
+        // Move both indexes to start
+        for (i = 0; i < start; i++)
+        {
+            CHECK(cbRING_put(&ring, 0) == cbRING_OK);
+            CHECK(cbRING_get(&ring, &byte) == cbRING_OK);
+        }
+        CHECK(ring.head == start);
+        CHECK(ring.tail == start);
+
+        CHECK(cbRING_getNoBytes(&ring) == 0);
+        CHECK(cbRING_getNoFreeBytes(&ring) == cbRING_MAX_SIZE);
+        CHECK(cbRING_get(&ring, &byte) == cbRING_NO_DATA);
+
+        for (i = 0; i < cbRING_MAX_SIZE - 1; i++)
+        {
+            CHECK(cbRING_put(&ring, (uint8)(start + i)) == cbRING_OK);
+        }
+        CHECK(cbRING_write(&ring, (uint8*)"x", 1) == 1);
+        CHECK(cbRING_put(&ring, 0) == cbRING_FULL);
+        CHECK(cbRING_write(&ring, buf, 1) == 0);
+        CHECK(cbRING_getNoBytes(&ring) == cbRING_MAX_SIZE);
+        CHECK(cbRING_getNoFreeBytes(&ring) == 0);
+
+        CHECK(cbRING_read(&ring, buf, sizeof(buf)) == cbRING_MAX_SIZE);
+        for (i = 0; i < cbRING_MAX_SIZE - 1; i++)
+        {
+            CHECK(buf[i] == (uint8)(start + i));
+        }
+        CHECK(buf[cbRING_MAX_SIZE - 1] == 'x');
+        CHECK(cbRING_read(&ring, buf, sizeof(buf)) == 0);
+        CHECK(cbRING_getNoBytes(&ring) == 0);
+        CHECK(ring.tail == (uint8)(start + cbRING_MAX_SIZE));
+    }
+}
+
+static void *producer(void *pArg)
+{
+    Stream  *pStream = (Stream*)pArg;
+    uint8   block[TEST_MAX_BLOCK];
+    uint32  state = 1;
+    uint32  n = 0;
+    uint8   size;
+    uint8   done;
+    uint8   i;
+
+    while (n < pStream->nBytes)
+    {
+        if ((nextRandom(&state) & 1) == 0)
+        {
+            if (cbRING_put(&pStream->ring, seqByte(n)) == cbRING_OK)
+            {
+                n++;
+            }
+            else
+            {
+                pStream->nFull++;
+                sched_yield();
+            }
+        }
+        else
+        {
+            size = (uint8)(1 + (nextRandom(&state) % TEST_MAX_BLOCK));
+            size = (uint8)MIN((uint32)size, pStream->nBytes - n);
+            for (i = 0; i < size; i++)
+            {
+                block[i] = seqByte(n + i);
+            }
+
+            done = cbRING_write(&pStream->ring, block, size);
+            n += done;
+            if (done < size)
+            {
+                pStream->nFull++;
+                sched_yield();
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void *consumer(void *pArg)
+{
+    Stream  *pStream = (Stream*)pArg;
+    uint8   block[TEST_MAX_BLOCK];
+    uint32  state = 2;
+    uint32  n = 0;
+    uint8   ringSize = pStream->ring.mask + 1;
+    uint8   nInRing;
+    uint8   byte;
+    uint8   size;
+    uint8   done;
+    uint8   i;
+
+    while (n < pStream->nBytes)
+    {
+        // Now and then wait for the producer to fill the ring
+        if ((nextRandom(&state) % 256) == 0)
+        {
+            while ((cbRING_getNoBytes(&pStream->ring) < ringSize) &&
+                   ((n + cbRING_getNoBytes(&pStream->ring)) < pStream->nBytes))
+            {
+                sched_yield();
+            }
+        }
+
+        nInRing = cbRING_getNoBytes(&pStream->ring);
+        CHECK(nInRing <= ringSize);
+        pStream->maxBytes = MAX(pStream->maxBytes, nInRing);
+
+        if ((nextRandom(&state) & 1) == 0)
+        {
+            if (cbRING_get(&pStream->ring, &byte) == cbRING_OK)
+            {
+                CHECK(byte == seqByte(n));
+                n++;
+            }
+            else
+            {
+                pStream->nEmpty++;
+                sched_yield();
+            }
+        }
+        else
+        {
+            size = (uint8)(1 + (nextRandom(&state) % TEST_MAX_BLOCK));
+
+            done = cbRING_read(&pStream->ring, block, size);
+            for (i = 0; i < done; i++)
+            {
+                CHECK(block[i] == seqByte(n + i));
+            }
+            n += done;
+            if (done == 0)
+            {
+                pStream->nEmpty++;
+                sched_yield();
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void testThreads(uint8 size)
+{
+    Stream    stream;
+    pthread_t prodThread;
+    pthread_t consThread;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.nBytes = TEST_STREAM_BYTES;
+    CHECK(cbRING_init(&stream.ring, ringData, size) == cbRING_OK);
+
+    CHECK(pthread_create(&consThread, NULL, consumer, &stream) == 0);
+    CHECK(pthread_create(&prodThread, NULL, producer, &stream) == 0);
+    CHECK(pthread_join(prodThread, NULL) == 0);
+    CHECK(pthread_join(consThread, NULL) == 0);
+
+    CHECK(cbRING_getNoBytes(&stream.ring) == 0);
+    CHECK(stream.maxBytes == size);
+
+    printf("ring size %3u: %lu bytes, %lu full, %lu empty, max %lu in ring\n",
+           size,
+           (unsigned long)stream.nBytes,
+           (unsigned long)stream.nFull,
+           (unsigned long)stream.nEmpty,
+           (unsigned long)stream.maxBytes);
+}
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+int main(void)
+{
+    testWrap();
+
+    testThreads(2);
+    testThreads(16);
+    testThreads(cbRING_MAX_SIZE);
+
+    printf("test_ring: OK\n");
+
+    return 0;
+}
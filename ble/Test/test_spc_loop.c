@@ -0,0 +1,441 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : test_spc_loop.c
+ *
+ * Description : Loopback test of the Serial Port Client against the
+ *               Serial Port Service. Both run as tasks on the host OSAL
+ *               and talk to each other over the link of ble_host, the
+ *               client through the GATT client stand-ins. The client
+ *               discovers the service, exchanges the MTU and enables the
+ *               credits, then both sides stream a numbered byte sequence
+ *               at the same time. The client sends from the slot of
+ *               cbSPC_getTxSlot, the server from a buffer of its own.
+ *
+ *               Each side has an rx buffer that is emptied at every
+ *               connection event, all at once for a fast reader or one
+ *               fifo packet for a slow one. The credits must keep the
+ *               buffers from overflowing, so no data may be lost. The
+ *               fifo payload must follow the exchanged MTU on both sides
+ *               before the first credits are given.
+ *
+ *               The throughput per direction is printed together with
+ *               the limit of the link, pktsPerEvent fifo packets per
+ *               connection interval. test_spc_loop_mtu is built with a
+ *               247 byte ATT MTU.
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "att.h"
+#include "gatt.h"
+
+#include "cb_assert.h"
+#include "cb_serial_service.h"
+#include "cb_serial_client.h"
+#include "osal_host.h"
+#include "ble_host.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define CHECK(c) \
+    do { if (!(c)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c); exit(1); } } while (0)
+
+#define TEST_STREAM_BYTES   (2UL * 1024 * 1024)
+#define TEST_INTERVAL_US    (7500)
+#define TEST_PKTS_PER_EVENT (4)
+#define TEST_RX_BUF_SIZE    (10 * cbSPS_MAX_FIFO_SIZE)
+
+// Fifo payload of the link after the MTU exchange
+#define TEST_FIFO_SIZE      (MIN(ATT_MTU_SIZE - 3, cbSPS_MAX_FIFO_SIZE))
+
+// The slow reader empties one fifo packet per event
+#define TEST_MAX_EVENTS     (2 * (TEST_STREAM_BYTES / TEST_FIFO_SIZE) + 1000)
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    bool        client;
+    bool        connected;
+    uint8       nDisconnects;
+    uint8       fifoSizeAtConnect;
+    uint8       tx[cbSPS_MAX_FIFO_SIZE];    /* Server tx buffer */
+    uint32      txBytes;
+    uint32      rxBytes;
+    uint16      rxBuffered;                 /* Bytes in the rx buffer */
+    uint32      nLost;                      /* Bytes that did not fit */
+    uint64_t    rxDoneUs;
+} Side;
+
+typedef struct
+{
+    const char  *pName;
+    uint16      consumePerEvent;
+} Case;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static void serverConnectEvt(uint16 connHandle);
+static void serverDisconnectEvt(uint16 connHandle);
+static void serverDataEvt(uint16 connHandle, uint8 *pBuf, uint8 size);
+static void serverDataCnf(uint16 connHandle);
+static void clientConnectEvt(uint16 connHandle);
+static void clientDisconnectEvt(uint16 connHandle);
+static void clientDataEvt(uint16 connHandle, uint8 *pBuf, uint8 size);
+static void clientDataCnf(uint16 connHandle);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "test_spc_loop";
+
+const pTaskEventHandlerFn tasksArr[] =
+{
+    cbSPS_processEvent,
+    cbSPC_processEvent
+};
+
+const uint8 tasksCnt = sizeof(tasksArr) / sizeof(tasksArr[0]);
+uint16 *tasksEvents;
+
+static cbSPS_Callbacks serverCallbacks =
+{
+    serverConnectEvt,
+    serverDisconnectEvt,
+    serverDataEvt,
+    serverDataCnf,
+    NULL
+};
+
+static cbSPS_Callbacks clientCallbacks =
+{
+    clientConnectEvt,
+    clientDisconnectEvt,
+    clientDataEvt,
+    clientDataCnf,
+    NULL
+};
+
+static const bleHost_LinkCfg link =
+{
+    TEST_INTERVAL_US,
+    TEST_PKTS_PER_EVENT,
+    4
+};
+
+static Side server;
+static Side client;
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+/*---------------------------------------------------------------------------
+ * The two directions use different sequences so that swapped data is
+ * found.
+ *-------------------------------------------------------------------------*/
+static uint8 seqByte(const Side *pTx, uint32 n)
+{
+    return (uint8)(n ^ (n >> 8) ^ (n >> 16) ^ ((pTx->client == TRUE) ? 0x5A : 0));
+}
+
+static void setRemainingBufSize(Side *pSide)
+{
+    uint16 size = TEST_RX_BUF_SIZE - pSide->rxBuffered;
+
+    if (pSide->client == TRUE)
+    {
+        cbSPC_setRemainingBufSize(BLE_HOST_CONN_HANDLE, size);
+    }
+    else
+    {
+        cbSPS_setRemainingBufSize(BLE_HOST_CONN_HANDLE, size);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Requests the next fifo packet of the stream, called at connect and
+ * from the data cnf callback.
+ *-------------------------------------------------------------------------*/
+static void sendNext(Side *pSide)
+{
+    uint8   *pBuf;
+    uint8   size;
+    uint8   status;
+    uint32  i;
+
+    if (pSide->txBytes >= TEST_STREAM_BYTES)
+    {
+        return;
+    }
+
+    if (pSide->client == TRUE)
+    {
+        pBuf = cbSPC_getTxSlot(BLE_HOST_CONN_HANDLE, &size);
+        CHECK(pBuf != NULL);
+    }
+    else
+    {
+        pBuf = pSide->tx;
+        size = cbSPS_getFifoSize(BLE_HOST_CONN_HANDLE);
+    }
+
+    size = (uint8)MIN(size, TEST_STREAM_BYTES - pSide->txBytes);
+    for (i = 0; i < size; i++)
+    {
+        pBuf[i] = seqByte(pSide, pSide->txBytes + i);
+    }
+
+    if (pSide->client == TRUE)
+    {
+        status = cbSPC_reqData(BLE_HOST_CONN_HANDLE, pBuf, size);
+    }
+    else
+    {
+        status = cbSPS_reqData(BLE_HOST_CONN_HANDLE, pBuf, size);
+    }
+    CHECK(status == SUCCESS);
+
+    pSide->txBytes += size;
+}
+
+static void connectEvt(Side *pSide, uint8 fifoSize)
+{
+    CHECK(pSide->connected == FALSE);
+
+    pSide->connected = TRUE;
+    pSide->fifoSizeAtConnect = fifoSize;
+
+    setRemainingBufSize(pSide);
+    sendNext(pSide);
+}
+
+static void dataEvt(Side *pSide, const Side *pTx, uint8 *pBuf, uint8 size)
+{
+    uint8 i;
+
+    CHECK(size <= TEST_FIFO_SIZE);
+
+    for (i = 0; i < size; i++)
+    {
+        CHECK(pBuf[i] == seqByte(pTx, pSide->rxBytes + i));
+    }
+    pSide->rxBytes += size;
+
+    if ((pSide->rxBuffered + size) > TEST_RX_BUF_SIZE)
+    {
+        pSide->nLost += size;
+    }
+    else
+    {
+        // The used space must be reported before new credits are given
+        pSide->rxBuffered += size;
+        setRemainingBufSize(pSide);
+    }
+
+    if (pSide->rxBytes == TEST_STREAM_BYTES)
+    {
+        pSide->rxDoneUs = osalHost_getTimeUs();
+    }
+}
+
+static void consume(Side *pSide, uint16 size)
+{
+    if ((pSide->connected == TRUE) && (pSide->rxBuffered > 0))
+    {
+        pSide->rxBuffered -= MIN(size, pSide->rxBuffered);
+        setRemainingBufSize(pSide);
+    }
+}
+
+static void serverConnectEvt(uint16 connHandle)
+{
+    connectEvt(&server, cbSPS_getFifoSize(connHandle));
+}
+
+static void serverDisconnectEvt(uint16 connHandle)
+{
+    server.connected = FALSE;
+    server.nDisconnects++;
+}
+
+static void serverDataEvt(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+    dataEvt(&server, &client, pBuf, size);
+}
+
+static void serverDataCnf(uint16 connHandle)
+{
+    sendNext(&server);
+}
+
+static void clientConnectEvt(uint16 connHandle)
+{
+    connectEvt(&client, cbSPC_getFifoSize(connHandle));
+}
+
+static void clientDisconnectEvt(uint16 connHandle)
+{
+    client.connected = FALSE;
+    client.nDisconnects++;
+}
+
+static void clientDataEvt(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+    dataEvt(&client, &server, pBuf, size);
+}
+
+static void clientDataCnf(uint16 connHandle)
+{
+    sendNext(&client);
+}
+
+/*---------------------------------------------------------------------------
+ * Sets up the link and the serial port on it. The MTU is exchanged
+ * before the service connects, so both sides start with the fifo payload
+ * of the link.
+ *-------------------------------------------------------------------------*/
+static void connect(void)
+{
+    memset(&server, 0, sizeof(server));
+    memset(&client, 0, sizeof(client));
+    client.client = TRUE;
+
+    cbSPC_enable();
+    bleHost_connect(&link);
+    CHECK(cbSPC_connect(BLE_HOST_CONN_HANDLE) == SUCCESS);
+    osalHost_runUntilIdle();
+
+    CHECK((server.connected == TRUE) && (client.connected == TRUE));
+    CHECK(server.fifoSizeAtConnect == TEST_FIFO_SIZE);
+    CHECK(client.fifoSizeAtConnect == TEST_FIFO_SIZE);
+}
+
+/*---------------------------------------------------------------------------
+ * The client drops the link, both sides get the disconnect callback.
+ *-------------------------------------------------------------------------*/
+static void disconnect(void)
+{
+    cbSPC_disable();
+    osalHost_advanceTime(TEST_INTERVAL_US);
+
+    CHECK(bleHost_isConnected() == FALSE);
+    CHECK((server.connected == FALSE) && (server.nDisconnects == 1));
+    CHECK((client.connected == FALSE) && (client.nDisconnects == 1));
+}
+
+/*---------------------------------------------------------------------------
+ * The characteristics discovery times out. The client must give up the
+ * setup so that it can be started again on the link.
+ *-------------------------------------------------------------------------*/
+static void testSetupTimeout(void)
+{
+    memset(&server, 0, sizeof(server));
+    memset(&client, 0, sizeof(client));
+    client.client = TRUE;
+
+    cbSPC_enable();
+    bleHost_connect(&link);
+    bleHost_timeoutProcedure(ATT_READ_BY_TYPE_RSP);
+    CHECK(cbSPC_connect(BLE_HOST_CONN_HANDLE) == SUCCESS);
+    osalHost_runUntilIdle();
+
+    CHECK((server.connected == FALSE) && (client.connected == FALSE));
+
+    CHECK(cbSPC_connect(BLE_HOST_CONN_HANDLE) == SUCCESS);
+    osalHost_runUntilIdle();
+
+    CHECK((server.connected == TRUE) && (client.connected == TRUE));
+
+    disconnect();
+}
+
+static void testStream(const Case *pCase)
+{
+    uint64_t    start;
+    uint32      nEvents = 0;
+    double      limit;
+
+    connect();
+
+    start = osalHost_getTimeUs();
+    while (((server.rxBytes < TEST_STREAM_BYTES) || (client.rxBytes < TEST_STREAM_BYTES)) &&
+           (nEvents < TEST_MAX_EVENTS))
+    {
+        osalHost_advanceTime(TEST_INTERVAL_US);
+        nEvents++;
+
+        consume(&server, pCase->consumePerEvent);
+        consume(&client, pCase->consumePerEvent);
+        osalHost_runUntilIdle();
+    }
+
+    CHECK((server.rxBytes == TEST_STREAM_BYTES) && (client.rxBytes == TEST_STREAM_BYTES));
+    CHECK((server.nLost == 0) && (client.nLost == 0));
+
+    limit = (double)TEST_PKTS_PER_EVENT * TEST_FIFO_SIZE * 1e6 / TEST_INTERVAL_US;
+
+    printf("test_spc_loop: %s reader, fifo %u, %lu bytes each way, "
+           "server to client %.0f B/s, client to server %.0f B/s, link limit %.0f B/s\n",
+           pCase->pName,
+           TEST_FIFO_SIZE,
+           (unsigned long)TEST_STREAM_BYTES,
+           TEST_STREAM_BYTES * 1e6 / (double)(client.rxDoneUs - start),
+           TEST_STREAM_BYTES * 1e6 / (double)(server.rxDoneUs - start),
+           limit);
+
+    disconnect();
+}
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+void osalInitTasks(void)
+{
+    tasksEvents = calloc(tasksCnt, sizeof(uint16));
+    cb_ASSERT(tasksEvents != NULL);
+
+    cbSPS_init(0);
+    cbSPC_init(1);
+}
+
+int main(void)
+{
+    static const Case cases[] =
+    {
+        { "fast", TEST_RX_BUF_SIZE },
+        { "slow", TEST_FIFO_SIZE }
+    };
+    uint8 i;
+
+    bleHost_init();
+    bleHost_registerMtuCallback(cbSPS_setMtu);
+    osal_init_system();
+
+    cbSPS_addService();
+    cbSPS_register(&serverCallbacks);
+    cbSPS_enable();
+    cbSPC_register(&clientCallbacks);
+
+    testSetupTimeout();
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        testStream(&cases[i]);
+    }
+
+    printf("test_spc_loop: OK\n");
+
+    return 0;
+}
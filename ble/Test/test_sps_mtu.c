@@ -0,0 +1,279 @@
+/*---------------------------------------------------------------------------
+ * Copyright (c) 2000, 2001 connectBlue AB, Sweden.
+ * Any reproduction without written permission is prohibited by law.
+ *
+ * Component   : Host test
+ * File        : test_sps_mtu.c
+ *
+ * Description : Rx credits of the Serial Port Service when the MTU grows
+ *               while the remote side holds credits. The service gives
+ *               credits on the default MTU, then the MTU is exchanged
+ *               and the peer sends packets of the new fifo payload with
+ *               the credits it already has. The application does not
+ *               read its rx buffer until all credits are used, so the
+ *               credits alone must keep the buffer from overflowing.
+ *               After that the application reads all data at every
+ *               connection event and a stream is sent with the new
+ *               payload, checking that no data is lost.
+ *
+ *               Built with a 247 byte ATT MTU, so the fifo payload grows
+ *               from 20 to 244 bytes.
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "att.h"
+#include "gatt.h"
+
+#include "cb_assert.h"
+#include "cb_serial_service.h"
+#include "osal_host.h"
+#include "ble_host.h"
+#include "sps_peer.h"
+
+/*===========================================================================
+ * DEFINES
+ *=========================================================================*/
+#define CHECK(c) \
+    do { if (!(c)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c); exit(1); } } while (0)
+
+#define TEST_INTERVAL_US    (7500)
+#define TEST_RX_BUF_SIZE    (4 * cbSPS_MAX_FIFO_SIZE)
+#define TEST_STREAM_BYTES   (256UL * 1024)
+#define TEST_MAX_EVENTS     (100000UL)
+
+typedef char TestMtuCheck[(cbSPS_MAX_FIFO_SIZE > cbSPS_DEFAULT_FIFO_SIZE) ? 1 : -1];
+
+/*===========================================================================
+ * TYPES
+ *=========================================================================*/
+typedef struct
+{
+    bool    sending;        /* Peer sends while TRUE */
+    uint32  txBytes;
+    uint32  rxBytes;
+    uint16  rxBuffered;     /* Bytes in the rx buffer of the application */
+    uint16  maxBuffered;
+    uint32  nLost;          /* Bytes that did not fit */
+    uint8   maxPacket;
+} Test;
+
+/*===========================================================================
+ * DECLARATIONS
+ *=========================================================================*/
+static void connectEvt(uint16 connHandle);
+static void disconnectEvt(uint16 connHandle);
+static void dataEvt(uint16 connHandle, uint8 *pBuf, uint8 size);
+static uint8 peerTxData(uint8 *pBuf, uint8 maxLen);
+
+/*===========================================================================
+ * DEFINITIONS
+ *=========================================================================*/
+static const char *file = "test_sps_mtu";
+
+const pTaskEventHandlerFn tasksArr[] =
+{
+    cbSPS_processEvent
+};
+
+const uint8 tasksCnt = sizeof(tasksArr) / sizeof(tasksArr[0]);
+uint16 *tasksEvents;
+
+static cbSPS_Callbacks appCallbacks =
+{
+    connectEvt,
+    disconnectEvt,
+    dataEvt,
+    NULL,
+    NULL
+};
+
+static const spsPeer_Callbacks peerCallbacks =
+{
+    peerTxData,
+    NULL
+};
+
+static const bleHost_LinkCfg link =
+{
+    TEST_INTERVAL_US,
+    4,
+    4
+};
+
+static Test test;
+
+/*===========================================================================
+ * STATIC FUNCTIONS
+ *=========================================================================*/
+
+static uint8 seqByte(uint32 n)
+{
+    return (uint8)(n ^ (n >> 8) ^ (n >> 16));
+}
+
+static void setRemainingBufSize(void)
+{
+    cbSPS_setRemainingBufSize(BLE_HOST_CONN_HANDLE, TEST_RX_BUF_SIZE - test.rxBuffered);
+}
+
+static void connectEvt(uint16 connHandle)
+{
+    setRemainingBufSize();
+}
+
+static void disconnectEvt(uint16 connHandle)
+{
+}
+
+static void dataEvt(uint16 connHandle, uint8 *pBuf, uint8 size)
+{
+    uint8 i;
+
+    for (i = 0; i < size; i++)
+    {
+        CHECK(pBuf[i] == seqByte(test.rxBytes + i));
+    }
+    test.rxBytes += size;
+    test.maxPacket = MAX(test.maxPacket, size);
+
+    if ((test.rxBuffered + size) > TEST_RX_BUF_SIZE)
+    {
+        test.nLost += size;
+    }
+    else
+    {
+        test.rxBuffered += size;
+        test.maxBuffered = MAX(test.maxBuffered, test.rxBuffered);
+        setRemainingBufSize();
+    }
+}
+
+static uint8 peerTxData(uint8 *pBuf, uint8 maxLen)
+{
+    uint8 size;
+    uint8 i;
+
+    if ((test.sending == FALSE) || (test.txBytes >= TEST_STREAM_BYTES))
+    {
+        return 0;
+    }
+
+    size = (uint8)MIN((uint32)maxLen, TEST_STREAM_BYTES - test.txBytes);
+    for (i = 0; i < size; i++)
+    {
+        pBuf[i] = seqByte(test.txBytes + i);
+    }
+    test.txBytes += size;
+
+    return size;
+}
+
+static void consumeAll(void)
+{
+    if (test.rxBuffered > 0)
+    {
+        test.rxBuffered = 0;
+        setRemainingBufSize();
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * Credits are given on the default MTU, before the MTU is exchanged.
+ * The peer then gets the larger payload and sends with the credits it has.
+ *-------------------------------------------------------------------------*/
+static void testMtuGrowsWithCredits(void)
+{
+    cbSPS_RxCreditStats credits;
+    spsPeer_Stats       peerStats;
+    spsPeer_Cfg         peer;
+    uint32              i;
+
+    memset(&test, 0, sizeof(test));
+
+    memset(&peer, 0, sizeof(peer));
+    peer.rxBufSize = 256;
+    peer.creditsLowWater = cbSPS_RX_CREDITS_LOW_WATER;
+    peer.fifoSize = cbSPS_DEFAULT_FIFO_SIZE;
+
+    bleHost_connect(&link);
+    spsPeer_connect(&peer);
+    osalHost_advanceTime(2 * TEST_INTERVAL_US);
+
+    cbSPS_getRxCreditStats(&credits);
+    CHECK(credits.nGrants > 0);
+    CHECK(cbSPS_getFifoSize(BLE_HOST_CONN_HANDLE) == cbSPS_DEFAULT_FIFO_SIZE);
+
+    cbSPS_setMtu(BLE_HOST_CONN_HANDLE, ATT_MTU_SIZE);
+    CHECK(cbSPS_getFifoSize(BLE_HOST_CONN_HANDLE) == cbSPS_MAX_FIFO_SIZE);
+    spsPeer_setFifoSize(cbSPS_MAX_FIFO_SIZE);
+
+    // The application does not read, the peer uses up its credits
+    test.sending = TRUE;
+    for (i = 0; i < 100; i++)
+    {
+        osalHost_advanceTime(TEST_INTERVAL_US);
+    }
+
+    spsPeer_getStats(&peerStats);
+    CHECK(peerStats.nTxStalled > 0);
+    CHECK(test.rxBytes > 0);
+    CHECK(test.maxPacket == cbSPS_MAX_FIFO_SIZE);
+    CHECK(test.nLost == 0);
+    CHECK(test.maxBuffered <= TEST_RX_BUF_SIZE);
+
+    // Credits follow the new payload once the buffer is read
+    for (i = 0; (test.rxBytes < TEST_STREAM_BYTES) && (i < TEST_MAX_EVENTS); i++)
+    {
+        osalHost_advanceTime(TEST_INTERVAL_US);
+        consumeAll();
+        osalHost_runUntilIdle();
+    }
+
+    spsPeer_getStats(&peerStats);
+    CHECK(test.rxBytes == TEST_STREAM_BYTES);
+    CHECK(test.nLost == 0);
+    CHECK(peerStats.nCreditErrors == 0);
+
+    printf("test_sps_mtu: fifo %u to %u with credits held, max %u of %u bytes buffered\n",
+           cbSPS_DEFAULT_FIFO_SIZE,
+           cbSPS_MAX_FIFO_SIZE,
+           test.maxBuffered,
+           TEST_RX_BUF_SIZE);
+
+    bleHost_disconnect();
+    osalHost_runUntilIdle();
+}
+
+/*===========================================================================
+ * FUNCTIONS
+ *=========================================================================*/
+
+void osalInitTasks(void)
+{
+    tasksEvents = calloc(tasksCnt, sizeof(uint16));
+    cb_ASSERT(tasksEvents != NULL);
+
+    cbSPS_init(0);
+}
+
+int main(void)
+{
+    bleHost_init();
+    osal_init_system();
+
+    cbSPS_addService();
+    cbSPS_register(&appCallbacks);
+    cbSPS_enable();
+    spsPeer_init(&peerCallbacks);
+
+    testMtuGrowsWithCredits();
+
+    printf("test_sps_mtu: OK\n");
+
+    return 0;
+}